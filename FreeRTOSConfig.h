@@ -41,28 +41,226 @@
  *----------------------------------------------------------*/
 
 #define configUSE_PREEMPTION 1
-#define configUSE_IDLE_HOOK 0
 #define configUSE_TICK_HOOK 0
+/* No hook for failed allocations: it could run in vSerialInit() before the
+transmit mutex exists, or in a task that holds the serial lock, so it could not
+write anything. The caller gets NULL and heapstats.c counts the failure, which
+the monitor shows in the "failed:" field of the heap rows. */
+#define configUSE_MALLOC_FAILED_HOOK 0
+/* Fastest processor clock, see power.c. The run time clock always counts at
+this rate. */
 #define configCPU_CLOCK_HZ ((unsigned long)20000000)
 #define configTICK_RATE_HZ ((TickType_t)1000)
-#define configMINIMAL_STACK_SIZE ((unsigned short)70)
-#define configTOTAL_HEAP_SIZE ((size_t)(7000))
+
+/* Set to 0 to keep the tick running while every task sleeps. With 1 the idle
+task stops it until the next task is due, see tickless.c. Can also be set by
+adding -DconfigUSE_TICKLESS_IDLE=0 to CFLAGS in the Makefile. */
+#ifndef configUSE_TICKLESS_IDLE
+#define configUSE_TICKLESS_IDLE 1
+#endif
+
+/* The idle hook stops the processor with WFI until the next interrupt. With
+tickless idle it is left out: the hook runs before the kernel decides whether
+to stop the tick, so its WFI would wait for one more tick interrupt before every
+tickless sleep. The processor then sleeps only in vPortSuppressTicksAndSleep(),
+and when the next task is due in less than two ticks the idle task runs until
+then. */
+#if configUSE_TICKLESS_IDLE == 1
+#define configUSE_IDLE_HOOK 0
+#else
+#define configUSE_IDLE_HOOK 1
+#endif
+
+/* Set to 1 to keep the delayed tasks in a timing wheel instead of two lists
+sorted by wake time, see Source/tasks.c. Blocking then takes the same time
+however many tasks are delayed, but the 17 lists of the wheel take about 290
+bytes more of SRAM, which the trace recorder build does not have, and with a
+handful of tasks the sorted lists are as fast (tools/kernelbench). The wheel
+turns every 2^(configTIMING_WHEEL_BITS * configTIMING_WHEEL_LEVELS) ticks;
+longer delays wait in a list that is checked once per turn. Can also be set by
+adding -DconfigUSE_TIMING_WHEEL=1 to CFLAGS in the Makefile. */
+#ifndef configUSE_TIMING_WHEEL
+#define configUSE_TIMING_WHEEL 0
+#endif
+#define configTIMING_WHEEL_BITS 3
+#define configTIMING_WHEEL_LEVELS 2
+
+/* Set to 1 to schedule the filter, graficar and monitor tasks by earliest
+deadline first instead of by priority, see vTaskSetEdfParameters() in
+Source/include/task.h. They share configEDF_PRIORITY, between the sensor task
+above and the command task below, and the ready one with the earliest deadline
+runs. Every task takes 20 bytes more of SRAM. Can also be set by adding
+-DconfigUSE_EDF_SCHEDULING=1 to CFLAGS in the Makefile. */
+#ifndef configUSE_EDF_SCHEDULING
+#define configUSE_EDF_SCHEDULING 0
+#endif
+#define configEDF_PRIORITY 2
+
+/* Set to 1 to limit the processor time of the monitor and command tasks, see
+vTaskSetCpuBudget() in Source/include/task.h. The time a task runs is counted
+with the run time clock, and once it used its budget in the current period it
+drops to configBUDGET_DEMOTED_PRIORITY until the period ends. Every task takes
+32 bytes more of SRAM. Can also be set by adding -DconfigUSE_TASK_BUDGETS=1 to
+CFLAGS in the Makefile. */
+#ifndef configUSE_TASK_BUDGETS
+#define configUSE_TASK_BUDGETS 0
+#endif
+#define configBUDGET_DEMOTED_PRIORITY 0
+
+/* Set to 1 to give the filter and graficar tasks a preemption threshold, see
+vTaskSetPreemptionThreshold() in Source/include/task.h. Once one of them runs,
+only a task above the threshold preempts it and it does not take turns with
+the tasks of its priority, which saves context switches when the pipeline is
+busy. Every task takes 12 bytes more of SRAM. Can also be set by adding
+-DconfigUSE_PREEMPTION_THRESHOLDS=1 to CFLAGS in the Makefile. */
+#ifndef configUSE_PREEMPTION_THRESHOLDS
+#define configUSE_PREEMPTION_THRESHOLDS 0
+#endif
+
+/* Set to 1 to build the stack profiling mode. Every stack gets
+configSTACK_PROFILE_EXTRA more words, so the watermarks can show a need beyond
+the current size, and the command "stacks=report" sends the recommended sizes
+that tools/stacksizes.py writes to stacksizes.h. The extra words come out of
+the heap, which has room for 8 per stack next to the measured sizes; a stack
+that outgrows them ends in the overflow hook, which names the task. Can also be
+set by adding -DconfigUSE_STACK_PROFILE=1 to CFLAGS in the Makefile. */
+#ifndef configUSE_STACK_PROFILE
+#define configUSE_STACK_PROFILE 0
+#endif
+#if configUSE_STACK_PROFILE == 1
+#define configSTACK_PROFILE_EXTRA (8)
+#else
+#define configSTACK_PROFILE_EXTRA (0)
+#endif
+
+/* Stack sizes of the tasks, the idle task and the main stack. */
+#include "stacksizes.h"
+#define configMINIMAL_STACK_SIZE                                               \
+  ((unsigned short)(stackIDLE_WORDS + configSTACK_PROFILE_EXTRA))
+
+/* Set to 1 to record kernel events in a RAM buffer that can be sent over the
+UART, see trace.c. Can also be set by adding -DconfigUSE_TRACE_RECORDER=1 to
+CFLAGS in the Makefile. */
+#ifndef configUSE_TRACE_RECORDER
+#define configUSE_TRACE_RECORDER 0
+#endif
+
+/* Set to 1 to measure the time spent in every interrupt handler and leave it
+out of the CPU usage of the tasks, see isrstats.c. Can also be set by adding
+-DconfigUSE_ISR_STATS=1 to CFLAGS in the Makefile. */
+#ifndef configUSE_ISR_STATS
+#define configUSE_ISR_STATS 0
+#endif
+
+/* The heap shares the 8K of SRAM with the static buffers of the application
+(filter history, display image, ...), keep both in mind when changing it: the
+SRAM region of standalone.ld is 8K, so a build that does not fit fails to link,
+and gcc/out.map gives the .data and .bss totals. The "min:" field of the heap
+rows of the monitor shows how much of it the tasks, queues and stream buffers
+leave. Measured under load with the stack sizes of stacksizes.h, they need
+4704 bytes, and up to 4896 with one of the stack profiling mode, the CPU
+budgets, EDF and the preemption thresholds, which grow the stacks or the TCBs.
+Of two of those only EDF with the thresholds leaves some heap free. The trace
+recorder, the ISR stats and the timing wheel each take about 300 bytes of
+static RAM from the heap, so they build one at a time and without the options
+that grow the stacks or the TCBs. */
+#if configUSE_TRACE_RECORDER == 1 && configUSE_ISR_STATS == 1
+#error "The trace recorder and the ISR stats do not fit in the 8K of SRAM together"
+#elif configUSE_TRACE_RECORDER == 1
+#define configTOTAL_HEAP_SIZE ((size_t)(4736))
+#elif configUSE_ISR_STATS == 1 || configUSE_TIMING_WHEEL == 1
+#define configTOTAL_HEAP_SIZE ((size_t)(4800))
+#else
+#define configTOTAL_HEAP_SIZE ((size_t)(5000))
+#endif
 #define configMAX_TASK_NAME_LEN (10)
 
+/* Heap implementation, 4 or 5, see heapstats.c. Set by HEAP in the Makefile,
+which also picks the source file. */
+#ifndef configHEAP_IMPLEMENTATION
+#define configHEAP_IMPLEMENTATION 4
+#endif
+
 /*-----------------------------------------------------------*/
 
 #define configCHECK_FOR_STACK_OVERFLOW 2 // method 2
 #define configUSE_TRACE_FACILITY 1
+#define configUSE_MUTEXES 1
 #define INCLUDE_xTaskGetHandle 1
+#define INCLUDE_xTaskGetIdleTaskHandle 1
 #define INCLUDE_uxTaskGetStackHighWaterMark 1
 #define configGENERATE_RUN_TIME_STATS 1
 
-extern volatile unsigned long ulHighFrequencyTimerTicks;
-/* ulHighFrequencyTimerTicks is already being incremented at 20KHz.  Just set
-its value back to 0. */
-#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()                               \
-  (ulHighFrequencyTimerTicks = 0UL)
-#define portGET_RUN_TIME_COUNTER_VALUE() ulHighFrequencyTimerTicks
+/* The run time counters are 64 bit so they do not wrap, the 32 bit hardware
+counter wraps every 215 seconds at 20MHz. */
+#define configRUN_TIME_COUNTER_TYPE uint64_t
+
+extern uint64_t ullGetRunTimeCounterValue(void);
+/* The free running timer is already started by vSetupHighFrequencyTimer(),
+see timertest.c. With the interrupt statistics the clock stops while a handler
+runs, so the handlers are not charged to the task they interrupted. */
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()
+#if configUSE_ISR_STATS == 1
+extern uint64_t ullIsrStatsGetTotal(void);
+#define portGET_RUN_TIME_COUNTER_VALUE()                                       \
+  (ullGetRunTimeCounterValue() - ullIsrStatsGetTotal())
+#else
+#define portGET_RUN_TIME_COUNTER_VALUE() ullGetRunTimeCounterValue()
+#endif
+
+/* Wakeup latency histograms, see latency.c. The hooks expand inside tasks.c,
+where the TCB fields and pxCurrentTCB are visible. The running task can be
+moved between ready lists when it disinherits a priority, that is not a
+wakeup. */
+extern void vLatencyTaskReady(void *pvTask, unsigned long ulTaskNumber);
+extern void vLatencyTaskSwitchedIn(unsigned long ulTaskNumber);
+#define traceMOVED_TASK_TO_READY_STATE(pxTCB)                                  \
+  do {                                                                         \
+    if ((pxTCB) != pxCurrentTCB) {                                             \
+      vLatencyTaskReady((void *)(pxTCB), (pxTCB)->uxTCBNumber);                \
+      traceRECORD(traceEVENT_TASK_READY, (pxTCB)->uxTCBNumber, 0);             \
+    }                                                                          \
+  } while (0)
+#define traceTASK_SWITCHED_IN()                                                \
+  do {                                                                         \
+    vLatencyTaskSwitchedIn(pxCurrentTCB->uxTCBNumber);                         \
+    traceRECORD(traceEVENT_TASK_SWITCHED_IN, pxCurrentTCB->uxTCBNumber, 0);    \
+  } while (0)
+
+/* Kernel event recorder, see trace.c. The queue hooks expand inside queue.c
+and record the number given by vTraceNameQueue() and the items waiting. The
+application interrupt handlers call traceISR_ENTER() and traceISR_EXIT(). */
+#if configUSE_TRACE_RECORDER == 1
+#include "trace.h"
+#define traceRECORD(ulEvent, ulObject, ulData)                                 \
+  vTraceRecord((ulEvent), (ulObject), (ulData))
+#define traceTASK_CREATE(pxNewTCB)                                             \
+  vTraceTaskCreated((void *)(pxNewTCB), (pxNewTCB)->uxTCBNumber)
+#define traceQUEUE_SEND(pxQueue)                                               \
+  traceRECORD(traceEVENT_QUEUE_SEND, (pxQueue)->uxQueueNumber,                 \
+              (pxQueue)->uxMessagesWaiting)
+#define traceQUEUE_SEND_FROM_ISR(pxQueue) traceQUEUE_SEND(pxQueue)
+#define traceQUEUE_RECEIVE(pxQueue)                                            \
+  traceRECORD(traceEVENT_QUEUE_RECEIVE, (pxQueue)->uxQueueNumber,              \
+              (pxQueue)->uxMessagesWaiting)
+#define traceQUEUE_RECEIVE_FROM_ISR(pxQueue) traceQUEUE_RECEIVE(pxQueue)
+#define traceBLOCKING_ON_QUEUE_SEND(pxQueue)                                   \
+  traceRECORD(traceEVENT_QUEUE_BLOCK_SEND, (pxQueue)->uxQueueNumber,           \
+              (pxQueue)->uxMessagesWaiting)
+#define traceBLOCKING_ON_QUEUE_RECEIVE(pxQueue)                                \
+  traceRECORD(traceEVENT_QUEUE_BLOCK_RECEIVE, (pxQueue)->uxQueueNumber,        \
+              (pxQueue)->uxMessagesWaiting)
+#if traceRECORD_TICKS == 1
+#define traceTASK_INCREMENT_TICK(xTickCount)                                   \
+  traceRECORD(traceEVENT_TICK, 0, (xTickCount))
+#endif
+#define traceISR_ENTER() vTraceIsrEnter()
+#define traceISR_EXIT() vTraceIsrExit()
+#else
+#define traceRECORD(ulEvent, ulObject, ulData)
+#define traceISR_ENTER()
+#define traceISR_EXIT()
+#endif
 
 /*-----------------------------------------------------------*/
 
@@ -857,6 +857,55 @@
     #define configUSE_TICKLESS_IDLE    0
 #endif
 
+#ifndef configUSE_TIMING_WHEEL
+    #define configUSE_TIMING_WHEEL    0
+#endif
+
+#ifndef configTIMING_WHEEL_BITS
+    #define configTIMING_WHEEL_BITS    3
+#endif
+
+#ifndef configTIMING_WHEEL_LEVELS
+    #define configTIMING_WHEEL_LEVELS    2
+#endif
+
+#ifndef configUSE_EDF_SCHEDULING
+    #define configUSE_EDF_SCHEDULING    0
+#endif
+
+#if ( configUSE_EDF_SCHEDULING == 1 )
+    #ifndef configEDF_PRIORITY
+        #error configEDF_PRIORITY must be defined to the priority of the tasks scheduled by deadline when configUSE_EDF_SCHEDULING is 1
+    #endif
+    #if ( configEDF_PRIORITY >= configMAX_PRIORITIES ) || ( configEDF_PRIORITY < 1 )
+        #error configEDF_PRIORITY must be above the idle priority and below configMAX_PRIORITIES
+    #endif
+#endif
+
+#ifndef configUSE_TASK_BUDGETS
+    #define configUSE_TASK_BUDGETS    0
+#endif
+
+#if ( configUSE_TASK_BUDGETS == 1 )
+    #if ( configGENERATE_RUN_TIME_STATS != 1 )
+        #error configGENERATE_RUN_TIME_STATS must be 1 when configUSE_TASK_BUDGETS is 1, the budgets are counted with the run time counter
+    #endif
+    #ifndef configBUDGET_DEMOTED_PRIORITY
+        #define configBUDGET_DEMOTED_PRIORITY    0
+    #endif
+    #if ( configBUDGET_DEMOTED_PRIORITY >= configMAX_PRIORITIES )
+        #error configBUDGET_DEMOTED_PRIORITY must be below configMAX_PRIORITIES
+    #endif
+#endif
+
+#ifndef configUSE_PREEMPTION_THRESHOLDS
+    #define configUSE_PREEMPTION_THRESHOLDS    0
+#endif
+
+#if ( ( configUSE_PREEMPTION_THRESHOLDS == 1 ) && ( configUSE_PREEMPTION != 1 ) )
+    #error configUSE_PREEMPTION must be 1 when configUSE_PREEMPTION_THRESHOLDS is 1
+#endif
+
 #ifndef configPRE_SUPPRESS_TICKS_AND_SLEEP_PROCESSING
     #define configPRE_SUPPRESS_TICKS_AND_SLEEP_PROCESSING( x )
 #endif
@@ -1301,6 +1350,22 @@ typedef struct xSTATIC_TCB
     #if ( configUSE_POSIX_ERRNO == 1 )
         int iDummy22;
     #endif
+    #if ( configUSE_EDF_SCHEDULING == 1 )
+        TickType_t xDummy23[ 4 ];
+        uint8_t ucDummy24;
+    #endif
+    #if ( configUSE_TASK_BUDGETS == 1 )
+        uint32_t ulDummy25[ 3 ];
+        TickType_t xDummy26[ 2 ];
+        UBaseType_t uxDummy27;
+        void * pxDummy28;
+        uint8_t ucDummy29;
+    #endif
+    #if ( configUSE_PREEMPTION_THRESHOLDS == 1 )
+        UBaseType_t uxDummy30;
+        void * pxDummy31;
+        uint8_t ucDummy32;
+    #endif
 } StaticTask_t;
 
 /*
@@ -1088,6 +1088,130 @@ void vTaskGetInfo( TaskHandle_t xTask,
 void vTaskPrioritySet( TaskHandle_t xTask,
                        UBaseType_t uxNewPriority ) PRIVILEGED_FUNCTION;
 
+/**
+ * task. h
+ * @code{c}
+ * void vTaskSetEdfParameters( TaskHandle_t xTask, TickType_t xPeriod, TickType_t xRelativeDeadline );
+ * @endcode
+ *
+ * configUSE_EDF_SCHEDULING must be defined as 1 for this function to be
+ * available.
+ *
+ * Schedules a task by earliest deadline first.  The tasks at priority
+ * configEDF_PRIORITY that have a deadline run in the order of the absolute
+ * deadlines of their current jobs instead of taking turns.  Tasks at any other
+ * priority are scheduled as usual, so they preempt or are preempted by all of
+ * them.
+ *
+ * A job is released when the task is made ready after blocking, unless it
+ * wakes before the deadline of its current job, and never sooner than xPeriod
+ * after the previous job.  Its absolute deadline is the release time plus
+ * xRelativeDeadline.  The first job is released now if the task is ready, else
+ * the next time it is.
+ *
+ * @param xTask Handle of the task.  Passing a NULL handle sets the parameters
+ * of the calling task.
+ *
+ * @param xPeriod Shortest time between the releases of two jobs, in ticks.
+ *
+ * @param xRelativeDeadline Time a job has to complete after its release, in
+ * ticks.  0 returns the task to fixed priority scheduling.
+ *
+ * \defgroup vTaskSetEdfParameters vTaskSetEdfParameters
+ * \ingroup TaskCtrl
+ */
+void vTaskSetEdfParameters( TaskHandle_t xTask,
+                            TickType_t xPeriod,
+                            TickType_t xRelativeDeadline ) PRIVILEGED_FUNCTION;
+
+/**
+ * task. h
+ * @code{c}
+ * void vTaskSetCpuBudget( TaskHandle_t xTask, uint32_t ulBudget, TickType_t xPeriod );
+ * @endcode
+ *
+ * configUSE_TASK_BUDGETS must be defined as 1 for this function to be
+ * available.
+ *
+ * Limits the processor time a task can take from the tasks below it.  The
+ * time the task runs is counted with the run time counter, on every context
+ * switch and on every tick.  Once it used ulBudget in the current period it is
+ * demoted to configBUDGET_DEMOTED_PRIORITY, where it only runs when nothing
+ * else wants to, until the period ends and the budget is replenished.  A task
+ * holding a mutex is demoted when it gives back the last one.
+ *
+ * The demotion is undone by the next replenishment, so the priority of a task
+ * with a budget must not be changed with vTaskPrioritySet().
+ *
+ * @param xTask Handle of the task.  Passing a NULL handle sets the budget of
+ * the calling task.
+ *
+ * @param ulBudget Run time the task may use per period, in the units of
+ * portGET_RUN_TIME_COUNTER_VALUE().  0 removes the budget and returns the task
+ * to its priority if it was demoted.
+ *
+ * @param xPeriod Ticks between replenishments.  The first period starts now.
+ *
+ * \defgroup vTaskSetCpuBudget vTaskSetCpuBudget
+ * \ingroup TaskCtrl
+ */
+void vTaskSetCpuBudget( TaskHandle_t xTask,
+                        uint32_t ulBudget,
+                        TickType_t xPeriod ) PRIVILEGED_FUNCTION;
+
+/**
+ * task. h
+ * @code{c}
+ * uint32_t ulTaskGetCpuBudgetExhausted( TaskHandle_t xTask );
+ * @endcode
+ *
+ * configUSE_TASK_BUDGETS must be defined as 1 for this function to be
+ * available.
+ *
+ * @param xTask Handle of the task.  Passing a NULL handle returns the count of
+ * the calling task.
+ *
+ * @return The number of times the task was demoted for using up its budget.
+ *
+ * \defgroup ulTaskGetCpuBudgetExhausted ulTaskGetCpuBudgetExhausted
+ * \ingroup TaskCtrl
+ */
+uint32_t ulTaskGetCpuBudgetExhausted( TaskHandle_t xTask ) PRIVILEGED_FUNCTION;
+
+/**
+ * task. h
+ * @code{c}
+ * void vTaskSetPreemptionThreshold( TaskHandle_t xTask, UBaseType_t uxThreshold );
+ * @endcode
+ *
+ * configUSE_PREEMPTION_THRESHOLDS must be defined as 1 for this function to be
+ * available.
+ *
+ * Gives a task a preemption threshold.  The task is selected to run by its
+ * priority as usual, but once it runs only a task with a priority above
+ * uxThreshold preempts it.  It does not take turns with the other tasks of its
+ * priority on every tick, and when it is preempted it resumes before any task
+ * at or below uxThreshold.  Calling taskYIELD() does not hand the processor to
+ * those tasks either.  A threshold equal to the priority of the task keeps the
+ * preemptions by higher priority tasks and only removes the switches between
+ * tasks of its own priority.
+ *
+ * A task demoted for using up its budget, see vTaskSetCpuBudget(), has no
+ * threshold until the budget is replenished.
+ *
+ * @param xTask Handle of the task.  Passing a NULL handle sets the threshold
+ * of the calling task.
+ *
+ * @param uxThreshold Priority that a task has to be above to preempt xTask.
+ * Below the priority of xTask it counts as the priority.  0 removes the
+ * threshold.
+ *
+ * \defgroup vTaskSetPreemptionThreshold vTaskSetPreemptionThreshold
+ * \ingroup TaskCtrl
+ */
+void vTaskSetPreemptionThreshold( TaskHandle_t xTask,
+                                  UBaseType_t uxThreshold ) PRIVILEGED_FUNCTION;
+
 /**
  * task. h
  * @code{c}
@@ -115,6 +115,31 @@
     #define configIDLE_TASK_NAME    "IDLE"
 #endif
 
+#if ( configUSE_EDF_SCHEDULING == 1 )
+
+/* The ready list of configEDF_PRIORITY is sorted by deadline, see
+ * prvAddTaskToReadyListByDeadline(), and the task at its head runs.  The tasks
+ * of any other priority take turns. */
+    #define taskSELECT_FROM_READY_LIST( uxTopPriority )                                                \
+    {                                                                                                  \
+        if( ( uxTopPriority ) == ( UBaseType_t ) configEDF_PRIORITY )                                  \
+        {                                                                                              \
+            pxCurrentTCB = listGET_OWNER_OF_HEAD_ENTRY( &( pxReadyTasksLists[ ( uxTopPriority ) ] ) ); \
+        }                                                                                              \
+        else                                                                                           \
+        {                                                                                              \
+            listGET_OWNER_OF_NEXT_ENTRY( pxCurrentTCB, &( pxReadyTasksLists[ ( uxTopPriority ) ] ) );  \
+        }                                                                                              \
+    }
+
+#else /* configUSE_EDF_SCHEDULING */
+
+    #define taskSELECT_FROM_READY_LIST( uxTopPriority )    listGET_OWNER_OF_NEXT_ENTRY( pxCurrentTCB, &( pxReadyTasksLists[ ( uxTopPriority ) ] ) )
+
+#endif /* configUSE_EDF_SCHEDULING */
+
+/*-----------------------------------------------------------*/
+
 #if ( configUSE_PORT_OPTIMISED_TASK_SELECTION == 0 )
 
 /* If configUSE_PORT_OPTIMISED_TASK_SELECTION is 0 then task selection is
@@ -146,7 +171,7 @@
                                                                               \
         /* listGET_OWNER_OF_NEXT_ENTRY indexes through the list, so the tasks of \
          * the  same priority get an equal share of the processor time. */                    \
-        listGET_OWNER_OF_NEXT_ENTRY( pxCurrentTCB, &( pxReadyTasksLists[ uxTopPriority ] ) ); \
+        taskSELECT_FROM_READY_LIST( uxTopPriority );                                          \
         uxTopReadyPriority = uxTopPriority;                                                   \
     } /* taskSELECT_HIGHEST_PRIORITY_TASK */
 
@@ -176,7 +201,7 @@
         /* Find the highest priority list that contains ready tasks. */                         \
         portGET_HIGHEST_PRIORITY( uxTopPriority, uxTopReadyPriority );                          \
         configASSERT( listCURRENT_LIST_LENGTH( &( pxReadyTasksLists[ uxTopPriority ] ) ) > 0 ); \
-        listGET_OWNER_OF_NEXT_ENTRY( pxCurrentTCB, &( pxReadyTasksLists[ uxTopPriority ] ) );   \
+        taskSELECT_FROM_READY_LIST( uxTopPriority );                                            \
     } /* taskSELECT_HIGHEST_PRIORITY_TASK() */
 
 /*-----------------------------------------------------------*/
@@ -196,9 +221,22 @@
 
 /*-----------------------------------------------------------*/
 
+#if ( configUSE_TIMING_WHEEL == 1 )
+
+/* The timing wheel has no overflow list.  The tasks due after the tick count
+ * overflows wait in the far list, which is looked at when the tick count
+ * reaches 0 as at the start of any other turn of the last level. */
+    #define taskSWITCH_DELAYED_LISTS()                \
+    {                                                 \
+        xNumOfOverflows++;                            \
+        xNextTaskUnblockTime = ( TickType_t ) 0U;     \
+    }
+
+#else /* configUSE_TIMING_WHEEL */
+
 /* pxDelayedTaskList and pxOverflowDelayedTaskList are switched when the tick
  * count overflows. */
-#define taskSWITCH_DELAYED_LISTS()                                                \
+    #define taskSWITCH_DELAYED_LISTS()                                              \
     {                                                                             \
         List_t * pxTemp;                                                          \
                                                                                   \
@@ -212,16 +250,71 @@
         prvResetNextTaskUnblockTime();                                            \
     }
 
+#endif /* configUSE_TIMING_WHEEL */
+
+/*-----------------------------------------------------------*/
+
+/* Whether tick count xA comes before tick count xB, allowing for the tick
+ * count overflowing between the two. */
+#define taskTICK_BEFORE( xA, xB )    ( ( TickType_t ) ( ( xA ) - ( xB ) ) > ( portMAX_DELAY >> 1 ) )
+
+#if ( configUSE_PREEMPTION_THRESHOLDS == 1 )
+
+/* Whether a task runs with a preemption threshold.  A task demoted for using
+ * up its budget loses it until the budget is replenished. */
+    #if ( configUSE_TASK_BUDGETS == 1 )
+        #define taskHAS_THRESHOLD( pxTCB )    ( ( ( pxTCB )->uxPreemptionThreshold != ( UBaseType_t ) 0U ) && ( ( pxTCB )->ucBudgetDemoted == ( uint8_t ) pdFALSE ) )
+    #else
+        #define taskHAS_THRESHOLD( pxTCB )    ( ( pxTCB )->uxPreemptionThreshold != ( UBaseType_t ) 0U )
+    #endif
+
+/* The priority a task has to be above to preempt pxTCB once it runs: its
+ * threshold, or its priority if that is higher, for example inherited. */
+    #define taskPREEMPTION_LEVEL( pxTCB )                                                                  \
+    ( ( taskHAS_THRESHOLD( pxTCB ) && ( ( pxTCB )->uxPreemptionThreshold > ( pxTCB )->uxPriority ) ) ? \
+      ( pxTCB )->uxPreemptionThreshold : ( pxTCB )->uxPriority )
+
+#else /* configUSE_PREEMPTION_THRESHOLDS */
+
+    #define taskPREEMPTION_LEVEL( pxTCB )    ( ( pxTCB )->uxPriority )
+
+#endif /* configUSE_PREEMPTION_THRESHOLDS */
+
+#if ( configUSE_EDF_SCHEDULING == 1 )
+
+    #define taskINSERT_READY( pxTCB )    prvAddTaskToReadyListByDeadline( pxTCB )
+
+/* Whether a task just made ready should run before the running task: it has a
+ * higher priority than the running task, or than its preemption threshold, or
+ * both are at configEDF_PRIORITY and it has the earlier deadline.  A task held
+ * in xPendingReadyList has no deadline yet, but then xTaskResumeAll() looks
+ * again. */
+    #define taskPREEMPTS_CURRENT( pxTCB )                                                                                  \
+    ( ( ( pxTCB )->uxPriority > taskPREEMPTION_LEVEL( pxCurrentTCB ) ) ||                                                  \
+      ( ( ( pxTCB )->uxPriority == ( UBaseType_t ) configEDF_PRIORITY ) &&                                                 \
+        ( pxCurrentTCB->uxPriority == ( UBaseType_t ) configEDF_PRIORITY ) &&                                              \
+        taskTICK_BEFORE( listGET_LIST_ITEM_VALUE( &( ( pxTCB )->xStateListItem ) ),                                        \
+                         listGET_LIST_ITEM_VALUE( &( pxCurrentTCB->xStateListItem ) ) ) ) )
+
+#else /* configUSE_EDF_SCHEDULING */
+
+    #define taskINSERT_READY( pxTCB )        listINSERT_END( &( pxReadyTasksLists[ ( pxTCB )->uxPriority ] ), &( ( pxTCB )->xStateListItem ) )
+
+    #define taskPREEMPTS_CURRENT( pxTCB )    ( ( pxTCB )->uxPriority > taskPREEMPTION_LEVEL( pxCurrentTCB ) )
+
+#endif /* configUSE_EDF_SCHEDULING */
+
 /*-----------------------------------------------------------*/
 
 /*
  * Place the task represented by pxTCB into the appropriate ready list for
- * the task.  It is inserted at the end of the list.
+ * the task.  It is inserted at the end of the list, or by deadline at
+ * configEDF_PRIORITY.
  */
-#define prvAddTaskToReadyList( pxTCB )                                                                 \
-    traceMOVED_TASK_TO_READY_STATE( pxTCB );                                                           \
-    taskRECORD_READY_PRIORITY( ( pxTCB )->uxPriority );                                                \
-    listINSERT_END( &( pxReadyTasksLists[ ( pxTCB )->uxPriority ] ), &( ( pxTCB )->xStateListItem ) ); \
+#define prvAddTaskToReadyList( pxTCB )                  \
+    traceMOVED_TASK_TO_READY_STATE( pxTCB );            \
+    taskRECORD_READY_PRIORITY( ( pxTCB )->uxPriority ); \
+    taskINSERT_READY( pxTCB );                          \
     tracePOST_MOVED_TASK_TO_READY_STATE( pxTCB )
 /*-----------------------------------------------------------*/
 
@@ -318,6 +411,31 @@ typedef struct tskTaskControlBlock       /* The old naming convention is used to
     #if ( configUSE_POSIX_ERRNO == 1 )
         int iTaskErrno;
     #endif
+
+    #if ( configUSE_EDF_SCHEDULING == 1 )
+        TickType_t xEdfPeriod;           /*< Shortest time between the releases of two jobs. */
+        TickType_t xEdfRelativeDeadline; /*< Time a job has to complete after its release, 0 if the task is not scheduled by deadline. */
+        TickType_t xEdfRelease;          /*< Release time of the current job. */
+        TickType_t xEdfDeadline;         /*< Absolute deadline of the current job. */
+        uint8_t ucEdfJobDone;            /*< Set when the task blocks, so the next time it is made ready may release a new job. */
+    #endif
+
+    #if ( configUSE_TASK_BUDGETS == 1 )
+        uint32_t ulBudget;                          /*< Run time the task may use per budget period, in run time counter units, 0 for no limit. */
+        uint32_t ulBudgetUsed;                      /*< Run time used in the current budget period, up to the last time the task was switched out. */
+        uint32_t ulBudgetExhausted;                 /*< Times the task used up its budget. */
+        TickType_t xBudgetPeriod;                   /*< Ticks between replenishments of the budget. */
+        TickType_t xBudgetReplenish;                /*< Tick count at which the current budget period ends. */
+        UBaseType_t uxBudgetPriority;               /*< Priority to return to when the budget is replenished. */
+        struct tskTaskControlBlock * pxBudgetNext;  /*< Next task with a budget. */
+        uint8_t ucBudgetDemoted;                    /*< Set while the task runs at configBUDGET_DEMOTED_PRIORITY. */
+    #endif
+
+    #if ( configUSE_PREEMPTION_THRESHOLDS == 1 )
+        UBaseType_t uxPreemptionThreshold;             /*< Tasks of this priority or below do not preempt the task once it runs, 0 for no threshold. */
+        struct tskTaskControlBlock * pxPreemptedNext;  /*< Next task in pxPreemptedTasks. */
+        uint8_t ucPreempted;                           /*< Set while the task is in pxPreemptedTasks. */
+    #endif
 } tskTCB;
 
 /* The old tskTCB name is maintained above then typedefed to the new TCB_t name
@@ -333,12 +451,56 @@ portDONT_DISCARD PRIVILEGED_DATA TCB_t * volatile pxCurrentTCB = NULL;
  * doing so breaks some kernel aware debuggers and debuggers that rely on removing
  * the static qualifier. */
 PRIVILEGED_DATA static List_t pxReadyTasksLists[ configMAX_PRIORITIES ]; /*< Prioritised ready tasks. */
-PRIVILEGED_DATA static List_t xDelayedTaskList1;                         /*< Delayed tasks. */
-PRIVILEGED_DATA static List_t xDelayedTaskList2;                         /*< Delayed tasks (two lists are used - one for delays that have overflowed the current tick count. */
-PRIVILEGED_DATA static List_t * volatile pxDelayedTaskList;              /*< Points to the delayed task list currently being used. */
-PRIVILEGED_DATA static List_t * volatile pxOverflowDelayedTaskList;      /*< Points to the delayed task list currently being used to hold tasks that have overflowed the current tick count. */
+
+#if ( configUSE_TIMING_WHEEL == 1 )
+
+/* Delayed tasks in a hierarchical timing wheel instead of two lists sorted by
+ * wake time, so that blocking takes the same time however many tasks are
+ * delayed.  Level 0 has a slot per tick, and each slot of level n spans a
+ * whole turn of level n - 1.  A task goes in the slot of its wake time in the
+ * lowest level whose current turn holds it, or in the far list if none does.
+ * The lists are not sorted.  The tasks of a slot are moved down when the tick
+ * count reaches the start of the slot, and those of a slot of level 0 are
+ * unblocked.  The far list is looked at at the start of every turn of the last
+ * level. */
+    #define taskWHEEL_SLOTS        ( ( UBaseType_t ) 1U << configTIMING_WHEEL_BITS )
+    #define taskWHEEL_SLOT_MASK    ( ( TickType_t ) taskWHEEL_SLOTS - ( TickType_t ) 1U )
+    #define taskWHEEL_FAR          ( ( UBaseType_t ) configTIMING_WHEEL_LEVELS * taskWHEEL_SLOTS )
+    #define taskWHEEL_TURN_MASK    ( ( ( TickType_t ) 1U << ( configTIMING_WHEEL_BITS * configTIMING_WHEEL_LEVELS ) ) - ( TickType_t ) 1U )
+
+    #if ( ( configUSE_16_BIT_TICKS == 1 ) && ( ( configTIMING_WHEEL_BITS * configTIMING_WHEEL_LEVELS ) >= 16 ) ) || ( ( configTIMING_WHEEL_BITS * configTIMING_WHEEL_LEVELS ) >= 32 )
+        #error A turn of the timing wheel must be shorter than the range of the tick count
+    #endif
+
+    PRIVILEGED_DATA static List_t xWheel[ taskWHEEL_FAR + 1U ]; /*< The slots of level 0, then those of level 1 and so on, then the far list. */
+
+/* Whether pxList is one of the lists of the timing wheel. */
+    #define taskIS_WHEEL_LIST( pxList )    ( ( ( pxList ) >= &( xWheel[ 0 ] ) ) && ( ( pxList ) <= &( xWheel[ taskWHEEL_FAR ] ) ) )
+
+#else /* configUSE_TIMING_WHEEL */
+
+    PRIVILEGED_DATA static List_t xDelayedTaskList1;                    /*< Delayed tasks. */
+    PRIVILEGED_DATA static List_t xDelayedTaskList2;                    /*< Delayed tasks (two lists are used - one for delays that have overflowed the current tick count. */
+    PRIVILEGED_DATA static List_t * volatile pxDelayedTaskList;         /*< Points to the delayed task list currently being used. */
+    PRIVILEGED_DATA static List_t * volatile pxOverflowDelayedTaskList; /*< Points to the delayed task list currently being used to hold tasks that have overflowed the current tick count. */
+
+#endif /* configUSE_TIMING_WHEEL */
+
 PRIVILEGED_DATA static List_t xPendingReadyList;                         /*< Tasks that have been readied while the scheduler was suspended.  They will be moved to the ready list when the scheduler is resumed. */
 
+#if ( configUSE_TASK_BUDGETS == 1 )
+
+    PRIVILEGED_DATA static TCB_t * pxBudgetTasks = NULL;                      /*< Tasks given a budget, linked through pxBudgetNext. */
+    PRIVILEGED_DATA static volatile TickType_t xNextBudgetReplenish = ( TickType_t ) 0U; /*< The earliest xBudgetReplenish of those tasks. */
+
+#endif
+
+#if ( configUSE_PREEMPTION_THRESHOLDS == 1 )
+
+    PRIVILEGED_DATA static TCB_t * pxPreemptedTasks = NULL; /*< Tasks with a threshold that were preempted, the last one first, linked through pxPreemptedNext. */
+
+#endif
+
 #if ( INCLUDE_vTaskDelete == 1 )
 
     PRIVILEGED_DATA static List_t xTasksWaitingTermination; /*< Tasks that have been deleted - but their memory not yet freed. */
@@ -516,6 +678,90 @@ static void prvAddCurrentTaskToDelayedList( TickType_t xTicksToWait,
  */
 static void prvResetNextTaskUnblockTime( void ) PRIVILEGED_FUNCTION;
 
+#if ( configUSE_TIMING_WHEEL == 1 )
+
+/*
+ * Returns the list of the timing wheel for a task due at xTimeToWake, given
+ * the tick count, and in pxServiceTime the tick count at which that list has
+ * to be looked at.
+ */
+    static List_t * prvWheelListFor( const TickType_t xTimeToWake,
+                                     const TickType_t xConstTickCount,
+                                     TickType_t * const pxServiceTime ) PRIVILEGED_FUNCTION;
+
+/*
+ * Adds the state list item of a task entering the Blocked state to the timing
+ * wheel, and brings xNextTaskUnblockTime forward if needed.
+ */
+    static void prvWheelInsert( ListItem_t * const pxStateListItem,
+                                const TickType_t xConstTickCount ) PRIVILEGED_FUNCTION;
+
+/*
+ * Called when the tick count reaches xNextTaskUnblockTime.  Moves the tasks of
+ * the slots whose start the tick count reached down the wheel, and returns the
+ * slot of level 0 holding the tasks that are due now.
+ */
+    static List_t * prvWheelAdvance( const TickType_t xConstTickCount ) PRIVILEGED_FUNCTION;
+
+#endif /* configUSE_TIMING_WHEEL */
+
+#if ( configUSE_EDF_SCHEDULING == 1 )
+
+/*
+ * Adds a task to its ready list.  At configEDF_PRIORITY the list is kept sorted
+ * by deadline, and a task that blocked since its last job was released may get
+ * a new job with a new deadline first.
+ */
+    static void prvAddTaskToReadyListByDeadline( TCB_t * const pxTCB ) PRIVILEGED_FUNCTION;
+
+#endif
+
+#if ( configUSE_TASK_BUDGETS == 1 )
+
+/*
+ * Whether a task that has used ulUsed of its budget is to be demoted now.  A
+ * task holding a mutex is only demoted once it gives back the last one, so
+ * the tasks waiting for it are not held up.
+ */
+    static BaseType_t prvBudgetExhausted( const TCB_t * const pxTCB,
+                                          const uint32_t ulUsed ) PRIVILEGED_FUNCTION;
+
+/*
+ * Moves a task to another priority, from any state.
+ */
+    static void prvBudgetSetPriority( TCB_t * const pxTCB,
+                                      const UBaseType_t uxNewPriority ) PRIVILEGED_FUNCTION;
+
+/*
+ * Demotes a task that used up its budget to configBUDGET_DEMOTED_PRIORITY.
+ */
+    static void prvBudgetDemote( TCB_t * const pxTCB ) PRIVILEGED_FUNCTION;
+
+/*
+ * Returns a demoted task to the priority it had.
+ */
+    static void prvBudgetRestore( TCB_t * const pxTCB ) PRIVILEGED_FUNCTION;
+
+/*
+ * Replenishes the budgets whose period ended at or before the tick count, and
+ * returns pdTRUE if a task that goes back to its priority should preempt the
+ * running task.
+ */
+    static BaseType_t prvBudgetReplenish( const TickType_t xConstTickCount ) PRIVILEGED_FUNCTION;
+
+#endif /* configUSE_TASK_BUDGETS */
+
+#if ( configUSE_PREEMPTION_THRESHOLDS == 1 )
+
+/*
+ * Called by vTaskSwitchContext() after it selected the highest priority ready
+ * task.  If that task is not above the threshold of a preempted task, the
+ * preempted task resumes instead.
+ */
+    static void prvSelectPreemptedTask( void ) PRIVILEGED_FUNCTION;
+
+#endif /* configUSE_PREEMPTION_THRESHOLDS */
+
 #if ( configUSE_STATS_FORMATTING_FUNCTIONS > 0 )
 
 /*
@@ -1056,7 +1302,7 @@ static void prvAddNewTaskToReadyList( TCB_t * pxNewTCB )
              * so far. */
             if( xSchedulerRunning == pdFALSE )
             {
-                if( pxCurrentTCB->uxPriority <= pxNewTCB->uxPriority )
+                if( taskPREEMPTION_LEVEL( pxCurrentTCB ) <= pxNewTCB->uxPriority )
                 {
                     pxCurrentTCB = pxNewTCB;
                 }
@@ -1091,7 +1337,7 @@ static void prvAddNewTaskToReadyList( TCB_t * pxNewTCB )
     {
         /* If the created task is of a higher priority than the current task
          * then it should run now. */
-        if( pxCurrentTCB->uxPriority < pxNewTCB->uxPriority )
+        if( taskPREEMPTS_CURRENT( pxNewTCB ) )
         {
             taskYIELD_IF_USING_PREEMPTION();
         }
@@ -1139,6 +1385,45 @@ static void prvAddNewTaskToReadyList( TCB_t * pxNewTCB )
                 mtCOVERAGE_TEST_MARKER();
             }
 
+            #if ( configUSE_TASK_BUDGETS == 1 )
+            {
+                TCB_t ** ppxBudgetTCB;
+
+                /* Take it out of the tasks with a budget, if it is one. */
+                for( ppxBudgetTCB = &pxBudgetTasks; *ppxBudgetTCB != NULL; ppxBudgetTCB = &( ( *ppxBudgetTCB )->pxBudgetNext ) )
+                {
+                    if( *ppxBudgetTCB == pxTCB )
+                    {
+                        *ppxBudgetTCB = pxTCB->pxBudgetNext;
+                        break;
+                    }
+                    else
+                    {
+                        mtCOVERAGE_TEST_MARKER();
+                    }
+                }
+            }
+            #endif /* configUSE_TASK_BUDGETS */
+
+            #if ( configUSE_PREEMPTION_THRESHOLDS == 1 )
+            {
+                TCB_t ** ppxPreemptedTCB;
+
+                if( pxTCB->ucPreempted != ( uint8_t ) pdFALSE )
+                {
+                    for( ppxPreemptedTCB = &pxPreemptedTasks; *ppxPreemptedTCB != pxTCB; ppxPreemptedTCB = &( ( *ppxPreemptedTCB )->pxPreemptedNext ) )
+                    {
+                    }
+
+                    *ppxPreemptedTCB = pxTCB->pxPreemptedNext;
+                }
+                else
+                {
+                    mtCOVERAGE_TEST_MARKER();
+                }
+            }
+            #endif /* configUSE_PREEMPTION_THRESHOLDS */
+
             /* Increment the uxTaskNumber also so kernel aware debuggers can
              * detect that the task lists need re-generating.  This is done before
              * portPRE_TASK_DELETE_HOOK() as in the Windows port that macro will
@@ -1347,8 +1632,11 @@ static void prvAddNewTaskToReadyList( TCB_t * pxNewTCB )
     {
         eTaskState eReturn;
         List_t const * pxStateList;
-        List_t const * pxDelayedList;
-        List_t const * pxOverflowedDelayedList;
+
+        #if ( configUSE_TIMING_WHEEL == 0 )
+            List_t const * pxDelayedList;
+            List_t const * pxOverflowedDelayedList;
+        #endif
         const TCB_t * const pxTCB = xTask;
 
         configASSERT( pxTCB );
@@ -1363,12 +1651,21 @@ static void prvAddNewTaskToReadyList( TCB_t * pxNewTCB )
             taskENTER_CRITICAL();
             {
                 pxStateList = listLIST_ITEM_CONTAINER( &( pxTCB->xStateListItem ) );
-                pxDelayedList = pxDelayedTaskList;
-                pxOverflowedDelayedList = pxOverflowDelayedTaskList;
+
+                #if ( configUSE_TIMING_WHEEL == 0 )
+                {
+                    pxDelayedList = pxDelayedTaskList;
+                    pxOverflowedDelayedList = pxOverflowDelayedTaskList;
+                }
+                #endif
             }
             taskEXIT_CRITICAL();
 
-            if( ( pxStateList == pxDelayedList ) || ( pxStateList == pxOverflowedDelayedList ) )
+            #if ( configUSE_TIMING_WHEEL == 1 )
+                if( taskIS_WHEEL_LIST( pxStateList ) != pdFALSE )
+            #else
+                if( ( pxStateList == pxDelayedList ) || ( pxStateList == pxOverflowedDelayedList ) )
+            #endif
             {
                 /* The task being queried is referenced from one of the Blocked
                  * lists. */
@@ -1550,16 +1847,9 @@ static void prvAddNewTaskToReadyList( TCB_t * pxNewTCB )
                     if( pxTCB != pxCurrentTCB )
                     {
                         /* The priority of a task other than the currently
-                         * running task is being raised.  Is the priority being
-                         * raised above that of the running task? */
-                        if( uxNewPriority >= pxCurrentTCB->uxPriority )
-                        {
-                            xYieldRequired = pdTRUE;
-                        }
-                        else
-                        {
-                            mtCOVERAGE_TEST_MARKER();
-                        }
+                         * running task is being raised.  Whether it now
+                         * preempts the running task is known once it is in the
+                         * ready list of its new priority, below. */
                     }
                     else
                     {
@@ -1642,6 +1932,15 @@ static void prvAddNewTaskToReadyList( TCB_t * pxNewTCB )
                     }
 
                     prvAddTaskToReadyList( pxTCB );
+
+                    if( ( pxTCB != pxCurrentTCB ) && taskPREEMPTS_CURRENT( pxTCB ) )
+                    {
+                        xYieldRequired = pdTRUE;
+                    }
+                    else
+                    {
+                        mtCOVERAGE_TEST_MARKER();
+                    }
                 }
                 else
                 {
@@ -1668,107 +1967,283 @@ static void prvAddNewTaskToReadyList( TCB_t * pxNewTCB )
 #endif /* INCLUDE_vTaskPrioritySet */
 /*-----------------------------------------------------------*/
 
-#if ( INCLUDE_vTaskSuspend == 1 )
+#if ( configUSE_EDF_SCHEDULING == 1 )
 
-    void vTaskSuspend( TaskHandle_t xTaskToSuspend )
+    void vTaskSetEdfParameters( TaskHandle_t xTask,
+                                TickType_t xPeriod,
+                                TickType_t xRelativeDeadline )
     {
         TCB_t * pxTCB;
+        TickType_t xConstTickCount;
 
         taskENTER_CRITICAL();
         {
-            /* If null is passed in here then it is the running task that is
-             * being suspended. */
-            pxTCB = prvGetTCBFromHandle( xTaskToSuspend );
+            pxTCB = prvGetTCBFromHandle( xTask );
+            xConstTickCount = xTickCount;
 
-            traceTASK_SUSPEND( pxTCB );
+            pxTCB->xEdfPeriod = xPeriod;
+            pxTCB->xEdfRelativeDeadline = xRelativeDeadline;
 
-            /* Remove task from the ready/delayed list and place in the
-             * suspended list. */
-            if( uxListRemove( &( pxTCB->xStateListItem ) ) == ( UBaseType_t ) 0 )
+            /* The first job is released the next time the task is made ready,
+             * or now if it is ready. */
+            pxTCB->xEdfRelease = xConstTickCount - xPeriod;
+            pxTCB->xEdfDeadline = xConstTickCount;
+            pxTCB->ucEdfJobDone = ( uint8_t ) pdTRUE;
+
+            if( listIS_CONTAINED_WITHIN( &( pxReadyTasksLists[ pxTCB->uxPriority ] ), &( pxTCB->xStateListItem ) ) != pdFALSE )
             {
-                taskRESET_READY_PRIORITY( pxTCB->uxPriority );
+                /* Move it to its place by the new deadline. */
+                if( uxListRemove( &( pxTCB->xStateListItem ) ) == ( UBaseType_t ) 0 )
+                {
+                    portRESET_READY_PRIORITY( pxTCB->uxPriority, uxTopReadyPriority );
+                }
+                else
+                {
+                    mtCOVERAGE_TEST_MARKER();
+                }
+
+                prvAddTaskToReadyList( pxTCB );
+
+                if( xSchedulerRunning != pdFALSE )
+                {
+                    taskYIELD_IF_USING_PREEMPTION();
+                }
+                else
+                {
+                    mtCOVERAGE_TEST_MARKER();
+                }
             }
             else
             {
                 mtCOVERAGE_TEST_MARKER();
             }
+        }
+        taskEXIT_CRITICAL();
+    }
 
-            /* Is the task waiting on an event also? */
-            if( listLIST_ITEM_CONTAINER( &( pxTCB->xEventListItem ) ) != NULL )
+#endif /* configUSE_EDF_SCHEDULING */
+/*-----------------------------------------------------------*/
+
+#if ( configUSE_TASK_BUDGETS == 1 )
+
+    void vTaskSetCpuBudget( TaskHandle_t xTask,
+                            uint32_t ulBudget,
+                            TickType_t xPeriod )
+    {
+        TCB_t * pxTCB;
+        TCB_t * pxOther;
+
+        configASSERT( ( ulBudget == 0U ) || ( xPeriod > ( TickType_t ) 0U ) );
+
+        taskENTER_CRITICAL();
+        {
+            pxTCB = prvGetTCBFromHandle( xTask );
+
+            /* Tasks stay in the list once added, one without a budget is
+             * never demoted. */
+            for( pxOther = pxBudgetTasks; ( pxOther != NULL ) && ( pxOther != pxTCB ); pxOther = pxOther->pxBudgetNext )
             {
-                ( void ) uxListRemove( &( pxTCB->xEventListItem ) );
+            }
+
+            if( pxOther == NULL )
+            {
+                pxTCB->pxBudgetNext = pxBudgetTasks;
+                pxBudgetTasks = pxTCB;
             }
             else
             {
                 mtCOVERAGE_TEST_MARKER();
             }
 
-            vListInsertEnd( &xSuspendedTaskList, &( pxTCB->xStateListItem ) );
+            /* The first period starts now. */
+            pxTCB->ulBudget = ulBudget;
+            pxTCB->ulBudgetUsed = 0U;
+            pxTCB->xBudgetPeriod = xPeriod;
+            pxTCB->xBudgetReplenish = xTickCount + xPeriod;
 
-            #if ( configUSE_TASK_NOTIFICATIONS == 1 )
+            if( ulBudget == 0U )
             {
-                BaseType_t x;
-
-                for( x = 0; x < configTASK_NOTIFICATION_ARRAY_ENTRIES; x++ )
-                {
-                    if( pxTCB->ucNotifyState[ x ] == taskWAITING_NOTIFICATION )
-                    {
-                        /* The task was blocked to wait for a notification, but is
-                         * now suspended, so no notification was received. */
-                        pxTCB->ucNotifyState[ x ] = taskNOT_WAITING_NOTIFICATION;
-                    }
-                }
+                mtCOVERAGE_TEST_MARKER();
             }
-            #endif /* if ( configUSE_TASK_NOTIFICATIONS == 1 ) */
-        }
-        taskEXIT_CRITICAL();
-
-        if( xSchedulerRunning != pdFALSE )
-        {
-            /* Reset the next expected unblock time in case it referred to the
-             * task that is now in the Suspended state. */
-            taskENTER_CRITICAL();
+            else if( ( pxOther == NULL ) && ( pxTCB->pxBudgetNext == NULL ) )
             {
-                prvResetNextTaskUnblockTime();
+                /* The only task with a budget. */
+                xNextBudgetReplenish = pxTCB->xBudgetReplenish;
             }
-            taskEXIT_CRITICAL();
-        }
-        else
-        {
-            mtCOVERAGE_TEST_MARKER();
-        }
-
-        if( pxTCB == pxCurrentTCB )
-        {
-            if( xSchedulerRunning != pdFALSE )
+            else if( taskTICK_BEFORE( pxTCB->xBudgetReplenish, xNextBudgetReplenish ) != pdFALSE )
             {
-                /* The current task has just been suspended. */
-                configASSERT( uxSchedulerSuspended == 0 );
-                portYIELD_WITHIN_API();
+                xNextBudgetReplenish = pxTCB->xBudgetReplenish;
             }
             else
             {
-                /* The scheduler is not running, but the task that was pointed
-                 * to by pxCurrentTCB has just been suspended and pxCurrentTCB
-                 * must be adjusted to point to a different task. */
-                if( listCURRENT_LIST_LENGTH( &xSuspendedTaskList ) == uxCurrentNumberOfTasks ) /*lint !e931 Right has no side effect, just volatile. */
+                mtCOVERAGE_TEST_MARKER();
+            }
+
+            if( pxTCB->ucBudgetDemoted != ( uint8_t ) pdFALSE )
+            {
+                prvBudgetRestore( pxTCB );
+
+                if( xSchedulerRunning != pdFALSE )
                 {
-                    /* No other tasks are ready, so set pxCurrentTCB back to
-                     * NULL so when the next task is created pxCurrentTCB will
-                     * be set to point to it no matter what its relative priority
-                     * is. */
-                    pxCurrentTCB = NULL;
+                    taskYIELD_IF_USING_PREEMPTION();
                 }
                 else
                 {
-                    vTaskSwitchContext();
+                    mtCOVERAGE_TEST_MARKER();
                 }
             }
+            else
+            {
+                mtCOVERAGE_TEST_MARKER();
+            }
+        }
+        taskEXIT_CRITICAL();
+    }
+/*-----------------------------------------------------------*/
+
+    uint32_t ulTaskGetCpuBudgetExhausted( TaskHandle_t xTask )
+    {
+        const TCB_t * const pxTCB = prvGetTCBFromHandle( xTask );
+
+        return pxTCB->ulBudgetExhausted;
+    }
+
+#endif /* configUSE_TASK_BUDGETS */
+/*-----------------------------------------------------------*/
+
+#if ( configUSE_PREEMPTION_THRESHOLDS == 1 )
+
+    void vTaskSetPreemptionThreshold( TaskHandle_t xTask,
+                                      UBaseType_t uxThreshold )
+    {
+        TCB_t * pxTCB;
+
+        configASSERT( uxThreshold < ( UBaseType_t ) configMAX_PRIORITIES );
+
+        taskENTER_CRITICAL();
+        {
+            pxTCB = prvGetTCBFromHandle( xTask );
+            pxTCB->uxPreemptionThreshold = uxThreshold;
+
+            /* A lower threshold may let a ready task preempt the running one.
+             * A task that is preempted now gets the new threshold when it
+             * resumes. */
+            if( ( pxTCB == pxCurrentTCB ) && ( xSchedulerRunning != pdFALSE ) )
+            {
+                taskYIELD_IF_USING_PREEMPTION();
+            }
+            else
+            {
+                mtCOVERAGE_TEST_MARKER();
+            }
+        }
+        taskEXIT_CRITICAL();
+    }
+
+#endif /* configUSE_PREEMPTION_THRESHOLDS */
+/*-----------------------------------------------------------*/
+
+#if ( INCLUDE_vTaskSuspend == 1 )
+
+    void vTaskSuspend( TaskHandle_t xTaskToSuspend )
+    {
+        TCB_t * pxTCB;
+
+        taskENTER_CRITICAL();
+        {
+            /* If null is passed in here then it is the running task that is
+             * being suspended. */
+            pxTCB = prvGetTCBFromHandle( xTaskToSuspend );
+
+            traceTASK_SUSPEND( pxTCB );
+
+            /* Remove task from the ready/delayed list and place in the
+             * suspended list. */
+            if( uxListRemove( &( pxTCB->xStateListItem ) ) == ( UBaseType_t ) 0 )
+            {
+                taskRESET_READY_PRIORITY( pxTCB->uxPriority );
+            }
+            else
+            {
+                mtCOVERAGE_TEST_MARKER();
+            }
+
+            /* Is the task waiting on an event also? */
+            if( listLIST_ITEM_CONTAINER( &( pxTCB->xEventListItem ) ) != NULL )
+            {
+                ( void ) uxListRemove( &( pxTCB->xEventListItem ) );
+            }
+            else
+            {
+                mtCOVERAGE_TEST_MARKER();
+            }
+
+            vListInsertEnd( &xSuspendedTaskList, &( pxTCB->xStateListItem ) );
+
+            #if ( configUSE_TASK_NOTIFICATIONS == 1 )
+            {
+                BaseType_t x;
+
+                for( x = 0; x < configTASK_NOTIFICATION_ARRAY_ENTRIES; x++ )
+                {
+                    if( pxTCB->ucNotifyState[ x ] == taskWAITING_NOTIFICATION )
+                    {
+                        /* The task was blocked to wait for a notification, but is
+                         * now suspended, so no notification was received. */
+                        pxTCB->ucNotifyState[ x ] = taskNOT_WAITING_NOTIFICATION;
+                    }
+                }
+            }
+            #endif /* if ( configUSE_TASK_NOTIFICATIONS == 1 ) */
+        }
+        taskEXIT_CRITICAL();
+
+        if( xSchedulerRunning != pdFALSE )
+        {
+            /* Reset the next expected unblock time in case it referred to the
+             * task that is now in the Suspended state. */
+            taskENTER_CRITICAL();
+            {
+                prvResetNextTaskUnblockTime();
+            }
+            taskEXIT_CRITICAL();
+        }
+        else
+        {
+            mtCOVERAGE_TEST_MARKER();
+        }
+
+        if( pxTCB == pxCurrentTCB )
+        {
+            if( xSchedulerRunning != pdFALSE )
+            {
+                /* The current task has just been suspended. */
+                configASSERT( uxSchedulerSuspended == 0 );
+                portYIELD_WITHIN_API();
+            }
+            else
+            {
+                /* The scheduler is not running, but the task that was pointed
+                 * to by pxCurrentTCB has just been suspended and pxCurrentTCB
+                 * must be adjusted to point to a different task. */
+                if( listCURRENT_LIST_LENGTH( &xSuspendedTaskList ) == uxCurrentNumberOfTasks ) /*lint !e931 Right has no side effect, just volatile. */
+                {
+                    /* No other tasks are ready, so set pxCurrentTCB back to
+                     * NULL so when the next task is created pxCurrentTCB will
+                     * be set to point to it no matter what its relative priority
+                     * is. */
+                    pxCurrentTCB = NULL;
+                }
+                else
+                {
+                    vTaskSwitchContext();
+                }
+            }
+        }
+        else
+        {
+            mtCOVERAGE_TEST_MARKER();
         }
-        else
-        {
-            mtCOVERAGE_TEST_MARKER();
-        }
     }
 
 #endif /* INCLUDE_vTaskSuspend */
@@ -1845,7 +2320,7 @@ static void prvAddNewTaskToReadyList( TCB_t * pxNewTCB )
                     prvAddTaskToReadyList( pxTCB );
 
                     /* A higher priority task may have just been resumed. */
-                    if( pxTCB->uxPriority >= pxCurrentTCB->uxPriority )
+                    if( taskPREEMPTS_CURRENT( pxTCB ) )
                     {
                         /* This yield may not cause the task just resumed to run,
                          * but will leave the lists in the correct state for the
@@ -1912,8 +2387,13 @@ static void prvAddNewTaskToReadyList( TCB_t * pxNewTCB )
                 if( uxSchedulerSuspended == ( UBaseType_t ) pdFALSE )
                 {
                     /* Ready lists can be accessed so move the task from the
-                     * suspended list to the ready list directly. */
-                    if( pxTCB->uxPriority >= pxCurrentTCB->uxPriority )
+                     * suspended list to the ready list directly.  It is
+                     * compared with the running task once it is in the ready
+                     * list, where it gets its deadline if it has one. */
+                    ( void ) uxListRemove( &( pxTCB->xStateListItem ) );
+                    prvAddTaskToReadyList( pxTCB );
+
+                    if( taskPREEMPTS_CURRENT( pxTCB ) )
                     {
                         xYieldRequired = pdTRUE;
 
@@ -1926,9 +2406,6 @@ static void prvAddNewTaskToReadyList( TCB_t * pxNewTCB )
                     {
                         mtCOVERAGE_TEST_MARKER();
                     }
-
-                    ( void ) uxListRemove( &( pxTCB->xStateListItem ) );
-                    prvAddTaskToReadyList( pxTCB );
                 }
                 else
                 {
@@ -2203,9 +2680,9 @@ BaseType_t xTaskResumeAll( void )
                     listREMOVE_ITEM( &( pxTCB->xStateListItem ) );
                     prvAddTaskToReadyList( pxTCB );
 
-                    /* If the moved task has a priority higher than or equal to
-                     * the current task then a yield must be performed. */
-                    if( pxTCB->uxPriority >= pxCurrentTCB->uxPriority )
+                    /* If the moved task preempts the current task then a yield
+                     * must be performed. */
+                    if( taskPREEMPTS_CURRENT( pxTCB ) )
                     {
                         xYieldPending = pdTRUE;
                     }
@@ -2446,15 +2923,28 @@ char * pcTaskGetName( TaskHandle_t xTaskToQuery ) /*lint !e971 Unqualified char
             } while( uxQueue > ( UBaseType_t ) tskIDLE_PRIORITY ); /*lint !e961 MISRA exception as the casts are only redundant for some ports. */
 
             /* Search the delayed lists. */
-            if( pxTCB == NULL )
+            #if ( configUSE_TIMING_WHEEL == 1 )
             {
-                pxTCB = prvSearchForNameWithinSingleList( ( List_t * ) pxDelayedTaskList, pcNameToQuery );
-            }
+                UBaseType_t uxList;
 
-            if( pxTCB == NULL )
+                for( uxList = 0U; ( uxList <= taskWHEEL_FAR ) && ( pxTCB == NULL ); uxList++ )
+                {
+                    pxTCB = prvSearchForNameWithinSingleList( &( xWheel[ uxList ] ), pcNameToQuery );
+                }
+            }
+            #else
             {
-                pxTCB = prvSearchForNameWithinSingleList( ( List_t * ) pxOverflowDelayedTaskList, pcNameToQuery );
+                if( pxTCB == NULL )
+                {
+                    pxTCB = prvSearchForNameWithinSingleList( ( List_t * ) pxDelayedTaskList, pcNameToQuery );
+                }
+
+                if( pxTCB == NULL )
+                {
+                    pxTCB = prvSearchForNameWithinSingleList( ( List_t * ) pxOverflowDelayedTaskList, pcNameToQuery );
+                }
             }
+            #endif /* configUSE_TIMING_WHEEL */
 
             #if ( INCLUDE_vTaskSuspend == 1 )
             {
@@ -2507,8 +2997,21 @@ char * pcTaskGetName( TaskHandle_t xTaskToQuery ) /*lint !e971 Unqualified char
 
                 /* Fill in an TaskStatus_t structure with information on each
                  * task in the Blocked state. */
-                uxTask += prvListTasksWithinSingleList( &( pxTaskStatusArray[ uxTask ] ), ( List_t * ) pxDelayedTaskList, eBlocked );
-                uxTask += prvListTasksWithinSingleList( &( pxTaskStatusArray[ uxTask ] ), ( List_t * ) pxOverflowDelayedTaskList, eBlocked );
+                #if ( configUSE_TIMING_WHEEL == 1 )
+                {
+                    UBaseType_t uxList;
+
+                    for( uxList = 0U; uxList <= taskWHEEL_FAR; uxList++ )
+                    {
+                        uxTask += prvListTasksWithinSingleList( &( pxTaskStatusArray[ uxTask ] ), &( xWheel[ uxList ] ), eBlocked );
+                    }
+                }
+                #else
+                {
+                    uxTask += prvListTasksWithinSingleList( &( pxTaskStatusArray[ uxTask ] ), ( List_t * ) pxDelayedTaskList, eBlocked );
+                    uxTask += prvListTasksWithinSingleList( &( pxTaskStatusArray[ uxTask ] ), ( List_t * ) pxOverflowDelayedTaskList, eBlocked );
+                }
+                #endif /* configUSE_TIMING_WHEEL */
 
                 #if ( INCLUDE_vTaskDelete == 1 )
                 {
@@ -2691,7 +3194,7 @@ BaseType_t xTaskCatchUpTicks( TickType_t xTicksToCatchUp )
                     /* Preemption is on, but a context switch should only be
                      * performed if the unblocked task has a priority that is
                      * higher than the currently executing task. */
-                    if( pxTCB->uxPriority > pxCurrentTCB->uxPriority )
+                    if( taskPREEMPTS_CURRENT( pxTCB ) )
                     {
                         /* Pend the yield to be performed when the scheduler
                          * is unsuspended. */
@@ -2753,16 +3256,33 @@ BaseType_t xTaskIncrementTick( void )
          * look any further down the list. */
         if( xConstTickCount >= xNextTaskUnblockTime )
         {
+            #if ( configUSE_TIMING_WHEEL == 1 )
+                /* Only the slot of this tick holds tasks due now. */
+                List_t * const pxDueList = prvWheelAdvance( xConstTickCount );
+            #else
+                List_t * const pxDueList = pxDelayedTaskList;
+            #endif
+
             for( ; ; )
             {
-                if( listLIST_IS_EMPTY( pxDelayedTaskList ) != pdFALSE )
+                if( listLIST_IS_EMPTY( pxDueList ) != pdFALSE )
                 {
-                    /* The delayed list is empty.  Set xNextTaskUnblockTime
-                     * to the maximum possible value so it is extremely
-                     * unlikely that the
-                     * if( xTickCount >= xNextTaskUnblockTime ) test will pass
-                     * next time through. */
-                    xNextTaskUnblockTime = portMAX_DELAY; /*lint !e961 MISRA exception as the casts are only redundant for some ports. */
+                    #if ( configUSE_TIMING_WHEEL == 1 )
+                    {
+                        /* The next tasks to unblock or move are in the
+                         * other lists of the wheel. */
+                        prvResetNextTaskUnblockTime();
+                    }
+                    #else
+                    {
+                        /* The delayed list is empty.  Set xNextTaskUnblockTime
+                         * to the maximum possible value so it is extremely
+                         * unlikely that the
+                         * if( xTickCount >= xNextTaskUnblockTime ) test will pass
+                         * next time through. */
+                        xNextTaskUnblockTime = portMAX_DELAY; /*lint !e961 MISRA exception as the casts are only redundant for some ports. */
+                    }
+                    #endif /* configUSE_TIMING_WHEEL */
                     break;
                 }
                 else
@@ -2771,7 +3291,7 @@ BaseType_t xTaskIncrementTick( void )
                      * item at the head of the delayed list.  This is the time
                      * at which the task at the head of the delayed list must
                      * be removed from the Blocked state. */
-                    pxTCB = listGET_OWNER_OF_HEAD_ENTRY( pxDelayedTaskList ); /*lint !e9079 void * is used as this macro is used with timers and co-routines too.  Alignment is known to be fine as the type of the pointer stored and retrieved is the same. */
+                    pxTCB = listGET_OWNER_OF_HEAD_ENTRY( pxDueList ); /*lint !e9079 void * is used as this macro is used with timers and co-routines too.  Alignment is known to be fine as the type of the pointer stored and retrieved is the same. */
                     xItemValue = listGET_LIST_ITEM_VALUE( &( pxTCB->xStateListItem ) );
 
                     if( xConstTickCount < xItemValue )
@@ -2819,7 +3339,7 @@ BaseType_t xTaskIncrementTick( void )
                          * processing time (which happens when both
                          * preemption and time slicing are on) is
                          * handled below.*/
-                        if( pxTCB->uxPriority > pxCurrentTCB->uxPriority )
+                        if( taskPREEMPTS_CURRENT( pxTCB ) )
                         {
                             xSwitchRequired = pdTRUE;
                         }
@@ -2838,9 +3358,22 @@ BaseType_t xTaskIncrementTick( void )
          * writer has not explicitly turned time slicing off. */
         #if ( ( configUSE_PREEMPTION == 1 ) && ( configUSE_TIME_SLICING == 1 ) )
         {
-            if( listCURRENT_LIST_LENGTH( &( pxReadyTasksLists[ pxCurrentTCB->uxPriority ] ) ) > ( UBaseType_t ) 1 )
+            #if ( configUSE_EDF_SCHEDULING == 1 )
+                /* The tasks scheduled by deadline do not take turns. */
+                if( ( listCURRENT_LIST_LENGTH( &( pxReadyTasksLists[ pxCurrentTCB->uxPriority ] ) ) > ( UBaseType_t ) 1 ) &&
+                    ( pxCurrentTCB->uxPriority != ( UBaseType_t ) configEDF_PRIORITY ) )
+            #else
+                if( listCURRENT_LIST_LENGTH( &( pxReadyTasksLists[ pxCurrentTCB->uxPriority ] ) ) > ( UBaseType_t ) 1 )
+            #endif
             {
-                xSwitchRequired = pdTRUE;
+                /* A task with a preemption threshold keeps the processor until
+                 * it blocks or a task above the threshold is ready. */
+                #if ( configUSE_PREEMPTION_THRESHOLDS == 1 )
+                    if( taskHAS_THRESHOLD( pxCurrentTCB ) == pdFALSE )
+                #endif
+                {
+                    xSwitchRequired = pdTRUE;
+                }
             }
             else
             {
@@ -2849,6 +3382,53 @@ BaseType_t xTaskIncrementTick( void )
         }
         #endif /* ( ( configUSE_PREEMPTION == 1 ) && ( configUSE_TIME_SLICING == 1 ) ) */
 
+        #if ( configUSE_TASK_BUDGETS == 1 )
+        {
+            if( ( pxBudgetTasks != NULL ) && ( taskTICK_BEFORE( xConstTickCount, xNextBudgetReplenish ) == pdFALSE ) )
+            {
+                if( prvBudgetReplenish( xConstTickCount ) != pdFALSE )
+                {
+                    xSwitchRequired = pdTRUE;
+                }
+                else
+                {
+                    mtCOVERAGE_TEST_MARKER();
+                }
+            }
+            else
+            {
+                mtCOVERAGE_TEST_MARKER();
+            }
+
+            /* A task that does not block is switched out by the tick once it
+             * used up its budget. */
+            if( ( pxCurrentTCB->ulBudget != 0U ) && ( pxCurrentTCB->ucBudgetDemoted == ( uint8_t ) pdFALSE ) )
+            {
+                configRUN_TIME_COUNTER_TYPE ulNow;
+
+                #ifdef portALT_GET_RUN_TIME_COUNTER_VALUE
+                    portALT_GET_RUN_TIME_COUNTER_VALUE( ulNow );
+                #else
+                    ulNow = portGET_RUN_TIME_COUNTER_VALUE();
+                #endif
+
+                if( prvBudgetExhausted( pxCurrentTCB, pxCurrentTCB->ulBudgetUsed + ( uint32_t ) ( ulNow - ulTaskSwitchedInTime ) ) != pdFALSE )
+                {
+                    prvBudgetDemote( pxCurrentTCB );
+                    xSwitchRequired = pdTRUE;
+                }
+                else
+                {
+                    mtCOVERAGE_TEST_MARKER();
+                }
+            }
+            else
+            {
+                mtCOVERAGE_TEST_MARKER();
+            }
+        }
+        #endif /* configUSE_TASK_BUDGETS */
+
         #if ( configUSE_TICK_HOOK == 1 )
         {
             /* Guard against the tick hook being called when the pended tick
@@ -3037,6 +3617,12 @@ void vTaskSwitchContext( void )
             if( ulTotalRunTime > ulTaskSwitchedInTime )
             {
                 pxCurrentTCB->ulRunTimeCounter += ( ulTotalRunTime - ulTaskSwitchedInTime );
+
+                #if ( configUSE_TASK_BUDGETS == 1 )
+                {
+                    pxCurrentTCB->ulBudgetUsed += ( uint32_t ) ( ulTotalRunTime - ulTaskSwitchedInTime );
+                }
+                #endif
             }
             else
             {
@@ -3047,6 +3633,21 @@ void vTaskSwitchContext( void )
         }
         #endif /* configGENERATE_RUN_TIME_STATS */
 
+        #if ( configUSE_TASK_BUDGETS == 1 )
+        {
+            /* The task being switched out may have used up its budget since
+             * the last tick, demote it before the next task is picked. */
+            if( prvBudgetExhausted( pxCurrentTCB, pxCurrentTCB->ulBudgetUsed ) != pdFALSE )
+            {
+                prvBudgetDemote( pxCurrentTCB );
+            }
+            else
+            {
+                mtCOVERAGE_TEST_MARKER();
+            }
+        }
+        #endif /* configUSE_TASK_BUDGETS */
+
         /* Check for stack overflow, if configured. */
         taskCHECK_FOR_STACK_OVERFLOW();
 
@@ -3057,9 +3658,42 @@ void vTaskSwitchContext( void )
         }
         #endif
 
+        #if ( configUSE_PREEMPTION_THRESHOLDS == 1 )
+        {
+            /* A task with a threshold that is switched out while still ready
+             * was preempted, or yielded.  It is remembered so that it resumes
+             * before the tasks at or below its threshold. */
+            if( ( taskHAS_THRESHOLD( pxCurrentTCB ) != pdFALSE ) &&
+                ( listIS_CONTAINED_WITHIN( &( pxReadyTasksLists[ pxCurrentTCB->uxPriority ] ), &( pxCurrentTCB->xStateListItem ) ) != pdFALSE ) )
+            {
+                pxCurrentTCB->pxPreemptedNext = pxPreemptedTasks;
+                pxPreemptedTasks = pxCurrentTCB;
+                pxCurrentTCB->ucPreempted = ( uint8_t ) pdTRUE;
+            }
+            else
+            {
+                mtCOVERAGE_TEST_MARKER();
+            }
+        }
+        #endif /* configUSE_PREEMPTION_THRESHOLDS */
+
         /* Select a new task to run using either the generic C or port
          * optimised asm code. */
         taskSELECT_HIGHEST_PRIORITY_TASK(); /*lint !e9079 void * is used as this macro is used with timers and co-routines too.  Alignment is known to be fine as the type of the pointer stored and retrieved is the same. */
+
+        #if ( configUSE_PREEMPTION_THRESHOLDS == 1 )
+        {
+            if( pxPreemptedTasks != NULL )
+            {
+                prvSelectPreemptedTask();
+            }
+            else
+            {
+                mtCOVERAGE_TEST_MARKER();
+            }
+        }
+        #endif /* configUSE_PREEMPTION_THRESHOLDS */
+
         traceTASK_SWITCHED_IN();
 
         /* After the new task is switched in, update the global errno. */
@@ -3214,7 +3848,7 @@ BaseType_t xTaskRemoveFromEventList( const List_t * const pxEventList )
         listINSERT_END( &( xPendingReadyList ), &( pxUnblockedTCB->xEventListItem ) );
     }
 
-    if( pxUnblockedTCB->uxPriority > pxCurrentTCB->uxPriority )
+    if( taskPREEMPTS_CURRENT( pxUnblockedTCB ) )
     {
         /* Return true if the task removed from the event list has a higher
          * priority than the calling task.  This allows the calling task to know if
@@ -3272,7 +3906,7 @@ void vTaskRemoveFromUnorderedEventList( ListItem_t * pxEventListItem,
     listREMOVE_ITEM( &( pxUnblockedTCB->xStateListItem ) );
     prvAddTaskToReadyList( pxUnblockedTCB );
 
-    if( pxUnblockedTCB->uxPriority > pxCurrentTCB->uxPriority )
+    if( taskPREEMPTS_CURRENT( pxUnblockedTCB ) )
     {
         /* The unblocked task has a priority above that of the calling task, so
          * a context switch is required.  This function is called with the
@@ -3663,8 +4297,22 @@ static void prvInitialiseTaskLists( void )
         vListInitialise( &( pxReadyTasksLists[ uxPriority ] ) );
     }
 
-    vListInitialise( &xDelayedTaskList1 );
-    vListInitialise( &xDelayedTaskList2 );
+    #if ( configUSE_TIMING_WHEEL == 1 )
+    {
+        UBaseType_t uxList;
+
+        for( uxList = ( UBaseType_t ) 0U; uxList <= taskWHEEL_FAR; uxList++ )
+        {
+            vListInitialise( &( xWheel[ uxList ] ) );
+        }
+    }
+    #else
+    {
+        vListInitialise( &xDelayedTaskList1 );
+        vListInitialise( &xDelayedTaskList2 );
+    }
+    #endif
+
     vListInitialise( &xPendingReadyList );
 
     #if ( INCLUDE_vTaskDelete == 1 )
@@ -3679,10 +4327,14 @@ static void prvInitialiseTaskLists( void )
     }
     #endif /* INCLUDE_vTaskSuspend */
 
-    /* Start with pxDelayedTaskList using list1 and the pxOverflowDelayedTaskList
-     * using list2. */
-    pxDelayedTaskList = &xDelayedTaskList1;
-    pxOverflowDelayedTaskList = &xDelayedTaskList2;
+    #if ( configUSE_TIMING_WHEEL == 0 )
+    {
+        /* Start with pxDelayedTaskList using list1 and the pxOverflowDelayedTaskList
+         * using list2. */
+        pxDelayedTaskList = &xDelayedTaskList1;
+        pxOverflowDelayedTaskList = &xDelayedTaskList2;
+    }
+    #endif
 }
 /*-----------------------------------------------------------*/
 
@@ -3996,17 +4648,192 @@ static void prvCheckTasksWaitingTermination( void )
 #endif /* INCLUDE_vTaskDelete */
 /*-----------------------------------------------------------*/
 
-static void prvResetNextTaskUnblockTime( void )
-{
-    if( listLIST_IS_EMPTY( pxDelayedTaskList ) != pdFALSE )
+#if ( configUSE_TIMING_WHEEL == 1 )
+
+    static void prvResetNextTaskUnblockTime( void )
     {
-        /* The new current delayed list is empty.  Set xNextTaskUnblockTime to
-         * the maximum possible value so it is  extremely unlikely that the
-         * if( xTickCount >= xNextTaskUnblockTime ) test will pass until
-         * there is an item in the delayed list. */
-        xNextTaskUnblockTime = portMAX_DELAY;
-    }
-    else
+        const TickType_t xConstTickCount = xTickCount;
+        TickType_t xNextTime = portMAX_DELAY;
+        BaseType_t xFound = pdFALSE;
+        UBaseType_t uxLevel;
+        UBaseType_t uxShift;
+        UBaseType_t uxSlot;
+
+        /* The slots of a level come before those of the level above, so the
+         * first list to look at is the first one that is not empty after the
+         * slot of the tick count in the lowest level that has one.  That is at
+         * most configTIMING_WHEEL_LEVELS turns of a single level to check. */
+        for( uxLevel = 0U; ( uxLevel < ( UBaseType_t ) configTIMING_WHEEL_LEVELS ) && ( xFound == pdFALSE ); uxLevel++ )
+        {
+            uxShift = uxLevel * ( UBaseType_t ) configTIMING_WHEEL_BITS;
+
+            for( uxSlot = ( UBaseType_t ) ( ( xConstTickCount >> uxShift ) & taskWHEEL_SLOT_MASK ) + 1U; uxSlot < taskWHEEL_SLOTS; uxSlot++ )
+            {
+                if( listLIST_IS_EMPTY( &( xWheel[ ( uxLevel * taskWHEEL_SLOTS ) + uxSlot ] ) ) == pdFALSE )
+                {
+                    /* The start of the slot, in the current turn of the
+                     * level. */
+                    xNextTime = ( xConstTickCount & ~( ( ( TickType_t ) taskWHEEL_SLOTS << uxShift ) - ( TickType_t ) 1U ) ) + ( ( TickType_t ) uxSlot << uxShift );
+                    xFound = pdTRUE;
+                    break;
+                }
+            }
+        }
+
+        if( ( xFound == pdFALSE ) && ( listLIST_IS_EMPTY( &( xWheel[ taskWHEEL_FAR ] ) ) == pdFALSE ) )
+        {
+            /* The start of the next turn of the last level.  If the tick count
+             * overflows first, taskSWITCH_DELAYED_LISTS() takes care of it. */
+            xNextTime = ( xConstTickCount | taskWHEEL_TURN_MASK ) + ( TickType_t ) 1U;
+
+            if( xNextTime == ( TickType_t ) 0U )
+            {
+                xNextTime = portMAX_DELAY;
+            }
+        }
+
+        xNextTaskUnblockTime = xNextTime;
+    }
+/*-----------------------------------------------------------*/
+
+    static List_t * prvWheelListFor( const TickType_t xTimeToWake,
+                                     const TickType_t xConstTickCount,
+                                     TickType_t * const pxServiceTime )
+    {
+        List_t * pxList = &( xWheel[ taskWHEEL_FAR ] );
+        UBaseType_t uxLevel;
+        UBaseType_t uxShift;
+
+        /* Unless it is due in the current turn of the last level, the task
+         * waits in the far list until the next turn starts. */
+        *pxServiceTime = ( xConstTickCount | taskWHEEL_TURN_MASK ) + ( TickType_t ) 1U;
+
+        if( *pxServiceTime == ( TickType_t ) 0U )
+        {
+            *pxServiceTime = portMAX_DELAY;
+        }
+
+        /* A wake time that overflowed is due after the tick count overflows,
+         * so it waits in the far list whatever its low bits are, as it would
+         * wait in the overflow list with the sorted lists.  Otherwise it could
+         * land in a slot the tick count has already passed in this turn. */
+        for( uxLevel = 0U; ( uxLevel < ( UBaseType_t ) configTIMING_WHEEL_LEVELS ) && ( xTimeToWake >= xConstTickCount ); uxLevel++ )
+        {
+            uxShift = uxLevel * ( UBaseType_t ) configTIMING_WHEEL_BITS;
+
+            if( ( ( xTimeToWake ^ xConstTickCount ) >> ( uxShift + ( UBaseType_t ) configTIMING_WHEEL_BITS ) ) == ( TickType_t ) 0U )
+            {
+                /* Due in the current turn of this level.  The slot is looked
+                 * at when the tick count reaches its start. */
+                *pxServiceTime = xTimeToWake & ~( ( ( TickType_t ) 1U << uxShift ) - ( TickType_t ) 1U );
+                pxList = &( xWheel[ ( uxLevel * taskWHEEL_SLOTS ) + ( UBaseType_t ) ( ( xTimeToWake >> uxShift ) & taskWHEEL_SLOT_MASK ) ] );
+                break;
+            }
+        }
+
+        return pxList;
+    }
+/*-----------------------------------------------------------*/
+
+    static void prvWheelInsert( ListItem_t * const pxStateListItem,
+                                const TickType_t xConstTickCount )
+    {
+        List_t * pxList;
+        TickType_t xServiceTime;
+
+        /* The slot of the current tick was emptied when the tick count got
+         * there, so a task that does not wait at all is woken on the next tick,
+         * as it would be with the sorted lists. */
+        if( listGET_LIST_ITEM_VALUE( pxStateListItem ) == xConstTickCount )
+        {
+            listSET_LIST_ITEM_VALUE( pxStateListItem, xConstTickCount + ( TickType_t ) 1U );
+        }
+
+        pxList = prvWheelListFor( listGET_LIST_ITEM_VALUE( pxStateListItem ), xConstTickCount, &xServiceTime );
+        listINSERT_END( pxList, pxStateListItem );
+
+        if( xServiceTime < xNextTaskUnblockTime )
+        {
+            xNextTaskUnblockTime = xServiceTime;
+        }
+        else
+        {
+            mtCOVERAGE_TEST_MARKER();
+        }
+    }
+/*-----------------------------------------------------------*/
+
+    static List_t * prvWheelAdvance( const TickType_t xConstTickCount )
+    {
+        UBaseType_t uxLevel = 0U;
+        List_t * pxList;
+        List_t * pxTarget;
+        ListItem_t * pxItem;
+        ListItem_t * pxNextItem;
+        TickType_t xServiceTime;
+
+        /* Find the highest level the tick count is at the start of a slot of,
+         * the far list counting as a level above the last one. */
+        while( ( uxLevel < ( UBaseType_t ) configTIMING_WHEEL_LEVELS ) &&
+               ( ( xConstTickCount & ( ( ( TickType_t ) 1U << ( ( uxLevel + 1U ) * ( UBaseType_t ) configTIMING_WHEEL_BITS ) ) - ( TickType_t ) 1U ) ) == ( TickType_t ) 0U ) )
+        {
+            uxLevel++;
+        }
+
+        /* Move the tasks of those slots down from the top, so a task can go
+         * down more than one level on the same tick.  A task always goes to a
+         * lower level, except those in the far list that are not due in the new
+         * turn, which stay where they are. */
+        while( uxLevel > 0U )
+        {
+            if( uxLevel == ( UBaseType_t ) configTIMING_WHEEL_LEVELS )
+            {
+                pxList = &( xWheel[ taskWHEEL_FAR ] );
+            }
+            else
+            {
+                pxList = &( xWheel[ ( uxLevel * taskWHEEL_SLOTS ) + ( UBaseType_t ) ( ( xConstTickCount >> ( uxLevel * ( UBaseType_t ) configTIMING_WHEEL_BITS ) ) & taskWHEEL_SLOT_MASK ) ] );
+            }
+
+            pxItem = listGET_HEAD_ENTRY( pxList );
+
+            while( pxItem != listGET_END_MARKER( pxList ) )
+            {
+                pxNextItem = listGET_NEXT( pxItem );
+                pxTarget = prvWheelListFor( listGET_LIST_ITEM_VALUE( pxItem ), xConstTickCount, &xServiceTime );
+
+                if( pxTarget != pxList )
+                {
+                    listREMOVE_ITEM( pxItem );
+                    listINSERT_END( pxTarget, pxItem );
+                }
+                else
+                {
+                    mtCOVERAGE_TEST_MARKER();
+                }
+
+                pxItem = pxNextItem;
+            }
+
+            uxLevel--;
+        }
+
+        return &( xWheel[ xConstTickCount & taskWHEEL_SLOT_MASK ] );
+    }
+
+#else /* configUSE_TIMING_WHEEL */
+
+static void prvResetNextTaskUnblockTime( void )
+{
+    if( listLIST_IS_EMPTY( pxDelayedTaskList ) != pdFALSE )
+    {
+        /* The new current delayed list is empty.  Set xNextTaskUnblockTime to
+         * the maximum possible value so it is  extremely unlikely that the
+         * if( xTickCount >= xNextTaskUnblockTime ) test will pass until
+         * there is an item in the delayed list. */
+        xNextTaskUnblockTime = portMAX_DELAY;
+    }
+    else
     {
         /* The new current delayed list is not empty, get the value of
          * the item at the head of the delayed list.  This is the time at
@@ -4015,6 +4842,335 @@ static void prvResetNextTaskUnblockTime( void )
         xNextTaskUnblockTime = listGET_ITEM_VALUE_OF_HEAD_ENTRY( pxDelayedTaskList );
     }
 }
+
+#endif /* configUSE_TIMING_WHEEL */
+/*-----------------------------------------------------------*/
+
+#if ( configUSE_EDF_SCHEDULING == 1 )
+
+    static void prvAddTaskToReadyListByDeadline( TCB_t * const pxTCB )
+    {
+        List_t * const pxList = &( pxReadyTasksLists[ pxTCB->uxPriority ] );
+        ListItem_t * const pxNewListItem = &( pxTCB->xStateListItem );
+        const TickType_t xConstTickCount = xTickCount;
+        ListItem_t * pxIterator;
+        TickType_t xDeadline;
+
+        if( pxTCB->uxPriority != ( UBaseType_t ) configEDF_PRIORITY )
+        {
+            listINSERT_END( pxList, pxNewListItem );
+        }
+        else
+        {
+            if( pxTCB->xEdfRelativeDeadline == ( TickType_t ) 0U )
+            {
+                /* A task without a deadline at this priority, most likely one
+                 * that inherited it from a task waiting for its mutex, runs as
+                 * if its deadline were now. */
+                xDeadline = xConstTickCount;
+            }
+            else
+            {
+                if( pxTCB->ucEdfJobDone != ( uint8_t ) pdFALSE )
+                {
+                    pxTCB->ucEdfJobDone = ( uint8_t ) pdFALSE;
+
+                    /* The task blocked since its current job was released.  If
+                     * it woke before the deadline it is still in that job, and
+                     * blocked on the way on a mutex or a full queue.  If not,
+                     * this is a new job, released now but no sooner than a
+                     * period after the last one. */
+                    if( taskTICK_BEFORE( xConstTickCount, pxTCB->xEdfDeadline ) == pdFALSE )
+                    {
+                        pxTCB->xEdfRelease += pxTCB->xEdfPeriod;
+
+                        if( taskTICK_BEFORE( pxTCB->xEdfRelease, xConstTickCount ) != pdFALSE )
+                        {
+                            pxTCB->xEdfRelease = xConstTickCount;
+                        }
+                        else
+                        {
+                            mtCOVERAGE_TEST_MARKER();
+                        }
+
+                        pxTCB->xEdfDeadline = pxTCB->xEdfRelease + pxTCB->xEdfRelativeDeadline;
+                    }
+                    else
+                    {
+                        mtCOVERAGE_TEST_MARKER();
+                    }
+                }
+                else
+                {
+                    mtCOVERAGE_TEST_MARKER();
+                }
+
+                xDeadline = pxTCB->xEdfDeadline;
+            }
+
+            listSET_LIST_ITEM_VALUE( pxNewListItem, xDeadline );
+
+            /* After the tasks with an earlier or the same deadline.  vListInsert()
+             * cannot be used as the deadlines are compared allowing for the
+             * tick count overflowing. */
+            pxIterator = ( ListItem_t * ) &( pxList->xListEnd ); /*lint !e826 !e740 !e9087 The mini list structure is used as the list end to save RAM.  This is checked and valid. */
+
+            while( ( pxIterator->pxNext != ( ListItem_t * ) &( pxList->xListEnd ) ) &&
+                   ( taskTICK_BEFORE( xDeadline, listGET_LIST_ITEM_VALUE( pxIterator->pxNext ) ) == pdFALSE ) ) /*lint !e826 !e740 !e9087 */
+            {
+                pxIterator = pxIterator->pxNext;
+            }
+
+            pxNewListItem->pxNext = pxIterator->pxNext;
+            pxNewListItem->pxNext->pxPrevious = pxNewListItem;
+            pxNewListItem->pxPrevious = pxIterator;
+            pxIterator->pxNext = pxNewListItem;
+            pxNewListItem->pxContainer = pxList;
+
+            ( pxList->uxNumberOfItems )++;
+        }
+    }
+
+#endif /* configUSE_EDF_SCHEDULING */
+/*-----------------------------------------------------------*/
+
+#if ( configUSE_TASK_BUDGETS == 1 )
+
+    static BaseType_t prvBudgetExhausted( const TCB_t * const pxTCB,
+                                          const uint32_t ulUsed )
+    {
+        BaseType_t xReturn = pdFALSE;
+
+        if( ( pxTCB->ulBudget != 0U ) &&
+            ( pxTCB->ucBudgetDemoted == ( uint8_t ) pdFALSE ) &&
+            ( ulUsed >= pxTCB->ulBudget ) )
+        {
+            #if ( configUSE_MUTEXES == 1 )
+                if( pxTCB->uxMutexesHeld == ( UBaseType_t ) 0U )
+            #endif
+            {
+                xReturn = pdTRUE;
+            }
+        }
+        else
+        {
+            mtCOVERAGE_TEST_MARKER();
+        }
+
+        return xReturn;
+    }
+/*-----------------------------------------------------------*/
+
+    static void prvBudgetSetPriority( TCB_t * const pxTCB,
+                                      const UBaseType_t uxNewPriority )
+    {
+        const UBaseType_t uxOldPriority = pxTCB->uxPriority;
+
+        /* As in vTaskPrioritySet(). */
+        if( ( listGET_LIST_ITEM_VALUE( &( pxTCB->xEventListItem ) ) & taskEVENT_LIST_ITEM_VALUE_IN_USE ) == 0UL )
+        {
+            listSET_LIST_ITEM_VALUE( &( pxTCB->xEventListItem ), ( ( TickType_t ) configMAX_PRIORITIES - ( TickType_t ) uxNewPriority ) ); /*lint !e961 MISRA exception as the casts are only redundant for some ports. */
+        }
+        else
+        {
+            mtCOVERAGE_TEST_MARKER();
+        }
+
+        pxTCB->uxPriority = uxNewPriority;
+
+        if( listIS_CONTAINED_WITHIN( &( pxReadyTasksLists[ uxOldPriority ] ), &( pxTCB->xStateListItem ) ) != pdFALSE )
+        {
+            if( uxListRemove( &( pxTCB->xStateListItem ) ) == ( UBaseType_t ) 0 )
+            {
+                portRESET_READY_PRIORITY( uxOldPriority, uxTopReadyPriority );
+            }
+            else
+            {
+                mtCOVERAGE_TEST_MARKER();
+            }
+
+            prvAddTaskToReadyList( pxTCB );
+        }
+        else
+        {
+            mtCOVERAGE_TEST_MARKER();
+        }
+    }
+/*-----------------------------------------------------------*/
+
+    static void prvBudgetDemote( TCB_t * const pxTCB )
+    {
+        pxTCB->ucBudgetDemoted = ( uint8_t ) pdTRUE;
+        ( pxTCB->ulBudgetExhausted )++;
+
+        /* The task holds no mutex, so its priority is its base priority.  The
+         * base priority is lowered too, so that inheriting and then giving
+         * back a mutex while demoted leaves it demoted. */
+        #if ( configUSE_MUTEXES == 1 )
+        {
+            pxTCB->uxBudgetPriority = pxTCB->uxBasePriority;
+            pxTCB->uxBasePriority = ( UBaseType_t ) configBUDGET_DEMOTED_PRIORITY;
+        }
+        #else
+        {
+            pxTCB->uxBudgetPriority = pxTCB->uxPriority;
+        }
+        #endif
+
+        prvBudgetSetPriority( pxTCB, ( UBaseType_t ) configBUDGET_DEMOTED_PRIORITY );
+    }
+/*-----------------------------------------------------------*/
+
+    static void prvBudgetRestore( TCB_t * const pxTCB )
+    {
+        pxTCB->ucBudgetDemoted = ( uint8_t ) pdFALSE;
+
+        #if ( configUSE_MUTEXES == 1 )
+        {
+            /* It may hold a mutex now, and run at a priority it inherited. */
+            pxTCB->uxBasePriority = pxTCB->uxBudgetPriority;
+
+            if( pxTCB->uxPriority < pxTCB->uxBudgetPriority )
+            {
+                prvBudgetSetPriority( pxTCB, pxTCB->uxBudgetPriority );
+            }
+            else
+            {
+                mtCOVERAGE_TEST_MARKER();
+            }
+        }
+        #else
+        {
+            prvBudgetSetPriority( pxTCB, pxTCB->uxBudgetPriority );
+        }
+        #endif
+    }
+/*-----------------------------------------------------------*/
+
+    static BaseType_t prvBudgetReplenish( const TickType_t xConstTickCount )
+    {
+        TCB_t * pxTCB;
+        TickType_t xNext = xConstTickCount + ( portMAX_DELAY >> 1 );
+        BaseType_t xSwitchRequired = pdFALSE;
+        configRUN_TIME_COUNTER_TYPE ulNow;
+
+        for( pxTCB = pxBudgetTasks; pxTCB != NULL; pxTCB = pxTCB->pxBudgetNext )
+        {
+            if( pxTCB->ulBudget == 0U )
+            {
+                /* The budget was removed. */
+                mtCOVERAGE_TEST_MARKER();
+            }
+            else if( taskTICK_BEFORE( xConstTickCount, pxTCB->xBudgetReplenish ) == pdFALSE )
+            {
+                /* A period that ended while the tick was stopped is not made
+                 * up for, the next one starts now. */
+                pxTCB->xBudgetReplenish += pxTCB->xBudgetPeriod;
+
+                if( taskTICK_BEFORE( xConstTickCount, pxTCB->xBudgetReplenish ) == pdFALSE )
+                {
+                    pxTCB->xBudgetReplenish = xConstTickCount + pxTCB->xBudgetPeriod;
+                }
+                else
+                {
+                    mtCOVERAGE_TEST_MARKER();
+                }
+
+                if( pxTCB == pxCurrentTCB )
+                {
+                    /* The time it ran since it was switched in is added when it
+                     * is switched out, and belongs to the period that just
+                     * ended.  Start below 0 to cancel it, the counter wraps
+                     * back. */
+                    #ifdef portALT_GET_RUN_TIME_COUNTER_VALUE
+                        portALT_GET_RUN_TIME_COUNTER_VALUE( ulNow );
+                    #else
+                        ulNow = portGET_RUN_TIME_COUNTER_VALUE();
+                    #endif
+                    pxTCB->ulBudgetUsed = ( uint32_t ) ( ulTaskSwitchedInTime - ulNow );
+                }
+                else
+                {
+                    pxTCB->ulBudgetUsed = 0U;
+                }
+
+                if( pxTCB->ucBudgetDemoted != ( uint8_t ) pdFALSE )
+                {
+                    prvBudgetRestore( pxTCB );
+
+                    if( pxTCB->uxPriority > taskPREEMPTION_LEVEL( pxCurrentTCB ) )
+                    {
+                        xSwitchRequired = pdTRUE;
+                    }
+                    else
+                    {
+                        mtCOVERAGE_TEST_MARKER();
+                    }
+                }
+                else
+                {
+                    mtCOVERAGE_TEST_MARKER();
+                }
+            }
+            else
+            {
+                mtCOVERAGE_TEST_MARKER();
+            }
+
+            if( ( pxTCB->ulBudget != 0U ) && ( taskTICK_BEFORE( pxTCB->xBudgetReplenish, xNext ) != pdFALSE ) )
+            {
+                xNext = pxTCB->xBudgetReplenish;
+            }
+            else
+            {
+                mtCOVERAGE_TEST_MARKER();
+            }
+        }
+
+        xNextBudgetReplenish = xNext;
+
+        return xSwitchRequired;
+    }
+
+#endif /* configUSE_TASK_BUDGETS */
+/*-----------------------------------------------------------*/
+
+#if ( configUSE_PREEMPTION_THRESHOLDS == 1 )
+
+    static void prvSelectPreemptedTask( void )
+    {
+        TCB_t ** ppxTCB = &pxPreemptedTasks;
+        TCB_t * pxTCB;
+
+        /* The list is short, one entry per task with a threshold at most. */
+        while( *ppxTCB != NULL )
+        {
+            pxTCB = *ppxTCB;
+
+            if( ( listIS_CONTAINED_WITHIN( &( pxReadyTasksLists[ pxTCB->uxPriority ] ), &( pxTCB->xStateListItem ) ) == pdFALSE ) ||
+                ( taskHAS_THRESHOLD( pxTCB ) == pdFALSE ) )
+            {
+                /* It stopped being ready, or lost its threshold, while it was
+                 * preempted.  From now on it is selected as any other task. */
+                *ppxTCB = pxTCB->pxPreemptedNext;
+                pxTCB->ucPreempted = ( uint8_t ) pdFALSE;
+            }
+            else if( ( pxTCB == pxCurrentTCB ) ||
+                     ( pxCurrentTCB->uxPriority <= taskPREEMPTION_LEVEL( pxTCB ) ) )
+            {
+                *ppxTCB = pxTCB->pxPreemptedNext;
+                pxTCB->ucPreempted = ( uint8_t ) pdFALSE;
+                pxCurrentTCB = pxTCB;
+                break;
+            }
+            else
+            {
+                ppxTCB = &( pxTCB->pxPreemptedNext );
+            }
+        }
+    }
+
+#endif /* configUSE_PREEMPTION_THRESHOLDS */
 /*-----------------------------------------------------------*/
 
 #if ( ( INCLUDE_xTaskGetCurrentTaskHandle == 1 ) || ( configUSE_MUTEXES == 1 ) )
@@ -4943,7 +6099,7 @@ TickType_t uxTaskResetEventItemValue( void )
                 }
                 #endif
 
-                if( pxTCB->uxPriority > pxCurrentTCB->uxPriority )
+                if( taskPREEMPTS_CURRENT( pxTCB ) )
                 {
                     /* The notified task has a priority above the currently
                      * executing task so a yield is required. */
@@ -5078,7 +6234,7 @@ TickType_t uxTaskResetEventItemValue( void )
                     listINSERT_END( &( xPendingReadyList ), &( pxTCB->xEventListItem ) );
                 }
 
-                if( pxTCB->uxPriority > pxCurrentTCB->uxPriority )
+                if( taskPREEMPTS_CURRENT( pxTCB ) )
                 {
                     /* The notified task has a priority above the currently
                      * executing task so a yield is required. */
@@ -5169,7 +6325,7 @@ TickType_t uxTaskResetEventItemValue( void )
                     listINSERT_END( &( xPendingReadyList ), &( pxTCB->xEventListItem ) );
                 }
 
-                if( pxTCB->uxPriority > pxCurrentTCB->uxPriority )
+                if( taskPREEMPTS_CURRENT( pxTCB ) )
                 {
                     /* The notified task has a priority above the currently
                      * executing task so a yield is required. */
@@ -5309,6 +6465,13 @@ static void prvAddCurrentTaskToDelayedList( TickType_t xTicksToWait,
     }
     #endif
 
+    #if ( configUSE_EDF_SCHEDULING == 1 )
+    {
+        /* The job may be complete, see prvAddTaskToReadyListByDeadline(). */
+        pxCurrentTCB->ucEdfJobDone = ( uint8_t ) pdTRUE;
+    }
+    #endif
+
     /* Remove the task from the ready list before adding it to the blocked list
      * as the same list item is used for both lists. */
     if( uxListRemove( &( pxCurrentTCB->xStateListItem ) ) == ( UBaseType_t ) 0 )
@@ -5341,30 +6504,38 @@ static void prvAddCurrentTaskToDelayedList( TickType_t xTicksToWait,
             /* The list item will be inserted in wake time order. */
             listSET_LIST_ITEM_VALUE( &( pxCurrentTCB->xStateListItem ), xTimeToWake );
 
-            if( xTimeToWake < xConstTickCount )
+            #if ( configUSE_TIMING_WHEEL == 1 )
             {
-                /* Wake time has overflowed.  Place this item in the overflow
-                 * list. */
-                vListInsert( pxOverflowDelayedTaskList, &( pxCurrentTCB->xStateListItem ) );
+                prvWheelInsert( &( pxCurrentTCB->xStateListItem ), xConstTickCount );
             }
-            else
+            #else
             {
-                /* The wake time has not overflowed, so the current block list
-                 * is used. */
-                vListInsert( pxDelayedTaskList, &( pxCurrentTCB->xStateListItem ) );
-
-                /* If the task entering the blocked state was placed at the
-                 * head of the list of blocked tasks then xNextTaskUnblockTime
-                 * needs to be updated too. */
-                if( xTimeToWake < xNextTaskUnblockTime )
+                if( xTimeToWake < xConstTickCount )
                 {
-                    xNextTaskUnblockTime = xTimeToWake;
+                    /* Wake time has overflowed.  Place this item in the overflow
+                     * list. */
+                    vListInsert( pxOverflowDelayedTaskList, &( pxCurrentTCB->xStateListItem ) );
                 }
                 else
                 {
-                    mtCOVERAGE_TEST_MARKER();
+                    /* The wake time has not overflowed, so the current block list
+                     * is used. */
+                    vListInsert( pxDelayedTaskList, &( pxCurrentTCB->xStateListItem ) );
+
+                    /* If the task entering the blocked state was placed at the
+                     * head of the list of blocked tasks then xNextTaskUnblockTime
+                     * needs to be updated too. */
+                    if( xTimeToWake < xNextTaskUnblockTime )
+                    {
+                        xNextTaskUnblockTime = xTimeToWake;
+                    }
+                    else
+                    {
+                        mtCOVERAGE_TEST_MARKER();
+                    }
                 }
             }
+            #endif /* configUSE_TIMING_WHEEL */
         }
     }
     #else /* INCLUDE_vTaskSuspend */
@@ -5377,28 +6548,36 @@ static void prvAddCurrentTaskToDelayedList( TickType_t xTicksToWait,
         /* The list item will be inserted in wake time order. */
         listSET_LIST_ITEM_VALUE( &( pxCurrentTCB->xStateListItem ), xTimeToWake );
 
-        if( xTimeToWake < xConstTickCount )
+        #if ( configUSE_TIMING_WHEEL == 1 )
         {
-            /* Wake time has overflowed.  Place this item in the overflow list. */
-            vListInsert( pxOverflowDelayedTaskList, &( pxCurrentTCB->xStateListItem ) );
+            prvWheelInsert( &( pxCurrentTCB->xStateListItem ), xConstTickCount );
         }
-        else
+        #else
         {
-            /* The wake time has not overflowed, so the current block list is used. */
-            vListInsert( pxDelayedTaskList, &( pxCurrentTCB->xStateListItem ) );
-
-            /* If the task entering the blocked state was placed at the head of the
-             * list of blocked tasks then xNextTaskUnblockTime needs to be updated
-             * too. */
-            if( xTimeToWake < xNextTaskUnblockTime )
+            if( xTimeToWake < xConstTickCount )
             {
-                xNextTaskUnblockTime = xTimeToWake;
+                /* Wake time has overflowed.  Place this item in the overflow list. */
+                vListInsert( pxOverflowDelayedTaskList, &( pxCurrentTCB->xStateListItem ) );
             }
             else
             {
-                mtCOVERAGE_TEST_MARKER();
+                /* The wake time has not overflowed, so the current block list is used. */
+                vListInsert( pxDelayedTaskList, &( pxCurrentTCB->xStateListItem ) );
+
+                /* If the task entering the blocked state was placed at the head of the
+                 * list of blocked tasks then xNextTaskUnblockTime needs to be updated
+                 * too. */
+                if( xTimeToWake < xNextTaskUnblockTime )
+                {
+                    xNextTaskUnblockTime = xTimeToWake;
+                }
+                else
+                {
+                    mtCOVERAGE_TEST_MARKER();
+                }
             }
         }
+        #endif /* configUSE_TIMING_WHEEL */
 
         /* Avoid compiler warning when INCLUDE_vTaskSuspend is not 1. */
         ( void ) xCanBlockIndefinitely;
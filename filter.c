@@ -0,0 +1,330 @@
+/* Filter stage with selectable kernels sharing a circular sample history. */
+
+#include <stddef.h>
+
+#include "filter.h"
+
+/* Kernel operations. Window kernels (mean, median) implement vAdd and vRemove
+ * so the window can be slid and resized incrementally; the others leave them
+ * NULL and only look at the history from xOutput. */
+typedef struct {
+  void (*vReset)(Filter_t *pxFilter);
+  void (*vAdd)(Filter_t *pxFilter, int slot);
+  void (*vRemove)(Filter_t *pxFilter, int slot);
+  int (*xOutput)(Filter_t *pxFilter);
+} FilterKernel_t;
+
+/* Low pass FIR taps in Q15 (Hamming windowed sinc, cutoff 0.1 fs), newest
+ * sample first. They add up to 32768 so the DC gain is 1. */
+static const int16_t sFirTaps[FILTER_FIR_TAPS] = {
+    -114, -159, -139, 291,  1450, 3284, 5246, 6525,
+    6525, 5246, 3284, 1450, 291,  -139, -159, -114};
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Returns the buffer index of the sample received 'age' samples ago.
+ * @param pxFilter The filter.
+ * @param age 0 for the newest sample, up to MAX_FILTER_SIZE - 1.
+ * @return int Index into pxFilter->values.
+ */
+static int prvIndexOfAge(const Filter_t *pxFilter, int age) {
+  int index = pxFilter->head - 1 - age;
+  if (index < 0) {
+    index += MAX_FILTER_SIZE;
+  }
+  return index;
+}
+
+/*-----------------------------------------------------------*/
+/* Moving average kernel. */
+
+static void prvMeanReset(Filter_t *pxFilter) {
+  pxFilter->u.sum = 0;
+  for (int age = 0; age < pxFilter->N; age++) {
+    pxFilter->u.sum += pxFilter->values[prvIndexOfAge(pxFilter, age)];
+  }
+}
+
+static void prvMeanAdd(Filter_t *pxFilter, int slot) {
+  pxFilter->u.sum += pxFilter->values[slot];
+}
+
+static void prvMeanRemove(Filter_t *pxFilter, int slot) {
+  pxFilter->u.sum -= pxFilter->values[slot];
+}
+
+static int prvMeanOutput(Filter_t *pxFilter) {
+  return pxFilter->u.sum / pxFilter->N;
+}
+
+/*-----------------------------------------------------------*/
+/* Exponential moving average kernel. */
+
+static void prvEmaReset(Filter_t *pxFilter) {
+  pxFilter->u.ema = (long)pxFilter->values[prvIndexOfAge(pxFilter, 0)] << 15;
+}
+
+static int prvEmaOutput(Filter_t *pxFilter) {
+  /* alpha = 2 / (N + 1) in Q15. */
+  long alpha = 65536L / (pxFilter->N + 1);
+  long target = (long)pxFilter->values[prvIndexOfAge(pxFilter, 0)] << 15;
+
+  pxFilter->u.ema +=
+      (long)(((int64_t)alpha * (target - pxFilter->u.ema)) >> 15);
+  return (pxFilter->u.ema + (1L << 14)) >> 15;
+}
+
+/*-----------------------------------------------------------*/
+/* Sliding median kernel.
+ *
+ * The samples in the window are split in a max-heap with the lower half and a
+ * min-heap with the upper half, so the median is at the top of the heaps. The
+ * heaps store buffer indices, and pos[] maps each buffer index back to its
+ * heap position (offset by MAX_FILTER_SIZE for the upper heap) so that the
+ * sample leaving the window can be removed in O(log N). */
+
+static int prvHeapAbove(const Filter_t *pxFilter, int hi, int a, int b) {
+  return hi ? pxFilter->values[a] < pxFilter->values[b]
+            : pxFilter->values[a] > pxFilter->values[b];
+}
+
+static void prvHeapSet(Filter_t *pxFilter, int hi, int i, int slot) {
+  if (hi) {
+    pxFilter->u.median.hi[i] = slot;
+    pxFilter->u.median.pos[slot] = i + MAX_FILTER_SIZE;
+  } else {
+    pxFilter->u.median.lo[i] = slot;
+    pxFilter->u.median.pos[slot] = i;
+  }
+}
+
+static void prvHeapSiftUp(Filter_t *pxFilter, int hi, int i) {
+  FilterIndex_t *heap = hi ? pxFilter->u.median.hi : pxFilter->u.median.lo;
+  int slot = heap[i];
+
+  while (i > 0) {
+    int parent = (i - 1) / 2;
+    if (!prvHeapAbove(pxFilter, hi, slot, heap[parent])) {
+      break;
+    }
+    prvHeapSet(pxFilter, hi, i, heap[parent]);
+    i = parent;
+  }
+  prvHeapSet(pxFilter, hi, i, slot);
+}
+
+static void prvHeapSiftDown(Filter_t *pxFilter, int hi, int i) {
+  FilterIndex_t *heap = hi ? pxFilter->u.median.hi : pxFilter->u.median.lo;
+  int n = hi ? pxFilter->u.median.nhi : pxFilter->u.median.nlo;
+  int slot = heap[i];
+
+  for (;;) {
+    int child = 2 * i + 1;
+    if (child >= n) {
+      break;
+    }
+    if (child + 1 < n &&
+        prvHeapAbove(pxFilter, hi, heap[child + 1], heap[child])) {
+      child++;
+    }
+    if (!prvHeapAbove(pxFilter, hi, heap[child], slot)) {
+      break;
+    }
+    prvHeapSet(pxFilter, hi, i, heap[child]);
+    i = child;
+  }
+  prvHeapSet(pxFilter, hi, i, slot);
+}
+
+static void prvHeapPush(Filter_t *pxFilter, int hi, int slot) {
+  int i = hi ? pxFilter->u.median.nhi++ : pxFilter->u.median.nlo++;
+  prvHeapSet(pxFilter, hi, i, slot);
+  prvHeapSiftUp(pxFilter, hi, i);
+}
+
+static int prvHeapRemoveAt(Filter_t *pxFilter, int hi, int i) {
+  FilterIndex_t *heap = hi ? pxFilter->u.median.hi : pxFilter->u.median.lo;
+  int last = hi ? --pxFilter->u.median.nhi : --pxFilter->u.median.nlo;
+  int slot = heap[i];
+  int moved = heap[last];
+
+  /* Fill the hole with the last element and restore the heap order, which
+   * may require moving it either up or down. */
+  if (i != last) {
+    prvHeapSet(pxFilter, hi, i, moved);
+    prvHeapSiftUp(pxFilter, hi, i);
+    i = pxFilter->u.median.pos[moved] - (hi ? MAX_FILTER_SIZE : 0);
+    prvHeapSiftDown(pxFilter, hi, i);
+  }
+  return slot;
+}
+
+/* Keeps nlo == nhi or nlo == nhi + 1. */
+static void prvMedianBalance(Filter_t *pxFilter) {
+  if (pxFilter->u.median.nlo > pxFilter->u.median.nhi + 1) {
+    prvHeapPush(pxFilter, 1, prvHeapRemoveAt(pxFilter, 0, 0));
+  } else if (pxFilter->u.median.nhi > pxFilter->u.median.nlo) {
+    prvHeapPush(pxFilter, 0, prvHeapRemoveAt(pxFilter, 1, 0));
+  }
+}
+
+static void prvMedianAdd(Filter_t *pxFilter, int slot) {
+  int hi = pxFilter->u.median.nlo > 0 &&
+           pxFilter->values[slot] > pxFilter->values[pxFilter->u.median.lo[0]];
+  prvHeapPush(pxFilter, hi, slot);
+  prvMedianBalance(pxFilter);
+}
+
+static void prvMedianRemove(Filter_t *pxFilter, int slot) {
+  int pos = pxFilter->u.median.pos[slot];
+  if (pos >= MAX_FILTER_SIZE) {
+    prvHeapRemoveAt(pxFilter, 1, pos - MAX_FILTER_SIZE);
+  } else {
+    prvHeapRemoveAt(pxFilter, 0, pos);
+  }
+  prvMedianBalance(pxFilter);
+}
+
+static void prvMedianReset(Filter_t *pxFilter) {
+  pxFilter->u.median.nlo = 0;
+  pxFilter->u.median.nhi = 0;
+  for (int age = 0; age < pxFilter->N; age++) {
+    prvMedianAdd(pxFilter, prvIndexOfAge(pxFilter, age));
+  }
+}
+
+static int prvMedianOutput(Filter_t *pxFilter) {
+  int lower = pxFilter->values[pxFilter->u.median.lo[0]];
+  if (pxFilter->u.median.nlo > pxFilter->u.median.nhi) {
+    return lower;
+  }
+  return (lower + pxFilter->values[pxFilter->u.median.hi[0]]) / 2;
+}
+
+/*-----------------------------------------------------------*/
+/* Q15 FIR kernel. */
+
+static void prvFirReset(Filter_t *pxFilter) {}
+
+static int prvFirOutput(Filter_t *pxFilter) {
+  long acc = 0;
+  int index = prvIndexOfAge(pxFilter, 0);
+
+  for (int k = 0; k < FILTER_FIR_TAPS; k++) {
+    acc += (long)sFirTaps[k] * pxFilter->values[index];
+    index = (index == 0) ? MAX_FILTER_SIZE - 1 : index - 1;
+  }
+  return (acc + (1L << 14)) >> 15;
+}
+
+/*-----------------------------------------------------------*/
+
+static const FilterKernel_t xKernels[eFilterKindCount] = {
+    [eFilterMean] = {prvMeanReset, prvMeanAdd, prvMeanRemove, prvMeanOutput},
+    [eFilterEma] = {prvEmaReset, NULL, NULL, prvEmaOutput},
+    [eFilterMedian] = {prvMedianReset, prvMedianAdd, prvMedianRemove,
+                       prvMedianOutput},
+    [eFilterFir] = {prvFirReset, NULL, NULL, prvFirOutput},
+};
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Initializes the filter with an empty (all zero) history and the
+ * moving average kernel.
+ * @param pxFilter The filter to initialize.
+ * @param N Initial window size, clamped to [1, MAX_FILTER_SIZE].
+ */
+void vFilterInit(Filter_t *pxFilter, int N) {
+  for (int i = 0; i < MAX_FILTER_SIZE; i++) {
+    pxFilter->values[i] = 0;
+  }
+  pxFilter->head = 0;
+  pxFilter->N = 1;
+  vFilterSetKind(pxFilter, eFilterMean);
+  vFilterSetN(pxFilter, N);
+}
+
+/**
+ * @brief Changes the window size keeping the kernel state consistent.
+ *
+ * For window kernels, the older samples that enter the window when it grows
+ * are added and the samples that leave it when it shrinks are removed, so the
+ * cost is proportional to the change in N, not to the window size.
+ *
+ * @param pxFilter The filter.
+ * @param N New window size, clamped to [1, MAX_FILTER_SIZE].
+ */
+void vFilterSetN(Filter_t *pxFilter, int N) {
+  const FilterKernel_t *pxKernel = &xKernels[pxFilter->kind];
+
+  if (N < 1) {
+    N = 1;
+  } else if (N > MAX_FILTER_SIZE) {
+    N = MAX_FILTER_SIZE;
+  }
+
+  if (pxKernel->vAdd == NULL) {
+    pxFilter->N = N;
+    return;
+  }
+
+  while (pxFilter->N < N) {
+    pxKernel->vAdd(pxFilter, prvIndexOfAge(pxFilter, pxFilter->N));
+    pxFilter->N++;
+  }
+
+  while (pxFilter->N > N) {
+    pxFilter->N--;
+    pxKernel->vRemove(pxFilter, prvIndexOfAge(pxFilter, pxFilter->N));
+  }
+}
+
+/**
+ * @brief Selects the filter kernel, rebuilding its state from the history.
+ * @param pxFilter The filter.
+ * @param kind The kernel to use. Invalid values are ignored.
+ */
+void vFilterSetKind(Filter_t *pxFilter, FilterKind_t kind) {
+  if (kind >= eFilterKindCount) {
+    return;
+  }
+  pxFilter->kind = kind;
+  xKernels[kind].vReset(pxFilter);
+}
+
+/**
+ * @brief Adds a sample to the filter and returns the output of the active
+ * kernel.
+ * @param pxFilter The filter.
+ * @param value The new sample.
+ * @return int The filtered value.
+ */
+int xFilterProcess(Filter_t *pxFilter, int value) {
+  const FilterKernel_t *pxKernel = &xKernels[pxFilter->kind];
+  int slot = pxFilter->head;
+
+  /* The sample that leaves the window is the one received N samples ago. It
+   * must be removed before its slot can be overwritten when N is the maximum.
+   */
+  if (pxKernel->vRemove != NULL) {
+    int oldest = pxFilter->head - pxFilter->N;
+    if (oldest < 0) {
+      oldest += MAX_FILTER_SIZE;
+    }
+    pxKernel->vRemove(pxFilter, oldest);
+  }
+
+  pxFilter->values[slot] = value;
+  pxFilter->head++;
+  if (pxFilter->head == MAX_FILTER_SIZE) {
+    pxFilter->head = 0;
+  }
+
+  if (pxKernel->vAdd != NULL) {
+    pxKernel->vAdd(pxFilter, slot);
+  }
+
+  return pxKernel->xOutput(pxFilter);
+}
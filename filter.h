@@ -0,0 +1,60 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <stdint.h>
+
+/* Maximum size of the filter window. */
+#define MAX_FILTER_SIZE 50
+
+/* Number of taps of the FIR kernel. */
+#define FILTER_FIR_TAPS 16
+
+#if FILTER_FIR_TAPS > MAX_FILTER_SIZE
+#error "FILTER_FIR_TAPS must not be larger than MAX_FILTER_SIZE"
+#endif
+
+/* Index into the sample history. The median kernel also stores which of its
+ * two heaps a sample is in, so it needs room for 2 * MAX_FILTER_SIZE values. */
+#if (2 * MAX_FILTER_SIZE) <= 256
+typedef uint8_t FilterIndex_t;
+#else
+typedef uint16_t FilterIndex_t;
+#endif
+
+/* Available filter kernels. Per-sample cost is bounded for all of them:
+ * mean and EMA are O(1), median is O(log N) and FIR is O(FILTER_FIR_TAPS). */
+typedef enum {
+  eFilterMean = 0, /* Moving average of the last N samples. */
+  eFilterEma,      /* Exponential moving average, alpha = 2 / (N + 1). */
+  eFilterMedian,   /* Median of the last N samples. */
+  eFilterFir,      /* Fixed Q15 low pass FIR, N is not used. */
+  eFilterKindCount
+} FilterKind_t;
+
+/* Filter stage state. The last MAX_FILTER_SIZE samples are kept in a circular
+ * buffer shared by all the kernels, so the window can grow and the kernel can
+ * be changed without losing history. */
+typedef struct {
+  int values[MAX_FILTER_SIZE]; /* Circular buffer of the last samples. */
+  int head;                    /* Index where the next sample is written. */
+  int N;                       /* Current window size. */
+  FilterKind_t kind;           /* Active kernel. */
+  union {
+    long sum; /* Mean: sum of the last N samples. */
+    long ema; /* EMA: filtered value in Q15. */
+    struct {
+      FilterIndex_t lo[MAX_FILTER_SIZE];  /* Max-heap with the lower half. */
+      FilterIndex_t hi[MAX_FILTER_SIZE];  /* Min-heap with the upper half. */
+      FilterIndex_t pos[MAX_FILTER_SIZE]; /* Heap position of each sample. */
+      FilterIndex_t nlo;
+      FilterIndex_t nhi;
+    } median;
+  } u;
+} Filter_t;
+
+void vFilterInit(Filter_t *pxFilter, int N);
+void vFilterSetN(Filter_t *pxFilter, int N);
+void vFilterSetKind(Filter_t *pxFilter, FilterKind_t kind);
+int xFilterProcess(Filter_t *pxFilter, int value);
+
+#endif /* FILTER_H */
@@ -0,0 +1,356 @@
+/* Incremental renderer for the signal graph on the OLED display.
+ *
+ * The graph is drawn in sweep mode: instead of shifting the whole image for
+ * every sample, new samples are written at a column cursor that wraps around
+ * the display, with a blank column ahead of it marking the newest sample. Only
+ * the columns that changed since the last flush are sent over I2C, so each
+ * sample costs one or two columns instead of the whole 96x2 byte image.
+ *
+ * Each column covers a configurable number of samples and draws the vertical
+ * span between their minimum and maximum, extended to the last sample of the
+ * previous column so the trace stays connected. The span of every column is
+ * kept in sample units, so the whole graph can be redrawn when the vertical
+ * scale changes.
+ *
+ * The columns are sent with the asynchronous transfers of the display driver,
+ * so the calling task sleeps instead of spinning while the I2C bus works. */
+
+#include <stdint.h>
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Library includes. */
+#include "hw_types.h"
+#include "osram96x16.h"
+
+#include "graph.h"
+
+/* Number of words of the dirty column mask. */
+#define graphDIRTY_WORDS ((OLED_WIDTH + 31) / 32)
+
+/*-----------------------------------------------------------*/
+
+/* Column bitmasks in the layout of the display: bit 15 - row is set for a
+pixel at height 'row', counted from the bottom, so the low byte goes to the
+upper page and the high byte to the lower page. A span [lo, hi] is
+usRowsFrom[lo] & usRowsUpTo[hi]. */
+static const uint16_t usRowsFrom[OLED_HEIGHT] = {
+    0xFFFF, 0x7FFF, 0x3FFF, 0x1FFF, 0x0FFF, 0x07FF, 0x03FF, 0x01FF,
+    0x00FF, 0x007F, 0x003F, 0x001F, 0x000F, 0x0007, 0x0003, 0x0001};
+static const uint16_t usRowsUpTo[OLED_HEIGHT] = {
+    0x8000, 0xC000, 0xE000, 0xF000, 0xF800, 0xFC00, 0xFE00, 0xFF00,
+    0xFF80, 0xFFC0, 0xFFE0, 0xFFF0, 0xFFF8, 0xFFFC, 0xFFFE, 0xFFFF};
+
+/* Copy of the display contents. The first OLED_WIDTH bytes are the upper page
+and the next OLED_WIDTH bytes the lower page, as expected by OSRAMImageDraw. */
+static unsigned char image[OLED_WIDTH * 2];
+
+/* Span of each column in sample units. Blank columns have lo > hi. */
+static short sSpanLo[OLED_WIDTH];
+static short sSpanHi[OLED_WIDTH];
+
+/* Column where the next sample is drawn. */
+static int cursor = 0;
+
+/* One bit per column that changed since the last flush. */
+static uint32_t ulDirty[graphDIRTY_WORDS];
+
+/* Set when the scale changed and every column must be redrawn. */
+static BaseType_t xRedraw = pdFALSE;
+
+/* Vertical scale. In autoscale mode it grows as soon as a sample falls outside
+it, and shrinks to the visible samples each time the cursor wraps around. */
+static BaseType_t xAutoscale = pdTRUE;
+static int scaleMin = 0;
+static int scaleMax = 1;
+/* (OLED_HEIGHT - 1) / (scaleMax - scaleMin) in Q16. */
+static long lScaleQ16 = 0;
+
+/* Samples aggregated in the column being built. */
+static unsigned long ulDecimation = 1;
+static unsigned long ulCount = 0;
+static int columnMin = 0;
+static int columnMax = 0;
+
+/* Last sample of the previous column, where the trace continues from. */
+static int lastValue = 0;
+static BaseType_t xHaveLast = pdFALSE;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Marks a column as changed.
+ * @param column Column index.
+ */
+static void prvMarkDirty(int column) {
+  ulDirty[column / 32] |= 1UL << (column % 32);
+}
+
+/**
+ * @brief Tells whether a column changed since the last flush.
+ * @param column Column index.
+ * @return int Non zero if the column is dirty.
+ */
+static int prvIsDirty(int column) {
+  return (ulDirty[column / 32] >> (column % 32)) & 1UL;
+}
+
+/**
+ * @brief Changes the vertical scale and schedules a full redraw.
+ * @param min Sample value shown on the bottom row.
+ * @param max Sample value shown on the top row, greater than min.
+ */
+static void prvApplyScale(int min, int max) {
+  scaleMin = min;
+  scaleMax = max;
+  lScaleQ16 = ((long)(OLED_HEIGHT - 1) << 16) / (max - min);
+  xRedraw = pdTRUE;
+}
+
+/**
+ * @brief Converts a sample to a display row, clamping it to the display.
+ * @param value The sample.
+ * @return int Row, 0 for the bottom of the display.
+ */
+static int prvValueToRow(int value) {
+  long row = ((long)(value - scaleMin) * lScaleQ16 + (1L << 15)) >> 16;
+
+  if (row < 0) {
+    return 0;
+  }
+  if (row > OLED_HEIGHT - 1) {
+    return OLED_HEIGHT - 1;
+  }
+  return (int)row;
+}
+
+/**
+ * @brief Draws a column in the image from its span and marks it dirty.
+ * @param column Column index.
+ */
+static void prvRenderColumn(int column) {
+  uint16_t usMask = 0;
+
+  if (sSpanLo[column] <= sSpanHi[column]) {
+    usMask = usRowsFrom[prvValueToRow(sSpanLo[column])] &
+             usRowsUpTo[prvValueToRow(sSpanHi[column])];
+  }
+
+  image[column] = (unsigned char)usMask;
+  image[column + OLED_WIDTH] = (unsigned char)(usMask >> 8);
+  prvMarkDirty(column);
+}
+
+/**
+ * @brief Shrinks the autoscale range to the samples on the display.
+ */
+static void prvAutoscale(void) {
+  int min = 0;
+  int max = 0;
+  BaseType_t xFound = pdFALSE;
+
+  for (int i = 0; i < OLED_WIDTH; i++) {
+    if (sSpanLo[i] > sSpanHi[i]) {
+      continue;
+    }
+    if (xFound == pdFALSE || sSpanLo[i] < min) {
+      min = sSpanLo[i];
+    }
+    if (xFound == pdFALSE || sSpanHi[i] > max) {
+      max = sSpanHi[i];
+    }
+    xFound = pdTRUE;
+  }
+
+  if (xFound == pdFALSE) {
+    return;
+  }
+  if (max == min) {
+    max = min + 1;
+  }
+  if (min != scaleMin || max != scaleMax) {
+    prvApplyScale(min, max);
+  }
+}
+
+/**
+ * @brief Ends the column being built: stores its span, draws it, blanks the
+ * column ahead and advances the cursor.
+ */
+static void prvCommitColumn(void) {
+  int next = (cursor + 1 == OLED_WIDTH) ? 0 : cursor + 1;
+  int lo = columnMin;
+  int hi = columnMax;
+
+  /* Connect with the previous column. */
+  if (xHaveLast == pdTRUE) {
+    if (lastValue < lo) {
+      lo = lastValue;
+    } else if (lastValue > hi) {
+      hi = lastValue;
+    }
+  }
+
+  sSpanLo[cursor] = (short)lo;
+  sSpanHi[cursor] = (short)hi;
+
+  if (xAutoscale == pdTRUE && (lo < scaleMin || hi > scaleMax)) {
+    prvApplyScale(lo < scaleMin ? lo : scaleMin, hi > scaleMax ? hi : scaleMax);
+  }
+
+  prvRenderColumn(cursor);
+
+  /* Blank the column ahead of the newest one. */
+  sSpanLo[next] = 1;
+  sSpanHi[next] = 0;
+  prvRenderColumn(next);
+
+  cursor = next;
+  if (cursor == 0 && xAutoscale == pdTRUE) {
+    prvAutoscale();
+  }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Clears the display and the graph, moves the cursor to the left edge
+ * and selects autoscale.
+ */
+void vGraphInit(void) {
+  for (int i = 0; i < OLED_WIDTH * 2; i++) {
+    image[i] = 0;
+  }
+  for (int i = 0; i < OLED_WIDTH; i++) {
+    sSpanLo[i] = 1;
+    sSpanHi[i] = 0;
+  }
+  for (int i = 0; i < graphDIRTY_WORDS; i++) {
+    ulDirty[i] = 0;
+  }
+  cursor = 0;
+  ulCount = 0;
+  xHaveLast = pdFALSE;
+
+  xAutoscale = pdTRUE;
+  prvApplyScale(0, 1);
+  xRedraw = pdFALSE;
+
+  OSRAMClear();
+}
+
+/**
+ * @brief Sets the vertical scale of the graph.
+ * @param min Sample value shown on the bottom row.
+ * @param max Sample value shown on the top row. If not greater than min, the
+ * scale follows the signal instead.
+ */
+void vGraphSetScale(int min, int max) {
+  if (max <= min) {
+    xAutoscale = pdTRUE;
+    prvAutoscale();
+  } else {
+    xAutoscale = pdFALSE;
+    if (min != scaleMin || max != scaleMax) {
+      prvApplyScale(min, max);
+    }
+  }
+}
+
+/**
+ * @brief Sets how many samples are aggregated into each column. When the
+ * sample rate exceeds the rate at which columns should advance, each column
+ * shows the minimum and maximum of its samples.
+ * @param ulSamplesPerColumn Samples per column, at least 1.
+ */
+void vGraphSetDecimation(unsigned long ulSamplesPerColumn) {
+  ulDecimation = (ulSamplesPerColumn > 0) ? ulSamplesPerColumn : 1;
+}
+
+/**
+ * @brief Adds a sample to the graph. Nothing is sent to the display until
+ * vGraphFlush() is called.
+ * @param value The sample, in the units given to vGraphSetScale().
+ */
+void vGraphAddValue(int value) {
+  if (ulCount == 0) {
+    columnMin = value;
+    columnMax = value;
+  } else if (value < columnMin) {
+    columnMin = value;
+  } else if (value > columnMax) {
+    columnMax = value;
+  }
+
+  if (++ulCount >= ulDecimation) {
+    prvCommitColumn();
+    lastValue = value;
+    xHaveLast = pdTRUE;
+    ulCount = 0;
+  }
+}
+
+/**
+ * @brief Queues one row of image data for the display, waiting for a queued
+ * row to complete while the driver queue is full.
+ * @param pucRow First byte of the row.
+ * @param column First column of the row.
+ * @param page Display page, 0 for the upper half.
+ * @param width Number of columns.
+ * @param pulPending Number of rows queued and not yet completed, updated.
+ */
+static void prvQueueRow(const unsigned char *pucRow, int column, int page,
+                        int width, unsigned long *pulPending) {
+  while (!OSRAMImageDrawAsync(pucRow, column, page, width, 1)) {
+    ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
+    (*pulPending)--;
+  }
+  (*pulPending)++;
+}
+
+/**
+ * @brief Sends the columns that changed since the last call to the display.
+ * Each run of consecutive dirty columns is written with one transfer per page.
+ * Blocks until the transfers complete, as they read the image in place.
+ */
+void vGraphFlush(void) {
+  unsigned long ulPending = 0;
+  int column = 0;
+
+  if (xRedraw == pdTRUE) {
+    for (int i = 0; i < OLED_WIDTH; i++) {
+      prvRenderColumn(i);
+    }
+    xRedraw = pdFALSE;
+  }
+
+  while (column < OLED_WIDTH) {
+    int first;
+
+    if (!prvIsDirty(column)) {
+      column++;
+      continue;
+    }
+
+    first = column;
+    while (column < OLED_WIDTH && prvIsDirty(column)) {
+      column++;
+    }
+
+    prvQueueRow(&image[first], first, 0, column - first, &ulPending);
+    prvQueueRow(&image[first + OLED_WIDTH], first, 1, column - first,
+                &ulPending);
+  }
+
+  /* Each completed row gives one notification. */
+  while (ulPending > 0) {
+    ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
+    ulPending--;
+  }
+
+  for (int i = 0; i < graphDIRTY_WORDS; i++) {
+    ulDirty[i] = 0;
+  }
+}
@@ -0,0 +1,13 @@
+#ifndef GRAPH_H
+#define GRAPH_H
+
+#define OLED_WIDTH 96
+#define OLED_HEIGHT 16
+
+void vGraphInit(void);
+void vGraphSetScale(int min, int max);
+void vGraphSetDecimation(unsigned long ulSamplesPerColumn);
+void vGraphAddValue(int value);
+void vGraphFlush(void);
+
+#endif /* GRAPH_H */
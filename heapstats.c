@@ -0,0 +1,119 @@
+/* Heap statistics.
+ *
+ * The heap implementation is chosen with HEAP in the Makefile. heap_4 takes
+ * its memory from an array of configTOTAL_HEAP_SIZE bytes and merges adjacent
+ * free blocks, heap_5 does the same over the regions given to
+ * vPortDefineHeapRegions(), here a single array of the same size. Unlike
+ * heap_1, both can free memory, and vPortGetHeapStats() walks their free list
+ * to find the largest free block and the number of free blocks, which show how
+ * fragmented the heap is.
+ *
+ * The linker sends every call to pvPortMalloc() and vPortFree(), including
+ * those of the kernel, through the wrappers below (see --wrap in the
+ * Makefile), which time each call with the run time clock and count the
+ * allocations that fail. */
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "heapstats.h"
+#include "timertest.h"
+
+/* The allocator itself and the wrappers the linker puts in its place. */
+void *__real_pvPortMalloc(size_t xWantedSize);
+void __real_vPortFree(void *pv);
+void *__wrap_pvPortMalloc(size_t xWantedSize);
+void __wrap_vPortFree(void *pv);
+
+/*-----------------------------------------------------------*/
+
+static HeapCallStats_t xMallocStats;
+static HeapCallStats_t xFreeStats;
+static unsigned long ulFailed = 0UL;
+
+#if configHEAP_IMPLEMENTATION == 5
+/* The only region given to heap_5. */
+static uint8_t ucHeap[configTOTAL_HEAP_SIZE]
+    __attribute__((aligned(portBYTE_ALIGNMENT)));
+#endif
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Adds a call to the statistics of an allocator function.
+ * @param pxStats Statistics of the function.
+ * @param ulCycles Duration of the call.
+ */
+static void prvRecordCall(HeapCallStats_t *pxStats, unsigned long ulCycles) {
+  taskENTER_CRITICAL();
+  pxStats->ulCalls++;
+  pxStats->ullCycles += ulCycles;
+  if (ulCycles > pxStats->ulMax) {
+    pxStats->ulMax = ulCycles;
+  }
+  taskEXIT_CRITICAL();
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Gives heap_5 its memory. Must be called before anything is
+ * allocated. Does nothing with heap_4, which initializes itself.
+ */
+void vHeapStatsInit(void) {
+#if configHEAP_IMPLEMENTATION == 5
+  static const HeapRegion_t xRegions[] = {{ucHeap, sizeof(ucHeap)},
+                                          {NULL, 0}};
+
+  vPortDefineHeapRegions(xRegions);
+#endif
+}
+
+/**
+ * @brief Allocates memory, timing the allocator. Called instead of
+ * pvPortMalloc().
+ * @param xWantedSize Bytes to allocate.
+ * @return void* The memory, NULL if the heap has no block large enough.
+ */
+void *__wrap_pvPortMalloc(size_t xWantedSize) {
+  unsigned long ulStart = timerGET_CYCLES();
+  void *pvReturn = __real_pvPortMalloc(xWantedSize);
+
+  prvRecordCall(&xMallocStats, timerTO_RUN_TIME(timerGET_CYCLES() - ulStart));
+  if (pvReturn == NULL && xWantedSize > 0) {
+    taskENTER_CRITICAL();
+    ulFailed++;
+    taskEXIT_CRITICAL();
+  }
+
+  return pvReturn;
+}
+
+/**
+ * @brief Frees memory, timing the allocator. Called instead of vPortFree().
+ * @param pv Memory returned by pvPortMalloc(), or NULL.
+ */
+void __wrap_vPortFree(void *pv) {
+  unsigned long ulStart = timerGET_CYCLES();
+
+  __real_vPortFree(pv);
+  prvRecordCall(&xFreeStats, timerTO_RUN_TIME(timerGET_CYCLES() - ulStart));
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Copies the statistics of the heap. Walks the free list, so it takes
+ * longer the more fragmented the heap is.
+ * @param pxReport Where the statistics are copied.
+ */
+void vHeapStatsGet(HeapReport_t *pxReport) {
+  vPortGetHeapStats(&pxReport->xHeap);
+
+  taskENTER_CRITICAL();
+  pxReport->xMalloc = xMallocStats;
+  pxReport->xFree = xFreeStats;
+  pxReport->ulFailed = ulFailed;
+  taskEXIT_CRITICAL();
+}
@@ -0,0 +1,25 @@
+#ifndef HEAPSTATS_H
+#define HEAPSTATS_H
+
+#include "FreeRTOS.h"
+
+/* Cost of the calls to an allocator function. Times are in run time clock
+ * cycles. */
+typedef struct {
+  unsigned long ulCalls; /* Number of calls. */
+  uint64_t ullCycles;    /* Total time of the calls. */
+  unsigned long ulMax;   /* Slowest call. */
+} HeapCallStats_t;
+
+/* Statistics of the heap. */
+typedef struct {
+  HeapStats_t xHeap;       /* Free space and free blocks, from the allocator. */
+  HeapCallStats_t xMalloc; /* Calls to pvPortMalloc(). */
+  HeapCallStats_t xFree;   /* Calls to vPortFree(). */
+  unsigned long ulFailed;  /* Allocations that returned NULL. */
+} HeapReport_t;
+
+void vHeapStatsInit(void);
+void vHeapStatsGet(HeapReport_t *pxReport);
+
+#endif /* HEAPSTATS_H */
@@ -32,14 +32,19 @@
 //
 //*****************************************************************************
 
+#include "FreeRTOS.h"
+#include "task.h"
 #include "hw_i2c.h"
+#include "hw_ints.h"
 #include "hw_memmap.h"
 #include "hw_sysctl.h"
 #include "hw_types.h"
 #include "debug.h"
 #include "gpio.h"
 #include "i2c.h"
+#include "interrupt.h"
 #include "sysctl.h"
+#include "timer.h"
 #include "osram96x16.h"
 
 //*****************************************************************************
@@ -268,6 +273,64 @@ static const unsigned char g_pucOSRAMInit[] =
 //*****************************************************************************
 static unsigned long g_ulDelay;
 
+//*****************************************************************************
+//
+// The number of transfers that can be queued by OSRAMImageDrawAsync(), and the
+// number of addressing bytes sent ahead of the image data of each transfer.
+//
+//*****************************************************************************
+#define OSRAM_ASYNC_QUEUE_SIZE  4
+#define OSRAM_ASYNC_HEADER_SIZE 7
+
+//*****************************************************************************
+//
+// A queued transfer of one row of image data.  The image data is not copied,
+// it is read from the caller's buffer while the transfer is in progress.
+//
+//*****************************************************************************
+typedef struct
+{
+    unsigned char pucHeader[OSRAM_ASYNC_HEADER_SIZE];
+    const unsigned char *pucData;
+    unsigned long ulCount;
+    TaskHandle_t xTask;
+}
+tOSRAMTransfer;
+
+//*****************************************************************************
+//
+// The transfer queue.  The read and write indices run freely and are reduced
+// modulo the queue size when used.  The transfer at the read index is the one
+// in progress, and g_ulAsyncIdx is the index of its next byte.
+//
+//*****************************************************************************
+static tOSRAMTransfer g_psAsyncQueue[OSRAM_ASYNC_QUEUE_SIZE];
+static volatile unsigned long g_ulAsyncRead;
+static volatile unsigned long g_ulAsyncWrite;
+static unsigned long g_ulAsyncIdx;
+
+//*****************************************************************************
+//
+// The inter-byte delay expressed in Timer 1 ticks.
+//
+//*****************************************************************************
+static unsigned long g_ulAsyncDelay;
+
+//*****************************************************************************
+//
+// The number of bytes of asynchronous transfers that were not acknowledged.
+//
+//*****************************************************************************
+volatile unsigned long g_ulOSRAMAsyncErrors;
+
+//*****************************************************************************
+//
+// The interrupt handlers of the asynchronous transfer engine.
+//
+//*****************************************************************************
+void I2CIntHandler(void);
+void Timer1IntHandler(void);
+
 //*****************************************************************************
 //
 //! \internal
@@ -881,6 +944,26 @@ OSRAMInit(tBoolean bFast)
     //
     g_ulDelay = 68 * (HWREG(I2C_MASTER_BASE + I2C_MASTER_O_TPR) + 1);
 
+    //
+    // Configure Timer 1 to provide the inter-byte delay of the asynchronous
+    // transfers.  Each iteration of OSRAMDelay() takes three processor
+    // cycles, which is the rate at which the timer counts.
+    //
+    g_ulAsyncDelay = 3 * g_ulDelay;
+    SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER1);
+    TimerConfigure(TIMER1_BASE, TIMER_CFG_32_BIT_OS);
+    TimerIntEnable(TIMER1_BASE, TIMER_TIMA_TIMEOUT);
+
+    //
+    // The Timer 1 handler uses FreeRTOS API functions, so both interrupts run
+    // at the kernel priority.  The I2C master interrupt itself is only enabled
+    // while asynchronous transfers are in progress.
+    //
+    IntPrioritySet(INT_I2C, configKERNEL_INTERRUPT_PRIORITY);
+    IntPrioritySet(INT_TIMER1A, configKERNEL_INTERRUPT_PRIORITY);
+    IntEnable(INT_I2C);
+    IntEnable(INT_TIMER1A);
+
     //
     // Initialize the SSD0303 controller.  Loop through the initialization
     // sequence doing a single I2C transfer for each command.
@@ -967,6 +1050,245 @@ OSRAMDisplayOff(void)
     OSRAMWriteFinal(0x8a);
 }
 
+//*****************************************************************************
+//
+//! \internal
+//!
+//! Start the transfer at the head of the asynchronous transfer queue.
+//!
+//! This function sends the first byte of the transfer.  The rest of the bytes
+//! are sent by the interrupt handlers.  It must be called from the interrupt
+//! handlers or with them masked.
+//!
+//! \return None.
+//
+//*****************************************************************************
+static void
+OSRAMAsyncStart(void)
+{
+    tOSRAMTransfer *psTransfer;
+
+    psTransfer = &g_psAsyncQueue[g_ulAsyncRead % OSRAM_ASYNC_QUEUE_SIZE];
+    g_ulAsyncIdx = 1;
+
+    I2CMasterSlaveAddrSet(I2C_MASTER_BASE, SSD0303_ADDR, false);
+    I2CMasterDataPut(I2C_MASTER_BASE, psTransfer->pucHeader[0]);
+    I2CMasterControl(I2C_MASTER_BASE, I2C_MASTER_CMD_BURST_SEND_START);
+}
+
+//*****************************************************************************
+//
+//! Queues an image to be displayed on the OLED display.
+//!
+//! \param pucImage is a pointer to the image data.
+//! \param ulX is the horizontal position to display this image, specified in
+//! columns from the left edge of the display.
+//! \param ulY is the vertical position to display this image, specified in
+//! eight scan line blocks from the top of the display (i.e. only 0 and 1 are
+//! valid).
+//! \param ulWidth is the width of the image, specified in columns.
+//! \param ulHeight is the height of the image, specified in eight row blocks
+//! (i.e. only 1 and 2 are valid).
+//!
+//! This function is the non-blocking version of OSRAMImageDraw(); the image
+//! data is organized in the same way.  One transfer is queued for each row of
+//! the image and the function returns immediately.  The transfers are carried
+//! out by the I2C and Timer 1 interrupt handlers, with Timer 1 providing the
+//! inter-byte delay required by the SSD0303 controller.
+//!
+//! The calling task receives a task notification each time one of the rows
+//! has been written, so it can wait for them with ulTaskNotifyTake().  The
+//! image data must not be modified until then.
+//!
+//! The blocking functions of this driver must not be used while asynchronous
+//! transfers are pending.
+//!
+//! \return Returns \b true if the image was queued, or \b false if there was
+//! not enough room in the queue, in which case nothing was queued.
+//
+//*****************************************************************************
+tBoolean
+OSRAMImageDrawAsync(const unsigned char *pucImage, unsigned long ulX,
+                    unsigned long ulY, unsigned long ulWidth,
+                    unsigned long ulHeight)
+{
+    tOSRAMTransfer *psTransfer;
+    TaskHandle_t xTask;
+    tBoolean bIdle;
+
+    //
+    // Check the arguments.
+    //
+    ASSERT(ulX < 96);
+    ASSERT(ulY < 2);
+    ASSERT(ulWidth > 0);
+    ASSERT((ulX + ulWidth) <= 96);
+    ASSERT((ulY + ulHeight) <= 2);
+
+    //
+    // The first 36 columns of the LCD buffer are not displayed.
+    //
+    ulX += 36;
+    xTask = xTaskGetCurrentTaskHandle();
+
+    taskENTER_CRITICAL();
+
+    //
+    // Only queue the image if all of its rows fit.
+    //
+    if((OSRAM_ASYNC_QUEUE_SIZE - (g_ulAsyncWrite - g_ulAsyncRead)) < ulHeight)
+    {
+        taskEXIT_CRITICAL();
+        return(false);
+    }
+
+    bIdle = (g_ulAsyncRead == g_ulAsyncWrite);
+
+    //
+    // Queue one transfer per row, each one starting with the same addressing
+    // sequence as OSRAMImageDraw().
+    //
+    while(ulHeight--)
+    {
+        psTransfer = &g_psAsyncQueue[g_ulAsyncWrite % OSRAM_ASYNC_QUEUE_SIZE];
+        psTransfer->pucHeader[0] = 0x80;
+        psTransfer->pucHeader[1] = (ulY == 0) ? 0xb0 : 0xb1;
+        psTransfer->pucHeader[2] = 0x80;
+        psTransfer->pucHeader[3] = ulX & 0x0f;
+        psTransfer->pucHeader[4] = 0x80;
+        psTransfer->pucHeader[5] = 0x10 | ((ulX >> 4) & 0x0f);
+        psTransfer->pucHeader[6] = 0x40;
+        psTransfer->pucData = pucImage;
+        psTransfer->ulCount = ulWidth;
+        psTransfer->xTask = xTask;
+        g_ulAsyncWrite++;
+
+        pucImage += ulWidth;
+        ulY++;
+    }
+
+    //
+    // If the engine was idle, start it.  Any completion left pending by the
+    // blocking functions is cleared before the interrupt is enabled.
+    //
+    if(bIdle)
+    {
+        I2CMasterIntClear(I2C_MASTER_BASE);
+        I2CMasterIntEnable(I2C_MASTER_BASE);
+        OSRAMAsyncStart();
+    }
+
+    taskEXIT_CRITICAL();
+
+    return(true);
+}
+
+//*****************************************************************************
+//
+//! \internal
+//!
+//! Handles the I2C master interrupt.
+//!
+//! This interrupt occurs each time a byte of an asynchronous transfer has been
+//! sent.  The next byte is not sent here, Timer 1 is started instead so the
+//! inter-byte delay elapses without blocking the processor.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void
+I2CIntHandler(void)
+{
+    traceISR_ENTER();
+
+    I2CMasterIntClear(I2C_MASTER_BASE);
+
+    //
+    // Like the blocking functions, carry on after an error, but count it.
+    //
+    if(I2CMasterErr(I2C_MASTER_BASE) != I2C_MASTER_ERR_NONE)
+    {
+        g_ulOSRAMAsyncErrors++;
+    }
+
+    TimerLoadSet(TIMER1_BASE, TIMER_A, g_ulAsyncDelay);
+    TimerEnable(TIMER1_BASE, TIMER_A);
+
+    traceISR_EXIT();
+}
+
+//*****************************************************************************
+//
+//! \internal
+//!
+//! Handles the Timer 1 interrupt.
+//!
+//! This interrupt occurs when the inter-byte delay has elapsed.  It sends the
+//! next byte of the transfer in progress or, if it was completely sent,
+//! notifies the task that queued it and starts the next transfer.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void
+Timer1IntHandler(void)
+{
+    tOSRAMTransfer *psTransfer;
+    unsigned long ulTotal;
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    traceISR_ENTER();
+
+    TimerIntClear(TIMER1_BASE, TIMER_TIMA_TIMEOUT);
+
+    psTransfer = &g_psAsyncQueue[g_ulAsyncRead % OSRAM_ASYNC_QUEUE_SIZE];
+    ulTotal = OSRAM_ASYNC_HEADER_SIZE + psTransfer->ulCount;
+
+    if(g_ulAsyncIdx < ulTotal)
+    {
+        //
+        // Send the next byte, finishing the transfer with the last one.
+        //
+        I2CMasterDataPut(I2C_MASTER_BASE,
+                         (g_ulAsyncIdx < OSRAM_ASYNC_HEADER_SIZE) ?
+                         psTransfer->pucHeader[g_ulAsyncIdx] :
+                         psTransfer->pucData[g_ulAsyncIdx -
+                                             OSRAM_ASYNC_HEADER_SIZE]);
+        I2CMasterControl(I2C_MASTER_BASE,
+                         (g_ulAsyncIdx == (ulTotal - 1)) ?
+                         I2C_MASTER_CMD_BURST_SEND_FINISH :
+                         I2C_MASTER_CMD_BURST_SEND_CONT);
+        g_ulAsyncIdx++;
+        traceISR_EXIT();
+        return;
+    }
+
+    //
+    // The transfer is complete.
+    //
+    if(psTransfer->xTask != NULL)
+    {
+        vTaskNotifyGiveFromISR(psTransfer->xTask, &xHigherPriorityTaskWoken);
+    }
+    g_ulAsyncRead++;
+
+    if(g_ulAsyncRead != g_ulAsyncWrite)
+    {
+        OSRAMAsyncStart();
+    }
+    else
+    {
+        //
+        // Go idle, leaving the I2C master to the blocking functions.
+        //
+        I2CMasterIntDisable(I2C_MASTER_BASE);
+    }
+
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+
+    traceISR_EXIT();
+}
+
 //*****************************************************************************
 //
 // Close the Doxygen group.
@@ -40,6 +40,10 @@ extern void OSRAMStringDraw(const char *pcStr, unsigned long ulX,
 extern void OSRAMImageDraw(const unsigned char *pucImage, unsigned long ulX,
                            unsigned long ulY, unsigned long ulWidth,
                            unsigned long ulHeight);
+extern tBoolean OSRAMImageDrawAsync(const unsigned char *pucImage,
+                                    unsigned long ulX, unsigned long ulY,
+                                    unsigned long ulWidth,
+                                    unsigned long ulHeight);
 extern void OSRAMInit(tBoolean bFast);
 extern void OSRAMDisplayOn(void);
 extern void OSRAMDisplayOff(void);
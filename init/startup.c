@@ -25,6 +25,8 @@
 //
 //*****************************************************************************
 
+#include "isrstats.h"
+
 //*****************************************************************************
 //
 // Forward declaration of the default fault handlers.
@@ -38,11 +40,49 @@ extern void xPortPendSVHandler(void);
 extern void xPortSysTickHandler(void);
 
 extern void Timer0IntHandler( void );
+extern void Timer2IntHandler( void );
+extern void ADC0IntHandler( void );
+extern void UART0IntHandler( void );
+extern void I2CIntHandler( void );
+extern void Timer1IntHandler( void );
 
 // extern void vUART_ISR( void );
 // extern void vGPIO_ISR( void );
 extern void vPortSVCHandler( void );
 
+//*****************************************************************************
+//
+// When the interrupt statistics are enabled, the vector table points to
+// wrappers that time the handlers, see isrstats.c.  ISR() gives the entry of
+// a handler in the table.  The PendSV and SVCall handlers of the kernel switch
+// stacks in naked assembler, so they cannot be wrapped.
+//
+//*****************************************************************************
+#if configUSE_ISR_STATS == 1
+#define ISR_WRAPPER(pfnHandler, eIsr)                                         \
+    static void                                                               \
+    pfnHandler##Stats(void)                                                   \
+    {                                                                         \
+        IsrFrame_t sFrame;                                                    \
+                                                                              \
+        vIsrStatsEnter(&sFrame);                                              \
+        pfnHandler();                                                         \
+        vIsrStatsExit(&sFrame, eIsr);                                         \
+    }
+
+ISR_WRAPPER(xPortSysTickHandler, eIsrSysTick)
+ISR_WRAPPER(UART0IntHandler, eIsrUart0)
+ISR_WRAPPER(I2CIntHandler, eIsrI2c)
+ISR_WRAPPER(ADC0IntHandler, eIsrAdc0)
+ISR_WRAPPER(Timer0IntHandler, eIsrTimer0)
+ISR_WRAPPER(Timer1IntHandler, eIsrTimer1)
+ISR_WRAPPER(Timer2IntHandler, eIsrTimer2)
+
+#define ISR(pfnHandler)                         pfnHandler##Stats
+#else
+#define ISR(pfnHandler)                         pfnHandler
+#endif
+
 //*****************************************************************************
 //
 // The entry point for the application.
@@ -52,11 +92,13 @@ extern int main(void);
 
 //*****************************************************************************
 //
-// Reserve space for the system stack.
+// Reserve space for the system stack.  Its size in words comes from
+// stacksizes.h, see stackprof.c.
 //
 //*****************************************************************************
 #ifndef STACK_SIZE
-#define STACK_SIZE                              64
+#define STACK_SIZE                              (stackMSP_WORDS +            \
+                                                 configSTACK_PROFILE_EXTRA)
 #endif
 static unsigned long pulStack[STACK_SIZE];
 
@@ -86,31 +128,31 @@ void (* const g_pfnVectors[])(void) =
     IntDefaultHandler,                      // Debug monitor handler
     0,                                      // Reserved
     xPortPendSVHandler,                     // The PendSV handler
-    xPortSysTickHandler,                    // The SysTick handler
+    ISR(xPortSysTickHandler),               // The SysTick handler
     IntDefaultHandler,                      // GPIO Port A
     IntDefaultHandler,                      // GPIO Port B
     IntDefaultHandler,			    // GPIO Port C
     IntDefaultHandler,                      // GPIO Port D
     IntDefaultHandler,                      // GPIO Port E
-    IntDefaultHandler,			    // UART0 Rx and Tx
+    ISR(UART0IntHandler),                   // UART0 Rx and Tx
     IntDefaultHandler,                      // UART1 Rx and Tx
     IntDefaultHandler,                      // SSI Rx and Tx
-    IntDefaultHandler,                      // I2C Master and Slave
+    ISR(I2CIntHandler),                     // I2C Master and Slave
     IntDefaultHandler,                      // PWM Fault
     IntDefaultHandler,                      // PWM Generator 0
     IntDefaultHandler,                      // PWM Generator 1
     IntDefaultHandler,                      // PWM Generator 2
     IntDefaultHandler,                      // Quadrature Encoder
-    IntDefaultHandler,                      // ADC Sequence 0
+    ISR(ADC0IntHandler),                    // ADC Sequence 0
     IntDefaultHandler,                      // ADC Sequence 1
     IntDefaultHandler,                      // ADC Sequence 2
     IntDefaultHandler,                      // ADC Sequence 3
     IntDefaultHandler,                      // Watchdog timer
-    Timer0IntHandler,                       // Timer 0 subtimer A
+    ISR(Timer0IntHandler),                  // Timer 0 subtimer A
     IntDefaultHandler,                      // Timer 0 subtimer B
-    IntDefaultHandler,                      // Timer 1 subtimer A
+    ISR(Timer1IntHandler),                  // Timer 1 subtimer A
     IntDefaultHandler,                      // Timer 1 subtimer B
-    IntDefaultHandler,                      // Timer 2 subtimer A
+    ISR(Timer2IntHandler),                  // Timer 2 subtimer A
     IntDefaultHandler,                      // Timer 2 subtimer B
     IntDefaultHandler,                      // Analog Comparator 0
     IntDefaultHandler,                      // Analog Comparator 1
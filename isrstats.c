@@ -0,0 +1,149 @@
+/* Interrupt execution time accounting.
+ *
+ * When configUSE_ISR_STATS is 1 the vector table in init/startup.c points to
+ * wrappers that call vIsrStatsEnter() and vIsrStatsExit() around the real
+ * handlers. Each handler is charged only its own time: the time of the
+ * interrupts nested inside it is measured by them and subtracted.
+ *
+ * The sum of all the handler times is subtracted from the run time clock the
+ * kernel uses for the task counters, see portGET_RUN_TIME_COUNTER_VALUE() in
+ * FreeRTOSConfig.h, so the CPU usage of a task no longer includes the
+ * interrupts that happened while it ran. What remains charged to the tasks is
+ * the exception entry and exit, about 24 cycles per interrupt, the wrapper
+ * itself, and the PendSV and SVCall handlers, which cannot be wrapped. */
+
+#include "isrstats.h"
+#include "timertest.h"
+
+#if configUSE_ISR_STATS == 1
+
+/*-----------------------------------------------------------*/
+
+static IsrStats_t xStats[eIsrCount];
+
+/* Time spent in all the handlers. */
+static uint64_t ullTotal = 0;
+
+/* Time spent in the interrupts nested inside the running handler. */
+static unsigned long ulNested = 0UL;
+
+/* Current and deepest nesting of the handlers. */
+static unsigned long ulDepth = 0UL;
+static unsigned long ulMaxDepth = 0UL;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Masks every configurable interrupt, including those above
+ * configMAX_SYSCALL_INTERRUPT_PRIORITY that the kernel critical sections let
+ * through.
+ * @return unsigned long Previous mask, for prvRestoreInterrupts().
+ */
+static unsigned long prvMaskInterrupts(void) {
+  unsigned long ulPrimask;
+
+  __asm volatile("mrs %0, primask \n"
+                 "cpsid i         \n"
+                 : "=r"(ulPrimask)
+                 :
+                 : "memory");
+  return ulPrimask;
+}
+
+/**
+ * @brief Restores the interrupt mask.
+ * @param ulPrimask Mask returned by prvMaskInterrupts().
+ */
+static void prvRestoreInterrupts(unsigned long ulPrimask) {
+  __asm volatile("msr primask, %0" : : "r"(ulPrimask) : "memory");
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Starts timing a handler. Called by the wrappers in startup.c.
+ * @param pxFrame State of the wrapper, passed back to vIsrStatsExit().
+ */
+void vIsrStatsEnter(IsrFrame_t *pxFrame) {
+  unsigned long ulMask = prvMaskInterrupts();
+
+  pxFrame->ulOuterNested = ulNested;
+  ulNested = 0UL;
+  if (++ulDepth > ulMaxDepth) {
+    ulMaxDepth = ulDepth;
+  }
+  pxFrame->ulStart = timerGET_CYCLES();
+
+  prvRestoreInterrupts(ulMask);
+}
+
+/**
+ * @brief Stops timing a handler and charges it its time. Called by the
+ * wrappers in startup.c.
+ * @param pxFrame State of the wrapper, filled by vIsrStatsEnter().
+ * @param eIsr The interrupt.
+ */
+void vIsrStatsExit(IsrFrame_t *pxFrame, IsrId_t eIsr) {
+  unsigned long ulMask = prvMaskInterrupts();
+  unsigned long ulElapsed = timerGET_CYCLES() - pxFrame->ulStart;
+  unsigned long ulOwn = timerTO_RUN_TIME(ulElapsed - ulNested);
+
+  /* The whole time of this handler is nested time for the outer one. */
+  ulNested = pxFrame->ulOuterNested + ulElapsed;
+  ulDepth--;
+
+  xStats[eIsr].ullTime += ulOwn;
+  xStats[eIsr].ulCount++;
+  if (ulOwn > xStats[eIsr].ulMax) {
+    xStats[eIsr].ulMax = ulOwn;
+  }
+  ullTotal += ulOwn;
+
+  prvRestoreInterrupts(ulMask);
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Returns the time spent in all the handlers.
+ * @return uint64_t Time in run time clock cycles.
+ */
+uint64_t ullIsrStatsGetTotal(void) {
+  unsigned long ulMask = prvMaskInterrupts();
+  uint64_t ullResult = ullTotal;
+
+  prvRestoreInterrupts(ulMask);
+  return ullResult;
+}
+
+/**
+ * @brief Copies the statistics of an interrupt.
+ * @param eIsr The interrupt.
+ * @param pxStats Where the statistics are copied.
+ */
+void vIsrStatsGet(IsrId_t eIsr, IsrStats_t *pxStats) {
+  unsigned long ulMask = prvMaskInterrupts();
+
+  *pxStats = xStats[eIsr];
+  prvRestoreInterrupts(ulMask);
+}
+
+/**
+ * @brief Returns the deepest nesting of handlers seen.
+ * @return unsigned long Number of handlers, 1 if they never nested.
+ */
+unsigned long ulIsrStatsGetMaxNesting(void) { return ulMaxDepth; }
+
+/**
+ * @brief Returns the name of an interrupt.
+ * @param eIsr The interrupt.
+ * @return const char* The name.
+ */
+const char *pcIsrStatsGetName(IsrId_t eIsr) {
+  static const char *const pcNames[eIsrCount] = {
+      "SysTick", "UART0", "I2C", "ADC0", "Timer0", "Timer1", "Timer2"};
+
+  return pcNames[eIsr];
+}
+
+#endif /* configUSE_ISR_STATS */
@@ -0,0 +1,41 @@
+#ifndef ISRSTATS_H
+#define ISRSTATS_H
+
+#include "FreeRTOS.h"
+
+/* Interrupts accounted for when configUSE_ISR_STATS is 1, see init/startup.c.
+ * PendSV and SVCall are left out: the kernel implements them in naked
+ * assembler that switches stacks, so they cannot be called from a wrapper. */
+typedef enum {
+  eIsrSysTick = 0,
+  eIsrUart0,
+  eIsrI2c,
+  eIsrAdc0,
+  eIsrTimer0,
+  eIsrTimer1,
+  eIsrTimer2,
+  eIsrCount
+} IsrId_t;
+
+/* Statistics of an interrupt. Times are in run time clock cycles and exclude the
+ * interrupts nested inside it. */
+typedef struct {
+  uint64_t ullTime;      /* Total time spent in the handler. */
+  unsigned long ulCount; /* Number of times it ran. */
+  unsigned long ulMax;   /* Longest run. */
+} IsrStats_t;
+
+/* State kept on the stack of a wrapper while its handler runs. */
+typedef struct {
+  unsigned long ulStart;
+  unsigned long ulOuterNested;
+} IsrFrame_t;
+
+void vIsrStatsEnter(IsrFrame_t *pxFrame);
+void vIsrStatsExit(IsrFrame_t *pxFrame, IsrId_t eIsr);
+uint64_t ullIsrStatsGetTotal(void);
+void vIsrStatsGet(IsrId_t eIsr, IsrStats_t *pxStats);
+unsigned long ulIsrStatsGetMaxNesting(void);
+const char *pcIsrStatsGetName(IsrId_t eIsr);
+
+#endif /* ISRSTATS_H */
@@ -0,0 +1,206 @@
+/* Wakeup latency histograms.
+ *
+ * The kernel trace hooks defined in FreeRTOSConfig.h call into this file from
+ * tasks.c. When a task is moved to the ready list, vLatencyTaskReady() stamps
+ * it with the time, and when the scheduler switches it in,
+ * vLatencyTaskSwitchedIn() adds the time it waited to a histogram with
+ * logarithmic buckets. Tasks switched in again after a preemption carry no
+ * stamp, so only wakeups are measured.
+ *
+ * The hooks run inside the kernel with interrupts masked up to
+ * configMAX_SYSCALL_INTERRUPT_PRIORITY, so they need no locking. Each one is a
+ * handful of loads and stores, the bucket is found with a single count leading
+ * zeros instruction, and the time is read straight from the Timer 0 counter
+ * instead of the 64 bit run time clock. Estimated from the instruction
+ * timings, they add about 25 cycles to a wakeup and 10 to a switch that is
+ * not one. */
+
+#include "latency.h"
+#include "timertest.h"
+
+/* A bucket is halved with all the others of its task before it overflows, so
+the histogram keeps its shape. */
+#define latencyBUCKET_MAX (0xFFFFU)
+
+/*-----------------------------------------------------------*/
+
+/* State of a task, indexed by task number - 1. */
+typedef struct {
+  void *pvTask;
+  /* Time the task became ready, 0 when it is not waiting to run. */
+  unsigned long ulReadyTime;
+  /* Shortest and longest latency. No latency is 0 cycles long, so 0 means
+  none was measured yet. */
+  unsigned long ulMin;
+  unsigned long ulMax;
+  unsigned short usBuckets[latencyBUCKET_COUNT];
+} Latency_t;
+
+static Latency_t xLatency[latencyMAX_TASKS];
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Returns the upper end of a bucket.
+ * @param ulBucket The bucket.
+ * @return unsigned long First latency, in cycles, of the next bucket.
+ */
+static unsigned long prvBucketEnd(unsigned long ulBucket) {
+  return 1UL << (latencyFIRST_BUCKET_BITS + ulBucket);
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Records that a task became ready. Called by the kernel through
+ * traceMOVED_TASK_TO_READY_STATE().
+ * @param pvTask The task.
+ * @param ulTaskNumber Number of the task, as in TaskStatus_t.
+ */
+void vLatencyTaskReady(void *pvTask, unsigned long ulTaskNumber) {
+  Latency_t *pxLatency;
+
+  if (ulTaskNumber - 1UL >= latencyMAX_TASKS) {
+    return;
+  }
+  pxLatency = &xLatency[ulTaskNumber - 1UL];
+
+  /* A task moved between ready lists, for example by priority inheritance,
+   * keeps waiting since the first time. The lowest bit is sacrificed so the
+   * stamp is never 0. */
+  if (pxLatency->ulReadyTime == 0UL) {
+    pxLatency->ulReadyTime = timerGET_CYCLES() | 1UL;
+  }
+  pxLatency->pvTask = pvTask;
+}
+
+/**
+ * @brief Records that a task starts running. Called by the kernel through
+ * traceTASK_SWITCHED_IN().
+ * @param ulTaskNumber Number of the task, as in TaskStatus_t.
+ */
+void vLatencyTaskSwitchedIn(unsigned long ulTaskNumber) {
+  Latency_t *pxLatency;
+  unsigned long ulLatency;
+  long lBucket;
+
+  if (ulTaskNumber - 1UL >= latencyMAX_TASKS) {
+    return;
+  }
+  pxLatency = &xLatency[ulTaskNumber - 1UL];
+
+  /* Resumed after a preemption, not a wakeup. */
+  if (pxLatency->ulReadyTime == 0UL) {
+    return;
+  }
+
+  ulLatency = timerTO_RUN_TIME(timerGET_CYCLES() - pxLatency->ulReadyTime);
+  pxLatency->ulReadyTime = 0UL;
+
+  if (ulLatency < pxLatency->ulMin || pxLatency->ulMin == 0UL) {
+    pxLatency->ulMin = ulLatency;
+  }
+  if (ulLatency > pxLatency->ulMax) {
+    pxLatency->ulMax = ulLatency;
+  }
+
+  /* The bucket is floor(log2(ulLatency)) - latencyFIRST_BUCKET_BITS + 1. */
+  lBucket = (31 - __builtin_clz(ulLatency | 1UL)) -
+            (latencyFIRST_BUCKET_BITS - 1);
+  if (lBucket < 0) {
+    lBucket = 0;
+  } else if (lBucket >= latencyBUCKET_COUNT) {
+    lBucket = latencyBUCKET_COUNT - 1;
+  }
+
+  if (++pxLatency->usBuckets[lBucket] == latencyBUCKET_MAX) {
+    for (int i = 0; i < latencyBUCKET_COUNT; i++) {
+      pxLatency->usBuckets[i] /= 2U;
+    }
+  }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Summarizes the latencies of a task.
+ * @param xTaskNumber Task number, as in TaskStatus_t.
+ * @param pxSummary Where the summary is written.
+ * @return BaseType_t pdFALSE if the task number is not tracked.
+ */
+BaseType_t xLatencyGetSummary(UBaseType_t xTaskNumber,
+                              LatencySummary_t *pxSummary) {
+  Latency_t *pxLatency;
+  unsigned long ulTarget;
+  unsigned long ulSum = 0UL;
+  unsigned long ulBucket = 0UL;
+
+  if (xTaskNumber == 0 || xTaskNumber > latencyMAX_TASKS) {
+    return pdFALSE;
+  }
+  pxLatency = &xLatency[xTaskNumber - 1];
+
+  taskENTER_CRITICAL();
+  pxSummary->xTask = (TaskHandle_t)pxLatency->pvTask;
+  pxSummary->ulMin = pxLatency->ulMin;
+  pxSummary->ulMax = pxLatency->ulMax;
+  pxSummary->ulCount = 0UL;
+  for (int i = 0; i < latencyBUCKET_COUNT; i++) {
+    pxSummary->ulCount += pxLatency->usBuckets[i];
+  }
+
+  /* Find the bucket where the count reaches 99% of the wakeups. */
+  ulTarget = pxSummary->ulCount - pxSummary->ulCount / 100UL;
+  while (ulBucket < latencyBUCKET_COUNT - 1) {
+    ulSum += pxLatency->usBuckets[ulBucket];
+    if (ulSum >= ulTarget) {
+      break;
+    }
+    ulBucket++;
+  }
+  taskEXIT_CRITICAL();
+
+  pxSummary->ulP99 = prvBucketEnd(ulBucket);
+  if (pxSummary->ulP99 > pxSummary->ulMax) {
+    pxSummary->ulP99 = pxSummary->ulMax;
+  }
+
+  return pdTRUE;
+}
+
+/**
+ * @brief Copies the histogram of a task.
+ * @param xTaskNumber Task number, as in TaskStatus_t.
+ * @param pusBuckets Array of latencyBUCKET_COUNT counts.
+ * @return BaseType_t pdFALSE if the task number is not tracked.
+ */
+BaseType_t xLatencyGetHistogram(UBaseType_t xTaskNumber,
+                                unsigned short *pusBuckets) {
+  if (xTaskNumber == 0 || xTaskNumber > latencyMAX_TASKS) {
+    return pdFALSE;
+  }
+
+  taskENTER_CRITICAL();
+  for (int i = 0; i < latencyBUCKET_COUNT; i++) {
+    pusBuckets[i] = xLatency[xTaskNumber - 1].usBuckets[i];
+  }
+  taskEXIT_CRITICAL();
+
+  return pdTRUE;
+}
+
+/**
+ * @brief Clears the histograms and the minimum and maximum latencies of every
+ * task.
+ */
+void vLatencyReset(void) {
+  taskENTER_CRITICAL();
+  for (int x = 0; x < latencyMAX_TASKS; x++) {
+    xLatency[x].ulMin = 0UL;
+    xLatency[x].ulMax = 0UL;
+    for (int i = 0; i < latencyBUCKET_COUNT; i++) {
+      xLatency[x].usBuckets[i] = 0U;
+    }
+  }
+  taskEXIT_CRITICAL();
+}
@@ -0,0 +1,36 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Highest task number tracked by the latency histograms. */
+#define latencyMAX_TASKS (8)
+
+/* Buckets of the histograms. Bucket 0 counts the latencies below
+ * 2^latencyFIRST_BUCKET_BITS cycles of the run time clock and every following
+ * bucket covers twice the range of the previous one. The last bucket also
+ * counts everything longer. The run time clock counts at 20MHz, so they go
+ * from 3.2us to 52ms. */
+#define latencyBUCKET_COUNT (16)
+#define latencyFIRST_BUCKET_BITS (6)
+
+/* Summary of the wakeup latencies of a task, in run time clock cycles. */
+typedef struct {
+  TaskHandle_t xTask;    /* The task, NULL if it never became ready. */
+  unsigned long ulCount; /* Wakeups counted in the histogram. */
+  unsigned long ulMin;
+  unsigned long ulMax;
+  unsigned long ulP99; /* Upper end of the bucket holding the 99th
+                        * percentile, at most ulMax. */
+} LatencySummary_t;
+
+void vLatencyTaskReady(void *pvTask, unsigned long ulTaskNumber);
+void vLatencyTaskSwitchedIn(unsigned long ulTaskNumber);
+BaseType_t xLatencyGetSummary(UBaseType_t xTaskNumber,
+                              LatencySummary_t *pxSummary);
+BaseType_t xLatencyGetHistogram(UBaseType_t xTaskNumber,
+                                unsigned short *pusBuckets);
+void vLatencyReset(void);
+
+#endif /* LATENCY_H */
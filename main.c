@@ -1,53 +1,237 @@
+/* Standard includes. */
+#include <string.h>
+
 /* Environment includes. */
 #include "DriverLib.h"
 
 /* Scheduler includes. */
 #include "FreeRTOS.h"
+#include "filter.h"
+#include "graph.h"
+#include "heapstats.h"
 #include "hw_memmap.h"
+#include "isrstats.h"
+#include "latency.h"
+#include "periodic.h"
 #include "portable.h"
+#include "power.h"
 #include "queue.h"
+#include "sampler.h"
 #include "semphr.h"
+#include "serial.h"
+#include "stackprof.h"
+#include "stats.h"
 #include "task.h"
+#include "telemetry.h"
+#include "tickless.h"
+#include "timertest.h"
 #include "uart.h"
 
-#define OLED_WIDTH 96
-#define OLED_HEIGHT 16
-#define MAX_FILTER_SIZE 50
-
-/* Delay between cycles of the 'sensor' task. */
-#define mainSENSOR_DELAY ((TickType_t)100 / portTICK_PERIOD_MS)
-
-/* Delay between cycles of the 'monitor' task. */
-#define mainMONITOR_DELAY ((TickType_t)1000 / portTICK_PERIOD_MS)
+/* Initial sample rate of the sampler, see sampler.h. */
+#define mainSENSOR_RATE_HZ (10UL)
+
+/* Samples are passed from the sensor to the filter and from the filter to the
+graficar task in blocks of up to mainBLOCK_SIZE samples, so the queue and
+context switch costs are paid once per block instead of once per sample. When
+the sampler does not fill a block within mainBLOCK_DEADLINE, the samples taken
+so far are sent in a partial block. Set mainBLOCK_SIZE to 1 to send every
+sample on its own. */
+#define mainBLOCK_SIZE (8)
+#define mainBLOCK_COUNT (3)
+#define mainBLOCK_DEADLINE ((TickType_t)100 / portTICK_PERIOD_MS)
+
+/* Vertical scale of the graph in sample units. Set both to 0 to follow the
+signal, or for example to 0 and samplerFULL_SCALE - 1 for a fixed scale. */
+#define mainGRAPH_MIN (0)
+#define mainGRAPH_MAX (0)
+
+/* Rate at which the graph advances one column. At higher sample rates each
+column shows the minimum and maximum of the samples it covers. */
+#define mainGRAPH_COLUMN_RATE_HZ (10UL)
+
+/* Filter configuration pushed by the command task to the filter task, packed
+in a single notification value so N and the kernel always change together. */
+#define mainCONFIG_N_MASK (0xFFUL)
+#define mainCONFIG_KIND_SHIFT (8)
+#define mainCONFIG(N, kind)                                                    \
+  (((unsigned long)(kind) << mainCONFIG_KIND_SHIFT) |                          \
+   ((unsigned long)(N) & mainCONFIG_N_MASK))
+
+/* Longest command line accepted by the command task, without terminator. */
+#define mainCOMMAND_MAX_LEN (15)
+
+/* Delay between cycles of the 'monitor' task, which updates the run time
+statistics. */
+#define mainMONITOR_DELAY ((TickType_t)statsUPDATE_PERIOD_MS / portTICK_PERIOD_MS)
+
+/* Layout of the monitor screen, rows and columns start at 1 as in the ANSI
+cursor position sequence. The first task is on mainMONITOR_FIRST_ROW, and the
+CPU usage of every window takes mainMONITOR_CPU_WIDTH columns. */
+#define mainMONITOR_FIRST_ROW (3)
+#define mainMONITOR_CPU_COL (11)
+#define mainMONITOR_CPU_WIDTH (5)
+#define mainMONITOR_STATE_COL (27)
+#define mainMONITOR_STACK_COL (38)
+#define mainMONITOR_LATENCY_COL (45)
+#define mainMONITOR_LATENCY_WIDTH (7)
+
+/* Columns of the interrupt rows, which follow the tasks when
+configUSE_ISR_STATS is 1. */
+#define mainMONITOR_ISR_CALLS_COL mainMONITOR_STATE_COL
+#define mainMONITOR_ISR_MAX_COL mainMONITOR_STACK_COL
+#define mainMONITOR_ISR_NESTING_COL mainMONITOR_LATENCY_COL
+
+/* Durations are measured in run time clock cycles, at configCPU_CLOCK_HZ
+whatever the processor clock, and shown in us. */
+#define mainCYCLES_PER_US (configCPU_CLOCK_HZ / 1000000UL)
+
+/* The monitor only sends the fields that changed, but redraws the whole screen
+every mainMONITOR_FULL_REFRESH cycles in case the terminal lost it. */
+#define mainMONITOR_FULL_REFRESH (30)
+
+/* CPU usage values as shown by the monitor, see prvCpuShown(). */
+#define mainMONITOR_CPU_BELOW_1 (101)
+
+/* Number of values in the heap rows of the monitor. */
+#define mainMONITOR_HEAP_FIELDS (9)
+
+/* Number of values in the tickless idle row of the monitor. */
+#define mainMONITOR_TICKLESS_FIELDS (4)
+
+/* Number of values in a periodic task row of the monitor. */
+#define mainMONITOR_PERIODIC_FIELDS (5)
+
+#if configUSE_TASK_BUDGETS == 1
+/* Processor time the monitor and command tasks may use per period, in run time
+clock cycles. Beyond it they drop to configBUDGET_DEMOTED_PRIORITY until the
+period ends, so a long report or a burst of commands cannot hold up the filter
+and graficar tasks. */
+#define mainMONITOR_BUDGET (200UL * 1000UL * mainCYCLES_PER_US)
+#define mainMONITOR_BUDGET_PERIOD (mainMONITOR_DELAY)
+#define mainCOMMAND_BUDGET (10UL * 1000UL * mainCYCLES_PER_US)
+#define mainCOMMAND_BUDGET_PERIOD (pdMS_TO_TICKS(100))
+
+/* Number of tasks in the budget row of the monitor. */
+#define mainMONITOR_BUDGET_FIELDS (2)
+#endif
+
+/* Size of the buffer where the monitor output is formatted. */
+#define mainMONITOR_BUFFER_SIZE (128)
+
+/* Stack size of a task in words. stacksizes.h gives the size measured by the
+stack profiling mode, which adds room to measure beyond it. */
+#define mainSTACK(words) ((words) + configSTACK_PROFILE_EXTRA)
 
 /* Task priorities. */
 #define mainSENSOR_TASK_PRIORITY (tskIDLE_PRIORITY + 3)
-
-/* UART configuration - note this does not use the FIFO so is not very
-efficient. */
+#if configUSE_EDF_SCHEDULING == 1
+/* The filter, graficar and monitor tasks are scheduled by deadline at
+configEDF_PRIORITY, and the command task waits below them. */
+#define mainFILTER_TASK_PRIORITY (configEDF_PRIORITY)
+#define mainMONITOR_TASK_PRIORITY (configEDF_PRIORITY)
+#define mainCOMMAND_TASK_PRIORITY (configEDF_PRIORITY - 1)
+
+/* The EDF period of the filter and graficar tasks is the time between two
+blocks: mainBLOCK_SIZE samples at the sample rate, or mainBLOCK_DEADLINE when
+the sampler sends partial blocks, rounded down to whole ticks and at least one.
+It follows the sample rate, see prvSetBlockPeriod(). The output of a block
+should be on the graph within a period, and the filter gets half of it. */
+#define mainBLOCK_PERIOD(rate)                                                 \
+  ((TickType_t)((mainBLOCK_SIZE * configTICK_RATE_HZ) / (rate)))
+#else
+#define mainFILTER_TASK_PRIORITY (mainSENSOR_TASK_PRIORITY - 1)
+#define mainMONITOR_TASK_PRIORITY (mainSENSOR_TASK_PRIORITY - 2)
+#define mainCOMMAND_TASK_PRIORITY (mainSENSOR_TASK_PRIORITY - 1)
+#endif
+
+#if configUSE_PREEMPTION_THRESHOLDS == 1
+/* Once the filter or graficar task works on a block, neither the other one,
+the command task nor the sensor task preempts it. The sampler keeps collecting
+samples in its buffer meanwhile, the sensor task only moves them into blocks,
+so it can wait for the end of the job. tools/kernelbench/switchbench.c counts
+the switches this saves. */
+#define mainFILTER_TASK_THRESHOLD (mainSENSOR_TASK_PRIORITY)
+#endif
+
+/* UART configuration - transmission is interrupt driven and uses the FIFO, see
+serial.c. */
 #define mainBAUD_RATE (19200)
 
+/* Block of samples. Blocks are preallocated and only their pointers travel
+through the queues, from the free pool to the sensor, filter and graficar tasks
+and back to the pool. */
+typedef struct {
+  int count;
+  int values[mainBLOCK_SIZE];
+} SampleBlock_t;
+
+/* Position of a numeric field of the monitor, see prvMonitorRow(): row offset,
+column of the label, and column and width of the value. */
+typedef struct {
+  unsigned char ucRow;
+  unsigned char ucLabelCol;
+  unsigned char ucValueCol;
+  unsigned char ucWidth;
+} MonitorField_t;
+
 /* Function prototypes */
 static void prvSetupHardware(void);
 void vCreateQueues(void);
 void vCreateTasks(void);
 void vIntToString(int value, char *string);
-void vSetupHighFrequencyTimer(void);
 static void vSensorTask(void *pvParameters);
 static void vFilterTask(void *pvParameters);
 static void vGraficarTask(void *pvParameters);
 static void vMonitorTask(void *pvParameters);
+static void vCommandTask(void *pvParameters);
 void vSendStringToUart(const char *string);
 void vPrintSystemStats(unsigned long uxArraySize,
-                       TaskStatus_t *pxTaskStatusArray);
-int vUpdateN(int N);
-void addValueToSignal(unsigned char image[OLED_WIDTH * 2], int value);
+                       TaskStatus_t *pxTaskStatusArray,
+                       TaskStatus_t *pxPreviousArray);
+BaseType_t xExecuteCommand(char *pcLine);
+static void prvLatencyExport(void);
+#if configUSE_STACK_PROFILE == 1
+static void prvStackReport(void);
+#endif
+#if configUSE_TRACE_RECORDER == 1
+static void prvTraceExport(void);
+#endif
+static void prvDeadlineMissed(Periodic_t *pxPeriodic, TickType_t xLateTicks);
+#if configUSE_EDF_SCHEDULING == 1
+static void prvSetBlockPeriod(unsigned long ulRate);
+#endif
+void vUpdateFilter(Filter_t *pxFilter);
 void vApplicationStackOverflowHook(TaskHandle_t xTask, char *pcTaskName);
+void vApplicationIdleHook(void);
 
 /* Queues used to communicate between tasks. */
 QueueHandle_t xFilterGraficarQueue;
 QueueHandle_t xSensorFilterQueue;
-QueueHandle_t xUartFilterQueue;
+QueueHandle_t xFreeBlockQueue;
+
+/* The command task notifies the filter task of configuration changes. */
+static TaskHandle_t xFilterTaskHandle = NULL;
+
+#if configUSE_EDF_SCHEDULING == 1
+/* The command task gives it a new EDF period when the sample rate changes. */
+static TaskHandle_t xGraficTaskHandle = NULL;
+#endif
+
+#if configUSE_TASK_BUDGETS == 1
+/* Tasks with a processor time budget: the monitor and command tasks. */
+static TaskHandle_t xBudgetTasks[mainMONITOR_BUDGET_FIELDS];
+#endif
+
+/* Configuration last sent to the filter task, which starts with N = 1 and the
+moving average. */
+static int iConfigN = 1;
+static FilterKind_t xConfigKind = eFilterMean;
+
+/* Sample blocks in circulation between the tasks. */
+static SampleBlock_t xSampleBlocks[mainBLOCK_COUNT];
+
+/* The monitor task runs once per mainMONITOR_DELAY, see periodic.c. */
+static Periodic_t xMonitorPeriodic;
 
 /*-----------------------------------------------------------*/
 
@@ -57,6 +241,14 @@ QueueHandle_t xUartFilterQueue;
  * @return int 0 if the function completes successfully.
  */
 int main(void) {
+#if configUSE_STACK_PROFILE == 1
+  /* Paint the main stack before it gets any deeper. */
+  vStackProfileInit();
+#endif
+
+  /* Give the heap its memory before anything is allocated. */
+  vHeapStatsInit();
+
   /* Configure the clocks, UART and GPIO. */
   prvSetupHardware();
 
@@ -76,11 +268,10 @@ int main(void) {
  * @brief Configures the clock, OLED display, timer and UART.
  */
 static void prvSetupHardware(void) {
-  /* Setup the PLL. */
-  SysCtlClockSet(SYSCTL_SYSDIV_10 | SYSCTL_USE_PLL | SYSCTL_OSC_MAIN |
-                 SYSCTL_XTAL_6MHZ);
+  /* Setup the PLL, at the fastest clock until the governor lowers it. */
+  vPowerInit();
 
-  /* Configure the high frequency interrupt used to measure CPU usage. */
+  /* Configure the free running timer used to measure CPU usage. */
   vSetupHighFrequencyTimer();
 
   /* Initialise the LCD. */
@@ -88,13 +279,8 @@ static void prvSetupHardware(void) {
   OSRAMStringDraw("ICOM SO II", 0, 0);
   OSRAMStringDraw("TP4 LM3S811", 16, 1);
 
-  /* Enable the UART. */
-  SysCtlPeripheralEnable(SYSCTL_PERIPH_UART0);
-
-  /* Configure the UART for 8-N-1 operation. */
-  UARTConfigSet(UART0_BASE, mainBAUD_RATE,
-                UART_CONFIG_WLEN_8 | UART_CONFIG_PAR_NONE |
-                    UART_CONFIG_STOP_ONE);
+  /* Configure the UART and its transmit buffer. */
+  vSerialInit(mainBAUD_RATE);
 }
 
 /*-----------------------------------------------------------*/
@@ -103,22 +289,75 @@ static void prvSetupHardware(void) {
  * @brief Creates the tasks and the message queues.
  */
 void vCreateTasks(void) {
+  TaskHandle_t xGraficTask, xMonitorTask, xCommandTask;
+
   /* Create the queues used by the tasks. */
   vCreateQueues();
 
   /* Start the tasks defined within the file. */
-  xTaskCreate(vSensorTask, "Sensor", configMINIMAL_STACK_SIZE, NULL,
+  /* The stack sizes come from stacksizes.h, see stackprof.c. The task names
+   * must match the names there. */
+  xTaskCreate(vSensorTask, "Sensor", mainSTACK(stackSENSOR_WORDS), NULL,
               mainSENSOR_TASK_PRIORITY, NULL);
 
-  xTaskCreate(vFilterTask, "Filter", configMINIMAL_STACK_SIZE, NULL,
-              mainSENSOR_TASK_PRIORITY - 1, NULL);
+  xTaskCreate(vFilterTask, "Filter", mainSTACK(stackFILTER_WORDS), NULL,
+              mainFILTER_TASK_PRIORITY, &xFilterTaskHandle);
+
+  xTaskCreate(vGraficarTask, "Grafic", mainSTACK(stackGRAFIC_WORDS), NULL,
+              mainFILTER_TASK_PRIORITY, &xGraficTask);
+
+  xTaskCreate(vMonitorTask, "Monitor", mainSTACK(stackMONITOR_WORDS), NULL,
+              mainMONITOR_TASK_PRIORITY, &xMonitorTask);
+
+  xTaskCreate(vCommandTask, "Command", mainSTACK(stackCOMMAND_WORDS), NULL,
+              mainCOMMAND_TASK_PRIORITY, &xCommandTask);
+
+#if configUSE_PREEMPTION_THRESHOLDS == 1
+  vTaskSetPreemptionThreshold(xFilterTaskHandle, mainFILTER_TASK_THRESHOLD);
+  vTaskSetPreemptionThreshold(xGraficTask, mainFILTER_TASK_THRESHOLD);
+#endif
+
+#if configUSE_TASK_BUDGETS == 1
+  vTaskSetCpuBudget(xMonitorTask, mainMONITOR_BUDGET,
+                    mainMONITOR_BUDGET_PERIOD);
+  vTaskSetCpuBudget(xCommandTask, mainCOMMAND_BUDGET,
+                    mainCOMMAND_BUDGET_PERIOD);
+  xBudgetTasks[0] = xMonitorTask;
+  xBudgetTasks[1] = xCommandTask;
+#else
+  (void)xCommandTask;
+#endif
+
+#if configUSE_EDF_SCHEDULING == 1
+  xGraficTaskHandle = xGraficTask;
+  prvSetBlockPeriod(mainSENSOR_RATE_HZ);
+  vTaskSetEdfParameters(xMonitorTask, mainMONITOR_DELAY, mainMONITOR_DELAY);
+#else
+  (void)xGraficTask;
+  (void)xMonitorTask;
+#endif
+}
 
-  xTaskCreate(vGraficarTask, "Grafic", configMINIMAL_STACK_SIZE, NULL,
-              mainSENSOR_TASK_PRIORITY - 1, NULL);
+#if configUSE_EDF_SCHEDULING == 1
+/**
+ * @brief Gives the filter and graficar tasks the EDF period and deadlines of
+ * the blocks at a sample rate. Called again when the rate changes.
+ * @param ulRate Sample rate in Hz.
+ */
+static void prvSetBlockPeriod(unsigned long ulRate) {
+  TickType_t xPeriod = mainBLOCK_PERIOD(ulRate);
 
-  xTaskCreate(vMonitorTask, "Monitor", configMINIMAL_STACK_SIZE, NULL,
-              mainSENSOR_TASK_PRIORITY - 2, NULL);
+  if (xPeriod > mainBLOCK_DEADLINE) {
+    xPeriod = mainBLOCK_DEADLINE;
+  } else if (xPeriod < 1) {
+    xPeriod = 1;
+  }
+
+  vTaskSetEdfParameters(xFilterTaskHandle, xPeriod,
+                        (xPeriod > 1) ? xPeriod / 2 : 1);
+  vTaskSetEdfParameters(xGraficTaskHandle, xPeriod, xPeriod);
 }
+#endif
 
 /*-----------------------------------------------------------*/
 
@@ -126,261 +365,1132 @@ void vCreateTasks(void) {
  * @brief Creates the queues used by the tasks.
  */
 void vCreateQueues(void) {
-  xFilterGraficarQueue = xQueueCreate(10, sizeof(int));
-  xSensorFilterQueue = xQueueCreate(10, sizeof(int));
-  xUartFilterQueue = xQueueCreate(10, sizeof(int));
+  /* The block queues hold pointers and are as long as the number of blocks,
+   * so sending a block never blocks. */
+  xFilterGraficarQueue =
+      xQueueCreate(mainBLOCK_COUNT, sizeof(SampleBlock_t *));
+  xSensorFilterQueue = xQueueCreate(mainBLOCK_COUNT, sizeof(SampleBlock_t *));
+  xFreeBlockQueue = xQueueCreate(mainBLOCK_COUNT, sizeof(SampleBlock_t *));
 
   if (xFilterGraficarQueue == NULL || xSensorFilterQueue == NULL ||
-      xUartFilterQueue == NULL) {
+      xFreeBlockQueue == NULL) {
     /* One or more queues were not created successfully as there was not enough
      * heap memory available. */
     for (;;)
       ;
   }
+
+#if configUSE_TRACE_RECORDER == 1
+  vTraceNameQueue(xSensorFilterQueue, "SensorFilter");
+  vTraceNameQueue(xFilterGraficarQueue, "FilterGraficar");
+  vTraceNameQueue(xFreeBlockQueue, "FreeBlock");
+#endif
+
+  /* Fill the pool with every block. */
+  for (int i = 0; i < mainBLOCK_COUNT; i++) {
+    SampleBlock_t *pxBlock = &xSampleBlocks[i];
+    xQueueSend(xFreeBlockQueue, &pxBlock, 0);
+  }
 }
 
 /*-----------------------------------------------------------*/
 
+/**
+ * @brief Returns how busy the processor was during the last monitor interval,
+ * everything but the idle task.
+ * @param pxTaskStatusArray Snapshot taken by vPrintSystemStats().
+ * @param uxArraySize Size of the snapshot.
+ * @return unsigned long Load in hundredths of a percent.
+ */
+static unsigned long prvBusyLoad(const TaskStatus_t *pxTaskStatusArray,
+                                 UBaseType_t uxArraySize) {
+  TaskHandle_t xIdle = xTaskGetIdleTaskHandle();
+
+  for (UBaseType_t x = 0; x < uxArraySize; x++) {
+    if (pxTaskStatusArray[x].xHandle == xIdle) {
+      unsigned long ulIdle =
+          ulStatsGetLoad(pxTaskStatusArray[x].xTaskNumber, eStatsWindow1s);
+
+      return (ulIdle < 10000UL) ? 10000UL - ulIdle : 0UL;
+    }
+  }
+  return 10000UL;
+}
+
 /**
  * @brief Monitors the system and prints system stats.
  * @param pvParameter unused.
  */
 static void vMonitorTask(void *pvParameter) {
-  TickType_t xLastExecutionTime;
-  xLastExecutionTime = xTaskGetTickCount();
-
-  // allocate enough space for every task
-  TaskStatus_t *pxTaskStatusArray;
+  // allocate enough space for every task, twice: the snapshot being taken and
+  // the previous one, which is what the screen shows
+  TaskStatus_t *pxTaskStatusArrays[2];
   volatile UBaseType_t uxArraySize;
+  int current = 0;
   uxArraySize = uxTaskGetNumberOfTasks();
-  pxTaskStatusArray = pvPortMalloc(uxArraySize * sizeof(TaskStatus_t));
-  if (pxTaskStatusArray == NULL) {
+  pxTaskStatusArrays[0] = pvPortMalloc(uxArraySize * sizeof(TaskStatus_t));
+  pxTaskStatusArrays[1] = pvPortMalloc(uxArraySize * sizeof(TaskStatus_t));
+  if (pxTaskStatusArrays[0] == NULL || pxTaskStatusArrays[1] == NULL) {
     for (;;)
       ;
   }
 
+  vPeriodicStart(&xMonitorPeriodic, mainMONITOR_DELAY, 0, prvDeadlineMissed);
   for (;;) {
-    vTaskDelayUntil(&xLastExecutionTime, mainMONITOR_DELAY);
-    vPrintSystemStats(uxArraySize, pxTaskStatusArray);
+    xPeriodicWait(&xMonitorPeriodic);
+    vPrintSystemStats(uxArraySize, pxTaskStatusArrays[current],
+                      pxTaskStatusArrays[current ^ 1]);
+
+    /* Pick the processor clock for the next interval from the load of this
+     * one. */
+    vPowerGovern(prvBusyLoad(pxTaskStatusArrays[current], uxArraySize));
+    current ^= 1;
+  }
+}
+
+/* Monitor output buffer. The text of a refresh is accumulated here and handed
+to the UART in as few writes as possible. */
+static char cMonitorBuffer[mainMONITOR_BUFFER_SIZE];
+static size_t xMonitorLength = 0;
+
+/**
+ * @brief Sends the accumulated monitor output to the UART.
+ */
+static void prvMonitorFlush(void) {
+  if (xMonitorLength > 0) {
+    xSerialWrite(cMonitorBuffer, xMonitorLength);
+    xMonitorLength = 0;
+  }
+}
+
+/**
+ * @brief Appends a string to the monitor output.
+ * @param string Null terminated string.
+ */
+static void prvMonitorPut(const char *string) {
+  while (*string != '\0') {
+    if (xMonitorLength == mainMONITOR_BUFFER_SIZE) {
+      prvMonitorFlush();
+    }
+    cMonitorBuffer[xMonitorLength++] = *string++;
+  }
+}
+
+/**
+ * @brief Appends the ANSI sequence that moves the cursor to a position.
+ * @param row Row, starting at 1.
+ * @param col Column, starting at 1.
+ */
+static void prvMonitorGoto(int row, int col) {
+  char temp[10];
+
+  prvMonitorPut("\x1B[");
+  vIntToString(row, temp);
+  prvMonitorPut(temp);
+  prvMonitorPut(";");
+  vIntToString(col, temp);
+  prvMonitorPut(temp);
+  prvMonitorPut("H");
+}
+
+/**
+ * @brief Writes a field at a position, padded with spaces to its width so it
+ * overwrites any longer previous value.
+ * @param row Row, starting at 1.
+ * @param col Column, starting at 1.
+ * @param text Field text.
+ * @param width Field width.
+ */
+static void prvMonitorField(int row, int col, const char *text, int width) {
+  prvMonitorGoto(row, col);
+  prvMonitorPut(text);
+  for (int i = strlen(text); i < width; i++) {
+    prvMonitorPut(" ");
+  }
+}
+
+/**
+ * @brief Prints a group of numeric fields of the monitor. The labels are only
+ * written when xFull is pdTRUE. With a cache of the values shown, only the
+ * values that changed are written unless xFull is pdTRUE, and values above
+ * 0xFFFF, the most the cache keeps, show as 0xFFFF. Without one every value is
+ * written.
+ * @param row Row the row offsets of the fields count from.
+ * @param xFull pdTRUE to write the labels and every value.
+ * @param pxFields Position of every field.
+ * @param pcLabels Label of every field, NULL for none.
+ * @param ulValues Value of every field, NULL to write only the labels.
+ * @param usShown Value shown of every field, NULL for no cache.
+ * @param iFields Number of fields.
+ */
+static void prvMonitorRow(int row, BaseType_t xFull,
+                          const MonitorField_t *pxFields,
+                          const char *const *pcLabels,
+                          const unsigned long *ulValues,
+                          unsigned short *usShown, int iFields) {
+  char temp[10];
+
+  for (int i = 0; i < iFields; i++) {
+    const MonitorField_t *pxField = &pxFields[i];
+    unsigned long ulValue;
+
+    if (xFull == pdTRUE && pcLabels != NULL) {
+      prvMonitorField(row + pxField->ucRow, pxField->ucLabelCol, pcLabels[i],
+                      0);
+    }
+    if (ulValues == NULL) {
+      continue;
+    }
+    ulValue = ulValues[i];
+    if (usShown != NULL) {
+      if (ulValue > 0xFFFFUL) {
+        ulValue = 0xFFFFUL;
+      }
+      if (xFull != pdTRUE && ulValue == usShown[i]) {
+        continue;
+      }
+      usShown[i] = (unsigned short)ulValue;
+    }
+    vIntToString((int)ulValue, temp);
+    prvMonitorField(row + pxField->ucRow, pxField->ucValueCol, temp,
+                    pxField->ucWidth);
+  }
+}
+
+/**
+ * @brief Rounds a CPU usage to what the monitor shows: whole percents, or
+ * mainMONITOR_CPU_BELOW_1 for usages under 1%.
+ * @param ulLoad Usage in hundredths of a percent.
+ * @return unsigned char Value shown.
+ */
+static unsigned char prvCpuShown(unsigned long ulLoad) {
+  if (ulLoad > 0 && ulLoad < 100) {
+    return mainMONITOR_CPU_BELOW_1;
   }
+  return (unsigned char)(ulLoad / 100);
 }
 
 /**
- * @brief Prints the system stats to UART.
- * @param uxArraySize Size of the task status array.
- * @param pxTaskStatusArray Array of task statuses.
+ * @brief Formats a CPU usage returned by prvCpuShown().
+ * @param ucShown Value shown.
+ * @param text Buffer of at least 10 characters for the result.
+ */
+static void prvCpuText(unsigned char ucShown, char *text) {
+  if (ucShown == mainMONITOR_CPU_BELOW_1) {
+    strcpy(text, "<1");
+  } else {
+    vIntToString(ucShown, text);
+  }
+}
+
+/**
+ * @brief Finds a task in a snapshot.
+ * @param pxTaskStatusArray Snapshot.
+ * @param uxArraySize Number of entries in the snapshot.
+ * @param xTaskNumber Number of the task.
+ * @return TaskStatus_t* The entry of the task, NULL if it is not there.
+ */
+static TaskStatus_t *prvFindTask(TaskStatus_t *pxTaskStatusArray,
+                                 UBaseType_t uxArraySize,
+                                 UBaseType_t xTaskNumber) {
+  for (UBaseType_t x = 0; x < uxArraySize; x++) {
+    if (pxTaskStatusArray[x].xTaskNumber == xTaskNumber) {
+      return &pxTaskStatusArray[x];
+    }
+  }
+  return NULL;
+}
+
+#if configUSE_ISR_STATS == 1
+/**
+ * @brief Prints the interrupt rows of the monitor: the CPU usage of every
+ * handler during the last interval, how many times it ran and its longest
+ * run, plus the deepest nesting of handlers seen. Like the task rows, only
+ * the fields that changed are written unless xFull is pdTRUE.
+ * @param row Row of the header, followed by one row per interrupt.
+ * @param xFull pdTRUE to write every field.
+ * @param xInterval Run time elapsed since the previous call.
+ */
+static void prvPrintIsrStats(int row, BaseType_t xFull,
+                             configRUN_TIME_COUNTER_TYPE xInterval) {
+  static const int columns[3] = {mainMONITOR_CPU_COL, mainMONITOR_ISR_CALLS_COL,
+                                 mainMONITOR_ISR_MAX_COL};
+  static uint64_t ullPreviousTime[eIsrCount];
+  static unsigned long ulPreviousCount[eIsrCount];
+  static unsigned short usShown[eIsrCount][3];
+  static unsigned long ulNestingShown = 0;
+  unsigned long ulNesting = ulIsrStatsGetMaxNesting();
+  IsrStats_t xStats;
+  char temp[10];
+
+  if (xFull == pdTRUE) {
+    prvMonitorField(row, 1, "ISR", 0);
+    prvMonitorField(row, mainMONITOR_CPU_COL, "1s%", 0);
+    prvMonitorField(row, mainMONITOR_ISR_CALLS_COL, "calls/s", 0);
+    prvMonitorField(row, mainMONITOR_ISR_MAX_COL, "max us", 0);
+    prvMonitorField(row, mainMONITOR_ISR_NESTING_COL, "nesting:", 0);
+  }
+  if (xFull == pdTRUE || ulNesting != ulNestingShown) {
+    vIntToString((int)ulNesting, temp);
+    prvMonitorField(row, mainMONITOR_ISR_NESTING_COL + 9, temp, 0);
+    ulNestingShown = ulNesting;
+  }
+
+  for (int i = 0; i < eIsrCount; i++) {
+    unsigned long ulValues[3];
+
+    vIsrStatsGet((IsrId_t)i, &xStats);
+    ulValues[0] = 0;
+    if (xInterval > 0) {
+      ulValues[0] = prvCpuShown((unsigned long)(
+          ((xStats.ullTime - ullPreviousTime[i]) * 10000ULL) / xInterval));
+    }
+    ulValues[1] = xStats.ulCount - ulPreviousCount[i];
+    ulValues[2] = xStats.ulMax / mainCYCLES_PER_US;
+    ullPreviousTime[i] = xStats.ullTime;
+    ulPreviousCount[i] = xStats.ulCount;
+
+    if (xFull == pdTRUE) {
+      prvMonitorField(row + 1 + i, 1, pcIsrStatsGetName((IsrId_t)i), 0);
+    }
+    for (int k = 0; k < 3; k++) {
+      if (ulValues[k] > 0xFFFFUL) {
+        ulValues[k] = 0xFFFFUL;
+      }
+      if (xFull == pdTRUE || ulValues[k] != usShown[i][k]) {
+        if (k == 0) {
+          prvCpuText((unsigned char)ulValues[k], temp);
+        } else {
+          vIntToString((int)ulValues[k], temp);
+        }
+        prvMonitorField(row + 1 + i, columns[k], temp, 7);
+        usShown[i][k] = (unsigned short)ulValues[k];
+      }
+    }
+  }
+}
+#endif
+
+/**
+ * @brief Returns the average duration of the calls to an allocator function.
+ * @param pxStats Statistics of the function.
+ * @return unsigned long Average in us, 0 if it was never called.
+ */
+static unsigned long prvAverageUs(const HeapCallStats_t *pxStats) {
+  if (pxStats->ulCalls == 0) {
+    return 0;
+  }
+  return (unsigned long)(pxStats->ullCycles / pxStats->ulCalls) /
+         mainCYCLES_PER_US;
+}
+
+/**
+ * @brief Prints the heap rows of the monitor: free bytes now and at the
+ * lowest, largest free block and number of free blocks, failed allocations,
+ * and the average and longest duration of pvPortMalloc() and vPortFree().
+ * Only the fields that changed are written unless xFull is pdTRUE.
+ * @param row First of the two rows.
+ * @param xFull pdTRUE to write every field.
+ */
+static void prvPrintHeapStats(int row, BaseType_t xFull) {
+  static const char *const pcLabels[mainMONITOR_HEAP_FIELDS] = {
+      "Heap free:",     "min:", "largest:",    "blocks:", "failed:",
+      "malloc us avg:", "max:", "free us avg:", "max:"};
+  static const MonitorField_t xFields[mainMONITOR_HEAP_FIELDS] = {
+      {0, 1, 12, 5},  {0, 18, 23, 5}, {0, 29, 38, 5},
+      {0, 44, 52, 5}, {0, 58, 66, 5}, {1, 1, 16, 5},
+      {1, 22, 27, 5}, {1, 33, 46, 5}, {1, 52, 57, 5}};
+  static unsigned short usShown[mainMONITOR_HEAP_FIELDS];
+  HeapReport_t xReport;
+  unsigned long ulValues[mainMONITOR_HEAP_FIELDS];
+
+  vHeapStatsGet(&xReport);
+  ulValues[0] = xReport.xHeap.xAvailableHeapSpaceInBytes;
+  ulValues[1] = xReport.xHeap.xMinimumEverFreeBytesRemaining;
+  ulValues[2] = xReport.xHeap.xSizeOfLargestFreeBlockInBytes;
+  ulValues[3] = xReport.xHeap.xNumberOfFreeBlocks;
+  ulValues[4] = xReport.ulFailed;
+  ulValues[5] = prvAverageUs(&xReport.xMalloc);
+  ulValues[6] = xReport.xMalloc.ulMax / mainCYCLES_PER_US;
+  ulValues[7] = prvAverageUs(&xReport.xFree);
+  ulValues[8] = xReport.xFree.ulMax / mainCYCLES_PER_US;
+
+  prvMonitorRow(row, xFull, xFields, pcLabels, ulValues, usShown,
+                mainMONITOR_HEAP_FIELDS);
+}
+
+#if configUSE_TICKLESS_IDLE == 1
+/**
+ * @brief Prints the tickless idle row of the monitor: the sleeps and the tick
+ * interrupts they saved during the last interval, the largest tick error and
+ * the number of times the tick had to be resynchronized. Only the fields that
+ * changed are written unless xFull is pdTRUE.
+ * @param row Row of the values.
+ * @param xFull pdTRUE to write every field.
+ */
+static void prvPrintTicklessStats(int row, BaseType_t xFull) {
+  static const char *const pcLabels[mainMONITOR_TICKLESS_FIELDS] = {
+      "Tickless sleeps/s:", "skipped ticks/s:", "err cyc:", "resyncs:"};
+  static const MonitorField_t xFields[mainMONITOR_TICKLESS_FIELDS] = {
+      {0, 1, 20, 5}, {0, 26, 43, 5}, {0, 49, 58, 5}, {0, 64, 73, 5}};
+  static unsigned long ulPreviousSleeps = 0UL;
+  static unsigned long ulPreviousSkipped = 0UL;
+  static unsigned short usShown[mainMONITOR_TICKLESS_FIELDS];
+  TicklessStats_t xStats;
+  unsigned long ulValues[mainMONITOR_TICKLESS_FIELDS];
+
+  vTicklessGetStats(&xStats);
+  ulValues[0] = xStats.ulSleeps - ulPreviousSleeps;
+  ulValues[1] = xStats.ulTicksSkipped - ulPreviousSkipped;
+  ulValues[2] = xStats.ulMaxError;
+  ulValues[3] = xStats.ulResyncs;
+  ulPreviousSleeps = xStats.ulSleeps;
+  ulPreviousSkipped = xStats.ulTicksSkipped;
+
+  prvMonitorRow(row, xFull, xFields, pcLabels, ulValues, usShown,
+                mainMONITOR_TICKLESS_FIELDS);
+}
+#endif
+
+#if configUSE_TASK_BUDGETS == 1
+/**
+ * @brief Prints the budget row of the monitor: how many times each task with
+ * a budget used it up and was demoted. Only the counts that changed are
+ * written unless xFull is pdTRUE.
+ * @param row Row of the values.
+ * @param xFull pdTRUE to write every field.
+ */
+static void prvPrintBudgetStats(int row, BaseType_t xFull) {
+  static const MonitorField_t xFields[mainMONITOR_BUDGET_FIELDS] = {
+      {0, 20, 29, 8}, {0, 40, 49, 8}};
+  static unsigned short usShown[mainMONITOR_BUDGET_FIELDS];
+  const char *pcLabels[mainMONITOR_BUDGET_FIELDS];
+  unsigned long ulValues[mainMONITOR_BUDGET_FIELDS];
+
+  if (xFull == pdTRUE) {
+    prvMonitorField(row, 1, "Budget exhausted", 0);
+  }
+  for (int i = 0; i < mainMONITOR_BUDGET_FIELDS; i++) {
+    pcLabels[i] = pcTaskGetName(xBudgetTasks[i]);
+    ulValues[i] = ulTaskGetCpuBudgetExhausted(xBudgetTasks[i]);
+  }
+  prvMonitorRow(row, xFull, xFields, pcLabels, ulValues, usShown,
+                mainMONITOR_BUDGET_FIELDS);
+}
+#endif
+
+/**
+ * @brief Prints a row of the monitor for every periodic task: the jobs
+ * completed, the overruns, the deadline misses, and the longest execution time
+ * and the largest start jitter in us. The job count changes on every refresh,
+ * so the rows are written whole.
+ * @param row Row of the header.
+ * @param xFull pdTRUE to write the header and the task names.
+ * @return int Number of rows, header included.
+ */
+static int prvPrintPeriodicStats(int row, BaseType_t xFull) {
+  static const char *const pcLabels[mainMONITOR_PERIODIC_FIELDS] = {
+      "jobs", "overruns", "misses", "wcet us", "jitter us"};
+  /* The labels head the columns of the values, one row up. */
+  static const MonitorField_t xFields[mainMONITOR_PERIODIC_FIELDS] = {
+      {0, 11, 11, 8}, {0, 20, 20, 8}, {0, 30, 30, 8},
+      {0, 38, 38, 8}, {0, 47, 47, 8}};
+  const Periodic_t *pxPeriodic = NULL;
+  unsigned long ulValues[mainMONITOR_PERIODIC_FIELDS];
+  int rows = 1;
+
+  if (xFull == pdTRUE) {
+    prvMonitorField(row, 1, "Periodic", 0);
+  }
+  prvMonitorRow(row, xFull, xFields, pcLabels, NULL, NULL,
+                mainMONITOR_PERIODIC_FIELDS);
+
+  while ((pxPeriodic = pxPeriodicGetNext(pxPeriodic)) != NULL) {
+    ulValues[0] = pxPeriodic->ulJobs;
+    ulValues[1] = pxPeriodic->ulOverruns;
+    ulValues[2] = pxPeriodic->ulMisses;
+    ulValues[3] = pxPeriodic->ulWcet / mainCYCLES_PER_US;
+    ulValues[4] = pxPeriodic->ulMaxJitter / mainCYCLES_PER_US;
+
+    if (xFull == pdTRUE) {
+      prvMonitorField(row + rows, 1, pcTaskGetName(pxPeriodic->xTask), 0);
+    }
+    prvMonitorRow(row + rows, xFull, xFields, NULL, ulValues, NULL,
+                  mainMONITOR_PERIODIC_FIELDS);
+    rows++;
+  }
+  return rows;
+}
+
+/**
+ * @brief Prints the system stats to UART. The whole screen is only drawn on
+ * the first call, when the number of tasks changes and every
+ * mainMONITOR_FULL_REFRESH calls. Otherwise only the fields that changed since
+ * the previous snapshot are written, using ANSI cursor positioning.
+ * @param uxArraySize Size of the task status arrays.
+ * @param pxTaskStatusArray Array filled with the new snapshot.
+ * @param pxPreviousArray Array holding the previous snapshot.
  */
 void vPrintSystemStats(unsigned long uxArraySize,
-                       TaskStatus_t *pxTaskStatusArray) {
-  volatile UBaseType_t x;
-  unsigned int ulTotalRunTime, ulStatsAsPercentage;
+                       TaskStatus_t *pxTaskStatusArray,
+                       TaskStatus_t *pxPreviousArray) {
+  static const char *const pcStateNames[] = {
+      "Running", "Ready", "Blocked", "Suspended", "Deleted", "Invalid"};
+  /* Columns of the UART counters, after their labels. */
+  static const int serialColumns[3] = {24, 41, 62};
+  static const char *const pcWindowNames[eStatsWindowCount] = {"1s%", "10s%",
+                                                                "60s%"};
+  static const char *const pcLatencyNames[3] = {"min us", "p99 us", "max us"};
+  /* What the previous snapshot showed. The CPU usage is computed by the stats
+   * engine, so the values shown are kept apart. */
+  static UBaseType_t uxPreviousSize = 0;
+  static configRUN_TIME_COUNTER_TYPE ulPreviousTotalRunTime = 0;
+  static unsigned long ulPreviousSerial[3];
+  static unsigned long ulPreviousClock[2];
+  static unsigned char ucCpuShown[statsMAX_TASKS][eStatsWindowCount];
+  static unsigned short usLatencyShown[latencyMAX_TASKS][3];
+  static int refreshes = 0;
+  static BaseType_t xWasTelemetry = pdFALSE;
+  BaseType_t xTelemetry = xTelemetryIsEnabled();
+  unsigned long ulSerial[3] = {ulSerialTxBlocked, ulSerialTxDropped,
+                               ulSerialRxDropped};
+  unsigned long ulClock[2] = {ulPowerGetClockHz() / 1000UL,
+                              ulPowerGetChanges()};
+  configRUN_TIME_COUNTER_TYPE ulTotalRunTime;
+  LatencySummary_t xLatency;
+  BaseType_t xFull;
+  int row;
   char temp[10] = "";
 
-  vSendStringToUart("\x1B[2J\x1B[H"); // ANSI command to clear screen
-  vSendStringToUart("--------- System Monitor ---------\r\n");
-  vSendStringToUart("Task\tCPU %\tStatus\tStack HighWaterMark\r\n");
-
   uxArraySize =
       uxTaskGetSystemState(pxTaskStatusArray, uxArraySize, &ulTotalRunTime);
-  ulTotalRunTime /= 100;
+#if configUSE_ISR_STATS == 1
+  /* The run time clock of the tasks stops in the interrupts, add them back so
+   * the usages are fractions of the elapsed time. */
+  ulTotalRunTime += ullIsrStatsGetTotal();
+#endif
+  vStatsUpdate(pxTaskStatusArray, uxArraySize, ulTotalRunTime,
+               pxPreviousArray, uxPreviousSize, ulPreviousTotalRunTime);
+
+  /* Switching between the screen and the binary frames redraws everything,
+   * the task names included. */
+  xFull = (uxArraySize != uxPreviousSize || refreshes == 0 ||
+           xTelemetry != xWasTelemetry);
+  xWasTelemetry = xTelemetry;
+  if (++refreshes == mainMONITOR_FULL_REFRESH) {
+    refreshes = 0;
+  }
 
-  for (x = 0; x < uxArraySize; x++) {
-    vSendStringToUart(pxTaskStatusArray[x].pcTaskName);
-    vSendStringToUart("\t");
+  if (xTelemetry == pdTRUE) {
+    vTelemetrySendTasks(pxTaskStatusArray, uxArraySize, xFull);
+    uxPreviousSize = uxArraySize;
+    ulPreviousTotalRunTime = ulTotalRunTime;
+    return;
+  }
 
-    if (ulTotalRunTime > 0) {
-      ulStatsAsPercentage =
-          pxTaskStatusArray[x].ulRunTimeCounter / ulTotalRunTime;
-      if (ulStatsAsPercentage == 0) {
-        vSendStringToUart("<1");
-      } else {
-        vIntToString(ulStatsAsPercentage, temp);
-        vSendStringToUart(temp);
-      }
+  if (xFull == pdTRUE) {
+    prvMonitorPut("\x1B[2J\x1B[H"); // ANSI command to clear screen
+    prvMonitorPut("--------- System Monitor ---------\r\n");
+    prvMonitorField(1, 37, "Clock kHz:", 0);
+    prvMonitorField(1, 55, "changes:", 0);
+    prvMonitorField(mainMONITOR_FIRST_ROW - 1, 1, "Task", 0);
+    for (int w = 0; w < eStatsWindowCount; w++) {
+      prvMonitorField(mainMONITOR_FIRST_ROW - 1,
+                      mainMONITOR_CPU_COL + w * mainMONITOR_CPU_WIDTH,
+                      pcWindowNames[w], 0);
+    }
+    prvMonitorField(mainMONITOR_FIRST_ROW - 1, mainMONITOR_STATE_COL,
+                    "Status", 0);
+    prvMonitorField(mainMONITOR_FIRST_ROW - 1, mainMONITOR_STACK_COL,
+                    "Stack", 0);
+    for (int i = 0; i < 3; i++) {
+      prvMonitorField(mainMONITOR_FIRST_ROW - 1,
+                      mainMONITOR_LATENCY_COL + i * mainMONITOR_LATENCY_WIDTH,
+                      pcLatencyNames[i], 0);
+    }
+  }
+
+  for (int i = 0; i < 2; i++) {
+    if (xFull == pdTRUE || ulClock[i] != ulPreviousClock[i]) {
+      vIntToString((int)ulClock[i], temp);
+      prvMonitorField(1, (i == 0) ? 48 : 64, temp, 6);
+      ulPreviousClock[i] = ulClock[i];
+    }
+  }
+
+  for (UBaseType_t x = 0; x < uxArraySize; x++) {
+    TaskStatus_t *pxTask = &pxTaskStatusArray[x];
+    TaskStatus_t *pxPrevious = NULL;
+
+    /* Tasks are never deleted, so the task numbers run from 1 to the number
+     * of tasks and give every task a fixed row. */
+    row = mainMONITOR_FIRST_ROW + pxTask->xTaskNumber - 1;
+
+    if (xFull == pdTRUE) {
+      prvMonitorField(row, 1, pxTask->pcTaskName, 0);
     } else {
-      vSendStringToUart("-");
-    }
-
-    vSendStringToUart("\t");
-
-    switch (pxTaskStatusArray[x].eCurrentState) {
-    case eRunning:
-      vSendStringToUart("Running");
-      break;
-    case eReady:
-      vSendStringToUart("Ready");
-      break;
-    case eBlocked:
-      vSendStringToUart("Blocked");
-      break;
-    case eSuspended:
-      vSendStringToUart("Suspended");
-      break;
-    case eDeleted:
-      vSendStringToUart("Deleted");
-      break;
-    case eInvalid:
-      vSendStringToUart("Invalid");
-      break;
-    }
-
-    vSendStringToUart("\t");
-    vIntToString(pxTaskStatusArray[x].usStackHighWaterMark, temp);
-    vSendStringToUart(temp);
-    vSendStringToUart("\r\n");
+      pxPrevious =
+          prvFindTask(pxPreviousArray, uxPreviousSize, pxTask->xTaskNumber);
+    }
+
+    for (int w = 0; w < eStatsWindowCount; w++) {
+      unsigned char ucShown =
+          prvCpuShown(ulStatsGetLoad(pxTask->xTaskNumber, (StatsWindow_t)w));
+      unsigned char *pucPrevious = &ucShown;
+
+      if (pxTask->xTaskNumber <= statsMAX_TASKS) {
+        pucPrevious = &ucCpuShown[pxTask->xTaskNumber - 1][w];
+      }
+      if (xFull == pdTRUE || ucShown != *pucPrevious) {
+        prvCpuText(ucShown, temp);
+        prvMonitorField(row, mainMONITOR_CPU_COL + w * mainMONITOR_CPU_WIDTH,
+                        temp, mainMONITOR_CPU_WIDTH);
+        *pucPrevious = ucShown;
+      }
+    }
+
+    if (pxPrevious == NULL ||
+        pxTask->eCurrentState != pxPrevious->eCurrentState) {
+      prvMonitorField(row, mainMONITOR_STATE_COL,
+                      pcStateNames[pxTask->eCurrentState], 9);
+    }
+
+    if (pxPrevious == NULL ||
+        pxTask->usStackHighWaterMark != pxPrevious->usStackHighWaterMark) {
+      vIntToString(pxTask->usStackHighWaterMark, temp);
+      prvMonitorField(row, mainMONITOR_STACK_COL, temp, 5);
+    }
+
+    if (xLatencyGetSummary(pxTask->xTaskNumber, &xLatency) == pdTRUE) {
+      unsigned long ulLatencies[3] = {xLatency.ulMin, xLatency.ulP99,
+                                      xLatency.ulMax};
+
+      for (int i = 0; i < 3; i++) {
+        unsigned long ulShown = ulLatencies[i] / mainCYCLES_PER_US;
+        unsigned short *pusPrevious =
+            &usLatencyShown[pxTask->xTaskNumber - 1][i];
+
+        /* Anything from 65ms up, only seen in the last bucket, shows as the
+         * largest value kept. */
+        if (ulShown > 0xFFFFUL) {
+          ulShown = 0xFFFFUL;
+        }
+        if (xFull == pdTRUE || ulShown != *pusPrevious) {
+          vIntToString((int)ulShown, temp);
+          prvMonitorField(row,
+                          mainMONITOR_LATENCY_COL +
+                              i * mainMONITOR_LATENCY_WIDTH,
+                          temp, mainMONITOR_LATENCY_WIDTH);
+          *pusPrevious = (unsigned short)ulShown;
+        }
+      }
+    }
   }
+
+  row = mainMONITOR_FIRST_ROW + uxArraySize + 1;
+#if configUSE_ISR_STATS == 1
+  prvPrintIsrStats(row, xFull, ulTotalRunTime - ulPreviousTotalRunTime);
+  row += eIsrCount + 2;
+#endif
+  prvPrintHeapStats(row, xFull);
+  row += 3;
+#if configUSE_TICKLESS_IDLE == 1
+  prvPrintTicklessStats(row, xFull);
+  row += 2;
+#endif
+#if configUSE_TASK_BUDGETS == 1
+  prvPrintBudgetStats(row, xFull);
+  row += 2;
+#endif
+  row += prvPrintPeriodicStats(row, xFull) + 1;
+  if (xFull == pdTRUE) {
+    prvMonitorField(row, 1, "UART TX bytes blocked:", 0);
+    prvMonitorField(row, 32, "dropped:", 0);
+    prvMonitorField(row, 50, "RX dropped:", 0);
+  }
+  for (int i = 0; i < 3; i++) {
+    if (xFull == pdTRUE || ulSerial[i] != ulPreviousSerial[i]) {
+      vIntToString(ulSerial[i], temp);
+      prvMonitorField(row, serialColumns[i], temp, 0);
+      ulPreviousSerial[i] = ulSerial[i];
+    }
+  }
+
+  /* Leave the cursor below the table for the command replies. */
+  if (xMonitorLength > 0) {
+    prvMonitorGoto(row + 2, 1);
+  }
+  prvMonitorFlush();
+
+  uxPreviousSize = uxArraySize;
+  ulPreviousTotalRunTime = ulTotalRunTime;
 }
 
 /**
- * @brief Sends a string to the UART.
+ * @brief Queues a string for transmission over the UART. Returns without
+ * waiting for the transmission, unless the transmit buffer is full.
  * @param string Pointer to the null terminated string to send.
  */
 void vSendStringToUart(const char *string) {
-  while (*string != '\0') {
-    UARTCharPut(UART0_BASE, *string);
-    string++;
-  }
+  xSerialWrite(string, strlen(string));
 }
 
 /*-----------------------------------------------------------*/
 
 /**
- * @brief Reads sensor data and sends it to the filter task.
+ * @brief Collects the samples taken by the sampler interrupt and sends them to
+ * the filter task in blocks.
  * @param pvParameters unused.
  */
 static void vSensorTask(void *pvParameters) {
-  TickType_t xLastExecutionTime;
+  SampleBlock_t *pxBlock;
+
+  vSamplerStart(xTaskGetCurrentTaskHandle(), mainSENSOR_RATE_HZ,
+                mainBLOCK_SIZE);
 
-  /* Initialise xLastExecutionTime so the first call to vTaskDelayUntil() works
-   * correctly. */
-  xLastExecutionTime = xTaskGetTickCount();
+  for (;;) {
+    /* Wait until the sampler has a full block of samples. At low rates the
+     * timeout sends whatever arrived before the deadline. */
+    ulTaskNotifyTake(pdTRUE, mainBLOCK_DEADLINE);
+
+    /* Send every sample waiting in the sampler to filter task. */
+    while (ulSamplerAvailable() > 0) {
+      xQueueReceive(xFreeBlockQueue, &pxBlock, portMAX_DELAY);
+      pxBlock->count = ulSamplerRead(pxBlock->values, mainBLOCK_SIZE);
+      xQueueSend(xSensorFilterQueue, &pxBlock, portMAX_DELAY);
+    }
+  }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Filters the sensor data and sends the filtered value to the graficar
+ * task.
+ * @param pvParameters unused.
+ */
+static void vFilterTask(void *pvParameters) {
+  static Filter_t xFilter;
+  SampleBlock_t *pxBlock;
+  /* Number of the first sample of the block, for the telemetry. */
+  unsigned short usSample = 0;
+  BaseType_t xTelemetry;
 
-  int temp = 0;
-  int dir = 1;
+  vFilterInit(&xFilter, 1);
 
   for (;;) {
-    /* Perform this check every mainSENSOR_DELAY milliseconds. */
-    vTaskDelayUntil(&xLastExecutionTime, mainSENSOR_DELAY);
+    /* Wait for a block to arrive. */
+    xQueueReceive(xSensorFilterQueue, &pxBlock, portMAX_DELAY);
 
-    /* Update sensor temperature reading. Triangular signal */
-    temp = temp + (2 * dir);
-    if (temp >= 15) {
-      dir = -1;
-      temp = 15;
-    } else if (temp <= 0) {
-      dir = 1;
-      temp = 0;
+    vUpdateFilter(&xFilter);
+
+    /* The samples go out before the filter overwrites them. */
+    xTelemetry = xTelemetryIsEnabled();
+    if (xTelemetry == pdTRUE) {
+      vTelemetrySendValues(telemetryMSG_SAMPLES, usSample, pxBlock->values,
+                           pxBlock->count);
+    }
+
+    /* Run the active filter kernel on every value, in place. */
+    for (int i = 0; i < pxBlock->count; i++) {
+      pxBlock->values[i] = xFilterProcess(&xFilter, pxBlock->values[i]);
+    }
+
+    if (xTelemetry == pdTRUE) {
+      vTelemetrySendValues(telemetryMSG_FILTERED, usSample, pxBlock->values,
+                           pxBlock->count);
     }
+    usSample += (unsigned short)pxBlock->count;
 
-    /* Send temperature to filter task. */
-    xQueueSend(xSensorFilterQueue, &temp, portMAX_DELAY);
+    /* Send filtered block to graficar task. */
+    xQueueSend(xFilterGraficarQueue, &pxBlock, portMAX_DELAY);
+  }
+}
+
+/**
+ * @brief Applies the configuration sent by the command task, if any. Only
+ * reads the notification value, so it costs no more than a critical section
+ * when nothing changed.
+ * @param pxFilter The filter to update.
+ */
+void vUpdateFilter(Filter_t *pxFilter) {
+  uint32_t ulConfig;
+  int N;
+  FilterKind_t kind;
+
+  if (xTaskNotifyWait(0, 0xFFFFFFFFUL, &ulConfig, 0) == pdFALSE) {
+    return;
+  }
+
+  N = (int)(ulConfig & mainCONFIG_N_MASK);
+  kind = (FilterKind_t)(ulConfig >> mainCONFIG_KIND_SHIFT);
+
+  /* Resize with the current kernel first, so a kernel change resets the new
+   * kernel directly with the new window. */
+  if (N != pxFilter->N) {
+    vFilterSetN(pxFilter, N);
+  }
+  if (kind != pxFilter->kind) {
+    vFilterSetKind(pxFilter, kind);
   }
 }
 
 /*-----------------------------------------------------------*/
 
 /**
- * @brief Filters the sensor data and sends the average value to the graficar
- * task.
+ * @brief Reads command lines from the UART and executes them, answering "OK"
+ * or "ERR", or with an acknowledge frame when the binary telemetry is enabled.
+ * Lines longer than mainCOMMAND_MAX_LEN are rejected.
  * @param pvParameters unused.
  */
-static void vFilterTask(void *pvParameters) {
-  static int values[MAX_FILTER_SIZE] = {0};
-  int N = 1;
-  int sum = 0;
-  int last_value = 0;
+static void vCommandTask(void *pvParameters) {
+  static char line[mainCOMMAND_MAX_LEN + 1];
+  int len = 0;
+  BaseType_t xOverflow = pdFALSE;
+  BaseType_t xResult;
+  char c;
 
   for (;;) {
-    /* Wait for a message to arrive. */
-    xQueueReceive(xSensorFilterQueue, &last_value, portMAX_DELAY);
+    xSerialRead(&c, 1, portMAX_DELAY);
 
-    N = vUpdateN(N);
+    if (c != '\r' && c != '\n') {
+      if (len < mainCOMMAND_MAX_LEN) {
+        line[len++] = c;
+      } else {
+        xOverflow = pdTRUE;
+      }
+      continue;
+    }
 
-    /* Shift values */
-    for (int i = MAX_FILTER_SIZE - 1; i > 0; i--) {
-      values[i] = values[i - 1];
+    /* End of line, skip the empty ones left by "\r\n". */
+    if (len == 0 && xOverflow == pdFALSE) {
+      continue;
     }
-    values[0] = last_value;
 
-    /* Calculate average - only use N values in filter */
-    sum = 0;
-    for (int i = 0; i < N; i++) {
-      sum += values[i];
+    line[len] = '\0';
+    xResult = pdFAIL;
+    if (xOverflow == pdFALSE) {
+      xResult = xExecuteCommand(line);
     }
-    sum = sum / N;
 
-    /* Send average to graficar task. */
-    xQueueSend(xFilterGraficarQueue, &sum, portMAX_DELAY);
+    if (xTelemetryIsEnabled() == pdTRUE) {
+      vTelemetrySendAck(xResult, iConfigN, (int)xConfigKind,
+                        ulSamplerGetRate());
+    } else {
+      vSendStringToUart(xResult == pdPASS ? "OK\r\n" : "ERR\r\n");
+    }
+
+    len = 0;
+    xOverflow = pdFALSE;
   }
 }
 
 /**
- * @brief Updates the filter size N based on UART commands.
- * @param currentN The current filter size.
- * @return int The updated filter size.
+ * @brief Executes a "key=value" command. Supported commands are "N=<1-50>",
+ * "rate=<Hz>", "filter=<mean|ema|median|fir>", "clock=<auto|max>", which
+ * lets the governor pick the processor clock or keeps it at the fastest,
+ * "hist=<dump|reset>", which sends or clears the wakeup latency histograms,
+ * "link=<text|bin>", which switches the monitor, the replies and the samples
+ * between text and the binary frames of telemetry.c,
+ * "trace=<start|stop|dump>" when the trace recorder is enabled and
+ * "stacks=report" in the stack profiling mode.
+ * @param pcLine Null terminated command line, modified in place.
+ * @return BaseType_t pdPASS if the command was valid and applied.
  */
-int vUpdateN(int currentN) {
-  while (UARTCharsAvail(UART0_BASE)) {
-    char cmd = UARTCharGet(UART0_BASE);
-    if (cmd == 'u') {
-      currentN++;
-      if (currentN > MAX_FILTER_SIZE) {
-        currentN = MAX_FILTER_SIZE;
+BaseType_t xExecuteCommand(char *pcLine) {
+  static const char *const pcFilterNames[eFilterKindCount] = {
+      "mean", "ema", "median", "fir"};
+  char *pcValue = strchr(pcLine, '=');
+  unsigned long ulValue = 0;
+
+  if (pcValue == NULL || pcValue[1] == '\0') {
+    return pdFAIL;
+  }
+  *pcValue++ = '\0';
+
+  if (strcmp(pcLine, "filter") == 0) {
+    int i = 0;
+    while (i < eFilterKindCount && strcmp(pcValue, pcFilterNames[i]) != 0) {
+      i++;
+    }
+    if (i == eFilterKindCount) {
+      return pdFAIL;
+    }
+    xConfigKind = (FilterKind_t)i;
+  } else if (strcmp(pcLine, "clock") == 0) {
+    if (strcmp(pcValue, "auto") == 0) {
+      vPowerSetAuto(pdTRUE);
+    } else if (strcmp(pcValue, "max") == 0) {
+      vPowerSetAuto(pdFALSE);
+    } else {
+      return pdFAIL;
+    }
+    return pdPASS;
+  } else if (strcmp(pcLine, "link") == 0) {
+    if (strcmp(pcValue, "bin") == 0) {
+      vTelemetrySetEnabled(pdTRUE);
+    } else if (strcmp(pcValue, "text") == 0) {
+      vTelemetrySetEnabled(pdFALSE);
+    } else {
+      return pdFAIL;
+    }
+    return pdPASS;
+  } else if (strcmp(pcLine, "hist") == 0) {
+    if (strcmp(pcValue, "dump") == 0) {
+      prvLatencyExport();
+    } else if (strcmp(pcValue, "reset") == 0) {
+      vLatencyReset();
+    } else {
+      return pdFAIL;
+    }
+    return pdPASS;
+#if configUSE_STACK_PROFILE == 1
+  } else if (strcmp(pcLine, "stacks") == 0) {
+    if (strcmp(pcValue, "report") != 0) {
+      return pdFAIL;
+    }
+    prvStackReport();
+    return pdPASS;
+#endif
+#if configUSE_TRACE_RECORDER == 1
+  } else if (strcmp(pcLine, "trace") == 0) {
+    if (strcmp(pcValue, "start") == 0) {
+      vTraceStart();
+    } else if (strcmp(pcValue, "stop") == 0) {
+      vTraceStop();
+    } else if (strcmp(pcValue, "dump") == 0) {
+      prvTraceExport();
+    } else {
+      return pdFAIL;
+    }
+    return pdPASS;
+#endif
+  } else {
+    for (char *p = pcValue; *p != '\0'; p++) {
+      if (*p < '0' || *p > '9' || ulValue > 100000UL) {
+        return pdFAIL;
       }
-    } else if (cmd == 'd') {
-      currentN--;
-      if (currentN < 1) {
-        currentN = 1;
+      ulValue = ulValue * 10 + (*p - '0');
+    }
+
+    if (strcmp(pcLine, "N") == 0) {
+      if (ulValue < 1 || ulValue > MAX_FILTER_SIZE) {
+        return pdFAIL;
       }
+      iConfigN = (int)ulValue;
+    } else if (strcmp(pcLine, "rate") == 0) {
+      if (ulValue < 1 || ulValue > samplerMAX_RATE_HZ) {
+        return pdFAIL;
+      }
+      vSamplerSetRate(ulValue);
+#if configUSE_EDF_SCHEDULING == 1
+      prvSetBlockPeriod(ulSamplerGetRate());
+#endif
+      return pdPASS;
+    } else {
+      return pdFAIL;
     }
   }
-  return currentN;
-}
 
-/*-----------------------------------------------------------*/
+  xTaskNotify(xFilterTaskHandle, mainCONFIG(iConfigN, xConfigKind),
+              eSetValueWithOverwrite);
+  return pdPASS;
+}
 
 /**
- * @brief Receives filtered data and displays it on the OLED.
- * @param pvParameters unused
+ * @brief Sends the wakeup latency histograms of every task as comma separated
+ * values, one line per task after a header. Times are in run time clock
+ * cycles and every bucket column is named after the start of its range.
  */
-static void vGraficarTask(void *pvParameters) {
-  static unsigned char signal[OLED_WIDTH * 2] = {0};
-  int value = 0;
+static void prvLatencyExport(void) {
+  static unsigned short usBuckets[latencyBUCKET_COUNT];
+  LatencySummary_t xLatency;
+  char temp[12];
+
+  vSendStringToUart("task,count,min,p99,max");
+  for (int i = 0; i < latencyBUCKET_COUNT; i++) {
+    vSendStringToUart(",");
+    vIntToString(i == 0 ? 0 : 1 << (latencyFIRST_BUCKET_BITS + i - 1), temp);
+    vSendStringToUart(temp);
+  }
+  vSendStringToUart("\r\n");
 
-  OSRAMClear();
-  addValueToSignal(signal, 0);
-  OSRAMImageDraw(signal, 0, 0, OLED_WIDTH, 2);
+  for (UBaseType_t x = 1; x <= uxTaskGetNumberOfTasks(); x++) {
+    unsigned long ulValues[4];
 
-  for (;;) {
-    /* Wait for a message to arrive. */
-    xQueueReceive(xFilterGraficarQueue, &value, portMAX_DELAY);
+    if (xLatencyGetSummary(x, &xLatency) == pdFALSE || xLatency.xTask == NULL) {
+      continue;
+    }
+    ulValues[0] = xLatency.ulCount;
+    ulValues[1] = xLatency.ulMin;
+    ulValues[2] = xLatency.ulP99;
+    ulValues[3] = xLatency.ulMax;
+
+    vSendStringToUart(pcTaskGetName(xLatency.xTask));
+    for (int i = 0; i < 4; i++) {
+      vSendStringToUart(",");
+      vIntToString((int)ulValues[i], temp);
+      vSendStringToUart(temp);
+    }
 
-    /* Write the image to the LCD. */
-    addValueToSignal(signal, value);
-    OSRAMImageDraw(signal, 0, 0, OLED_WIDTH, 2);
+    xLatencyGetHistogram(x, usBuckets);
+    for (int i = 0; i < latencyBUCKET_COUNT; i++) {
+      vSendStringToUart(",");
+      vIntToString(usBuckets[i], temp);
+      vSendStringToUart(temp);
+    }
+    vSendStringToUart("\r\n");
   }
 }
 
+#if configUSE_STACK_PROFILE == 1
 /**
- * @brief Adds a value to the OLED signal array and shifts the existing values.
- * @param image The signal array.
- * @param value The value to add.
+ * @brief Sends a line of the stack report.
+ * @param pcName Name of the stack.
+ * @param ulAllocated Size of the stack in words.
+ * @param ulUsed Deepest use of the stack in words.
  */
-void addValueToSignal(unsigned char image[OLED_WIDTH * 2], int value) {
-  // shift signal
-  for (int i = OLED_WIDTH - 1; i > 0; i--) {
-    image[i] = image[i - 1];
-    image[i + OLED_WIDTH] = image[i - 1 + OLED_WIDTH];
+static void prvStackLine(const char *pcName, unsigned long ulAllocated,
+                         unsigned long ulUsed) {
+  static char line[40];
+  unsigned long ulValues[3] = {ulAllocated, ulUsed,
+                               ulStackProfileRecommend(ulUsed)};
+
+  strcpy(line, "$S,");
+  strcat(line, pcName);
+  for (int i = 0; i < 3; i++) {
+    strcat(line, ",");
+    vIntToString((int)ulValues[i], line + strlen(line));
   }
+  strcat(line, "\r\n");
+  vSendStringToUart(line);
+}
 
-  image[OLED_WIDTH] = 0;
-  image[0] = 0;
+/**
+ * @brief Sends the deepest use of every stack since boot and the size
+ * recommended for it, in words, as lines "$S,<name>,<allocated>,<used>,
+ * <recommended>" that tools/stacksizes.py turns into stacksizes.h.
+ */
+static void prvStackReport(void) {
+  static const char *const pcTasks[] = {"Sensor",  "Filter",  "Grafic",
+                                        "Monitor", "Command", "IDLE"};
+  static const unsigned short usWords[] = {
+      stackSENSOR_WORDS,  stackFILTER_WORDS,  stackGRAFIC_WORDS,
+      stackMONITOR_WORDS, stackCOMMAND_WORDS, stackIDLE_WORDS};
+
+  for (int i = 0; i < 6; i++) {
+    TaskHandle_t xTask = xTaskGetHandle(pcTasks[i]);
+
+    if (xTask != NULL) {
+      prvStackLine(pcTasks[i], mainSTACK(usWords[i]),
+                   mainSTACK(usWords[i]) - uxTaskGetStackHighWaterMark(xTask));
+    }
+  }
+  prvStackLine("MSP", stackprofMSP_WORDS, ulStackProfileMspUsed());
+}
+#endif
 
-  // add new value in the correct height position
-  if (value < 8) {
-    image[OLED_WIDTH] = (1 << (7 - value));
-  } else {
-    image[0] = (1 << (15 - value));
+#if configUSE_TRACE_RECORDER == 1
+/**
+ * @brief Formats a number in hexadecimal with a fixed number of digits.
+ * @param pcText Where the digits are written, not terminated.
+ * @param ulValue The number.
+ * @param iDigits Number of digits.
+ */
+static void prvHexToString(char *pcText, unsigned long ulValue, int iDigits) {
+  for (int i = iDigits - 1; i >= 0; i--) {
+    pcText[i] = "0123456789abcdef"[ulValue & 0xFUL];
+    ulValue >>= 4;
+  }
+}
+
+/**
+ * @brief Sends the trace buffer and restarts the recording. Every line starts
+ * with '$', so the decoder can find them among the monitor output, and is
+ * sent in a single write so the monitor cannot split it: a header with the
+ * clock rate and the number of records, the names of the tasks and queues,
+ * one line per record with its fields in hexadecimal, and an end line. See
+ * tools/trace2chrome.py.
+ */
+static void prvTraceExport(void) {
+  static char line[32];
+  TraceRecord_t xRecord;
+  unsigned long ulCount;
+
+  vTraceStop();
+  ulCount = ulTraceCount();
+
+  strcpy(line, "$T,");
+  vIntToString((int)ulPowerGetClockHz(), line + strlen(line));
+  strcat(line, ",");
+  vIntToString((int)ulCount, line + strlen(line));
+  strcat(line, "\r\n");
+  vSendStringToUart(line);
+
+  for (unsigned long x = 1; x <= traceMAX_TASKS; x++) {
+    if (pvTraceGetTask(x) != NULL) {
+      strcpy(line, "$t,");
+      vIntToString((int)x, line + strlen(line));
+      strcat(line, ",");
+      strcat(line, pcTaskGetName((TaskHandle_t)pvTraceGetTask(x)));
+      strcat(line, "\r\n");
+      vSendStringToUart(line);
+    }
+  }
+  for (unsigned long x = 1; pcTraceGetQueueName(x) != NULL; x++) {
+    strcpy(line, "$q,");
+    vIntToString((int)x, line + strlen(line));
+    strcat(line, ",");
+    strncat(line, pcTraceGetQueueName(x), configMAX_TASK_NAME_LEN + 4);
+    strcat(line, "\r\n");
+    vSendStringToUart(line);
+  }
+
+  for (unsigned long i = 0; i < ulCount; i++) {
+    vTraceGetRecord(i, &xRecord);
+    strcpy(line, "$r,");
+    prvHexToString(line + 3, xRecord.ulTime, 8);
+    prvHexToString(line + 11, xRecord.ucEvent, 2);
+    prvHexToString(line + 13, xRecord.ucObject, 2);
+    prvHexToString(line + 15, xRecord.usData, 4);
+    strcpy(line + 19, "\r\n");
+    vSendStringToUart(line);
+  }
+
+  vSendStringToUart("$e\r\n");
+  vTraceStart();
+}
+#endif
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Receives blocks of filtered data and displays them on the OLED. Only
+ * the columns touched by the block are sent to the display, see graph.c.
+ * @param pvParameters unused
+ */
+static void vGraficarTask(void *pvParameters) {
+  SampleBlock_t *pxBlock;
+
+  vGraphInit();
+  vGraphSetScale(mainGRAPH_MIN, mainGRAPH_MAX);
+
+  for (;;) {
+    /* Wait for a block to arrive. */
+    xQueueReceive(xFilterGraficarQueue, &pxBlock, portMAX_DELAY);
+
+    /* Follow changes of the sample rate. */
+    vGraphSetDecimation(ulSamplerGetRate() / mainGRAPH_COLUMN_RATE_HZ);
+
+    for (int i = 0; i < pxBlock->count; i++) {
+      vGraphAddValue(pxBlock->values[i]);
+    }
+
+    /* The block is no longer needed, give it back to the sensor task. */
+    xQueueSend(xFreeBlockQueue, &pxBlock, portMAX_DELAY);
+
+    /* Write the changed columns to the LCD. */
+    vGraphFlush();
   }
 }
 
@@ -414,15 +1524,60 @@ void vIntToString(int value, char *string) {
 
 /*-----------------------------------------------------------*/
 
+/**
+ * @brief Reports a periodic task that completed a job after its deadline:
+ * below the monitor as a line of text, or as a telemetry message when the
+ * binary link is on, so no text gets in between the frames. Called by that
+ * task, see periodic.c.
+ * @param pxPeriodic The periodic task.
+ * @param xLateTicks Whole ticks past the deadline.
+ */
+static void prvDeadlineMissed(Periodic_t *pxPeriodic, TickType_t xLateTicks) {
+  unsigned long ulLateMs = (unsigned long)(xLateTicks * portTICK_PERIOD_MS);
+  const char *pcParts[4];
+  char temp[10];
+
+  if (xTelemetryIsEnabled() == pdTRUE) {
+    TaskStatus_t xStatus;
+
+    vTaskGetInfo(pxPeriodic->xTask, &xStatus, pdFALSE, eInvalid);
+    vTelemetrySendDeadlineMiss(xStatus.xTaskNumber, ulLateMs);
+    return;
+  }
+
+  /* Under one lock, so the line is not split by other writers. */
+  vIntToString((int)ulLateMs, temp);
+  pcParts[0] = pcTaskGetName(pxPeriodic->xTask);
+  pcParts[1] = " missed its deadline by ";
+  pcParts[2] = temp;
+  pcParts[3] = " ms\r\n";
+  vSerialLock();
+  for (int i = 0; i < 4; i++) {
+    xSerialWriteLocked(pcParts[i], strlen(pcParts[i]));
+  }
+  vSerialUnlock();
+}
+
+/*-----------------------------------------------------------*/
+
 /**
  * @brief Hook function for stack overflow.
  * @param xTask Task handle.
  * @param pcTaskName Task name.
  */
 void vApplicationStackOverflowHook(TaskHandle_t xTask, char *pcTaskName) {
-  vSendStringToUart("\nSTACK OVERFLOW on '");
-  vSendStringToUart(pcTaskName);
-  vSendStringToUart("' task\r\n");
+  vSerialWritePolled("\nSTACK OVERFLOW on '");
+  vSerialWritePolled(pcTaskName);
+  vSerialWritePolled("' task\r\n");
   for (;;) {
   }
 }
+
+#if configUSE_IDLE_HOOK == 1
+/**
+ * @brief Hook function of the idle task, without tickless idle. Stops the
+ * processor until the next interrupt, the tick at the latest. The time asleep
+ * still counts as idle.
+ */
+void vApplicationIdleHook(void) { CPUwfi(); }
+#endif
@@ -0,0 +1,145 @@
+/* Periodic tasks.
+ *
+ * A task that calls vTaskDelayUntil() in a loop runs once per period, but
+ * when an iteration takes longer than the period the next call returns at
+ * once and the lost time is never reported. A task calls vPeriodicStart()
+ * once and xPeriodicWait() at the end of every job instead, and this file
+ * keeps, for every periodic task:
+ *
+ * - the jobs still running when the next one was released (overruns), which
+ *   then start late, one after the other, until the task catches up;
+ * - the jobs completed after their deadline, and calls the miss hook of the
+ *   task for each one;
+ * - the longest execution time of a job, taken from the run time counter of
+ *   the task, so the time other tasks ran in between is not counted;
+ * - the largest start time jitter: how far the time between the starts of two
+ *   jobs was from the period.
+ *
+ * The run time counter of a task only advances when it is switched out, so it
+ * is read when a job starts, right after the task was switched in, and the
+ * execution time of a job is the difference with the reading at the start of
+ * the next. After an overrun the task is not switched out in between, and the
+ * time it ran since it was last switched in is counted in the next job. The
+ * statistics are updated by the task itself and read by the monitor without
+ * locking; a value read while it changes is off by one refresh. */
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "periodic.h"
+#include "timertest.h"
+
+/* Run time clock cycles in a tick. */
+#define periodicCYCLES_PER_TICK (configCPU_CLOCK_HZ / configTICK_RATE_HZ)
+
+/*-----------------------------------------------------------*/
+
+/* Periodic tasks, last started first. */
+static Periodic_t *pxFirst = NULL;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Starts a job: measures the previous one and the time since it
+ * started.
+ * @param pxPeriodic The periodic task.
+ */
+static void prvStartJob(Periodic_t *pxPeriodic) {
+  unsigned long ulNow = (unsigned long)ullGetRunTimeCounterValue();
+  unsigned long ulRunTime;
+  unsigned long ulTime;
+  long lJitter;
+  TaskStatus_t xStatus;
+
+  vTaskGetInfo(NULL, &xStatus, pdFALSE, eRunning);
+  ulRunTime = (unsigned long)xStatus.ulRunTimeCounter;
+
+  if (pxPeriodic->ulJobs > 0UL) {
+    ulTime = ulRunTime - pxPeriodic->ulRunTime;
+    if (ulTime > pxPeriodic->ulWcet) {
+      pxPeriodic->ulWcet = ulTime;
+    }
+
+    lJitter = (long)(ulNow - pxPeriodic->ulStart -
+                     pxPeriodic->xPeriod * periodicCYCLES_PER_TICK);
+    if (lJitter < 0L) {
+      lJitter = -lJitter;
+    }
+    if ((unsigned long)lJitter > pxPeriodic->ulMaxJitter) {
+      pxPeriodic->ulMaxJitter = (unsigned long)lJitter;
+    }
+  }
+
+  pxPeriodic->ulStart = ulNow;
+  pxPeriodic->ulRunTime = ulRunTime;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Makes the calling task periodic. Its first job is released and
+ * starts now.
+ * @param pxPeriodic Where the task is kept, must live as long as the task.
+ * @param xPeriod Period in ticks.
+ * @param xDeadline Time a job has to complete after its release, in ticks, 0
+ * for the period.
+ * @param pxMissHook Called when a job misses its deadline, or NULL.
+ */
+void vPeriodicStart(Periodic_t *pxPeriodic, TickType_t xPeriod,
+                    TickType_t xDeadline, PeriodicMissHook_t pxMissHook) {
+  pxPeriodic->xTask = xTaskGetCurrentTaskHandle();
+  pxPeriodic->xPeriod = xPeriod;
+  pxPeriodic->xDeadline = (xDeadline == 0) ? xPeriod : xDeadline;
+  pxPeriodic->xRelease = xTaskGetTickCount();
+  pxPeriodic->pxMissHook = pxMissHook;
+  pxPeriodic->ulJobs = 0UL;
+  pxPeriodic->ulOverruns = 0UL;
+  pxPeriodic->ulMisses = 0UL;
+  pxPeriodic->ulWcet = 0UL;
+  pxPeriodic->ulMaxJitter = 0UL;
+  prvStartJob(pxPeriodic);
+
+  taskENTER_CRITICAL();
+  pxPeriodic->pxNext = pxFirst;
+  pxFirst = pxPeriodic;
+  taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief Ends the current job and waits for the release of the next one, as
+ * vTaskDelayUntil() does.
+ * @param pxPeriodic The periodic task.
+ * @return BaseType_t pdFALSE if the next job was already released, and starts
+ * late.
+ */
+BaseType_t xPeriodicWait(Periodic_t *pxPeriodic) {
+  TickType_t xElapsed = xTaskGetTickCount() - pxPeriodic->xRelease;
+  BaseType_t xDelayed;
+
+  pxPeriodic->ulJobs++;
+  if (xElapsed >= pxPeriodic->xDeadline) {
+    pxPeriodic->ulMisses++;
+    if (pxPeriodic->pxMissHook != NULL) {
+      pxPeriodic->pxMissHook(pxPeriodic, xElapsed - pxPeriodic->xDeadline);
+    }
+  }
+
+  xDelayed = xTaskDelayUntil(&pxPeriodic->xRelease, pxPeriodic->xPeriod);
+  if (xDelayed == pdFALSE) {
+    pxPeriodic->ulOverruns++;
+  }
+
+  prvStartJob(pxPeriodic);
+  return xDelayed;
+}
+
+/**
+ * @brief Walks the periodic tasks.
+ * @param pxPeriodic A periodic task, or NULL.
+ * @return const Periodic_t* The task started before it, or the last one
+ * started if it is NULL. NULL at the end.
+ */
+const Periodic_t *pxPeriodicGetNext(const Periodic_t *pxPeriodic) {
+  return (pxPeriodic == NULL) ? pxFirst : pxPeriodic->pxNext;
+}
@@ -0,0 +1,39 @@
+#ifndef PERIODIC_H
+#define PERIODIC_H
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+struct Periodic;
+
+/* Called by a periodic task when one of its jobs completes after its
+ * deadline, with the number of whole ticks it was late. */
+typedef void (*PeriodicMissHook_t)(struct Periodic *pxPeriodic,
+                                   TickType_t xLateTicks);
+
+/* A periodic task, kept by the task itself. Only periodic.c writes it. The
+ * times are in run time clock cycles. */
+typedef struct Periodic {
+  TaskHandle_t xTask;
+  TickType_t xPeriod;
+  TickType_t xDeadline; /* After the release. */
+  TickType_t xRelease;  /* Release time of the current job. */
+  PeriodicMissHook_t pxMissHook;
+  struct Periodic *pxNext;   /* Next periodic task, NULL for the last. */
+  unsigned long ulStart;     /* Run time clock when the job started. */
+  unsigned long ulRunTime;   /* Run time counter of the task then. */
+  unsigned long ulJobs;      /* Jobs completed. */
+  unsigned long ulOverruns;  /* Jobs still running at the next release. */
+  unsigned long ulMisses;    /* Jobs completed after their deadline. */
+  unsigned long ulWcet;      /* Longest execution time of a job. */
+  unsigned long ulMaxJitter; /* Largest difference between the period and
+                              * the time from the start of a job to the start
+                              * of the next. */
+} Periodic_t;
+
+void vPeriodicStart(Periodic_t *pxPeriodic, TickType_t xPeriod,
+                    TickType_t xDeadline, PeriodicMissHook_t pxMissHook);
+BaseType_t xPeriodicWait(Periodic_t *pxPeriodic);
+const Periodic_t *pxPeriodicGetNext(const Periodic_t *pxPeriodic);
+
+#endif /* PERIODIC_H */
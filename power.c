@@ -0,0 +1,137 @@
+/* Processor clock governor.
+ *
+ * The idle task stops the processor with WFI until the next interrupt, in the
+ * idle hook of main.c or, with tickless idle, in tickless.c, and the governor picks the processor clock from the load the
+ * monitor task measures every second. The fastest level is the 20MHz the
+ * application was written for, the others run the PLL with a larger divider
+ * or bypass it.
+ *
+ * Everything that depends on the processor clock is set again on each change,
+ * in a critical section right after it: the run time clock, which keeps
+ * counting at configCPU_CLOCK_HZ (see timertest.c), the tick, which keeps its
+ * phase (see tickless.c), the sampler timer and the UART baud rate. The
+ * transmit buffer is drained first, as a byte on the line would be garbled.
+ * The I2C bus of the display and its refresh timer keep the settings computed
+ * for 20MHz, and only get slower. */
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Library includes. */
+#include "hw_types.h"
+#include "sysctl.h"
+
+#include "power.h"
+#include "sampler.h"
+#include "serial.h"
+#include "tickless.h"
+#include "timertest.h"
+#include "trace.h"
+
+/*-----------------------------------------------------------*/
+
+/* Clock levels, fastest first. */
+typedef struct {
+  unsigned long ulConfig; /* Argument of SysCtlClockSet(). */
+  unsigned long ulHz;
+} PowerLevel_t;
+
+static const PowerLevel_t xLevels[] = {
+    {SYSCTL_SYSDIV_10 | SYSCTL_USE_PLL | SYSCTL_OSC_MAIN | SYSCTL_XTAL_6MHZ,
+     20000000UL},
+    {SYSCTL_SYSDIV_16 | SYSCTL_USE_PLL | SYSCTL_OSC_MAIN | SYSCTL_XTAL_6MHZ,
+     12500000UL},
+    {SYSCTL_SYSDIV_1 | SYSCTL_USE_OSC | SYSCTL_OSC_MAIN | SYSCTL_XTAL_6MHZ,
+     6000000UL},
+    {SYSCTL_SYSDIV_2 | SYSCTL_USE_OSC | SYSCTL_OSC_MAIN | SYSCTL_XTAL_6MHZ,
+     3000000UL},
+};
+
+#define powerLEVEL_COUNT (sizeof(xLevels) / sizeof(xLevels[0]))
+
+static unsigned long ulLevel = 0UL;
+static unsigned long ulChanges = 0UL;
+static BaseType_t xAutomatic = pdTRUE;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Changes the processor clock and everything that depends on it. Must
+ * be called from a task.
+ * @param ulNewLevel Index in xLevels.
+ */
+static void prvSetLevel(unsigned long ulNewLevel) {
+  unsigned long ulHz = xLevels[ulNewLevel].ulHz;
+
+  vSerialPause();
+
+  taskENTER_CRITICAL();
+#if configUSE_TRACE_RECORDER == 1
+  /* The records hold processor cycles, the decoder needs the clock of each
+   * stretch. */
+  vTraceRecord(traceEVENT_CLOCK, xLevels[ulLevel].ulHz / powerTRACE_UNIT_HZ,
+               ulHz / powerTRACE_UNIT_HZ);
+#endif
+  SysCtlClockSet(xLevels[ulNewLevel].ulConfig);
+  vTimerSetClock(ulHz);
+  vTicklessSetClock(xLevels[ulLevel].ulHz, ulHz);
+  vSamplerSetRate(ulSamplerGetRate());
+  vSerialResume();
+  ulLevel = ulNewLevel;
+  ulChanges++;
+  taskEXIT_CRITICAL();
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Sets the fastest clock. Must be called before the peripherals are
+ * configured.
+ */
+void vPowerInit(void) { SysCtlClockSet(xLevels[0].ulConfig); }
+
+/**
+ * @brief Picks the clock for the next interval. Called by the monitor task
+ * once per interval.
+ * @param ulLoad Time the processor was busy during the last interval, in
+ * hundredths of a percent.
+ */
+void vPowerGovern(unsigned long ulLoad) {
+  unsigned long ulNewLevel = ulLevel;
+
+  if (xAutomatic == pdFALSE || ulLoad > powerRAISE_LOAD) {
+    ulNewLevel = 0UL;
+  } else if (ulLevel + 1UL < powerLEVEL_COUNT) {
+    /* The same work takes longer at a slower clock. */
+    uint64_t ullSlower = (uint64_t)ulLoad * xLevels[ulLevel].ulHz /
+                         xLevels[ulLevel + 1UL].ulHz;
+
+    if (ullSlower < powerLOWER_LOAD) {
+      ulNewLevel = ulLevel + 1UL;
+    }
+  }
+
+  if (ulNewLevel != ulLevel) {
+    prvSetLevel(ulNewLevel);
+  }
+}
+
+/**
+ * @brief Enables or disables the governor. While disabled the processor runs
+ * at the fastest clock, which the next call to vPowerGovern() sets.
+ * @param xAuto pdTRUE to let the governor pick the clock.
+ */
+void vPowerSetAuto(BaseType_t xAuto) { xAutomatic = xAuto; }
+
+/**
+ * @brief Returns the processor clock.
+ * @return unsigned long Clock in Hz.
+ */
+unsigned long ulPowerGetClockHz(void) { return xLevels[ulLevel].ulHz; }
+
+/**
+ * @brief Returns the number of clock changes since boot.
+ * @return unsigned long Number of changes.
+ */
+unsigned long ulPowerGetChanges(void) { return ulChanges; }
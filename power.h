@@ -0,0 +1,22 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include "FreeRTOS.h"
+
+/* Load thresholds of the governor, in hundredths of a percent of the last
+ * interval. Above powerRAISE_LOAD the clock goes straight to the fastest
+ * level. It goes down one level when the load, scaled to the slower clock,
+ * would stay below powerLOWER_LOAD. */
+#define powerRAISE_LOAD (7000UL)
+#define powerLOWER_LOAD (5000UL)
+
+/* Clock of the trace records, in units of 100KHz. */
+#define powerTRACE_UNIT_HZ (100000UL)
+
+void vPowerInit(void);
+void vPowerGovern(unsigned long ulLoad);
+void vPowerSetAuto(BaseType_t xAuto);
+unsigned long ulPowerGetClockHz(void);
+unsigned long ulPowerGetChanges(void);
+
+#endif /* POWER_H */
@@ -0,0 +1,223 @@
+/* Interrupt driven sampling front-end.
+ *
+ * Timer 2 runs at the sample rate. Each timeout either triggers a conversion
+ * of the ADC sequence 0 or, in synthetic mode, generates a sample directly in
+ * the timer interrupt. The samples are written to a single producer, single
+ * consumer ring buffer that needs no locking, and the consumer task is only
+ * notified once a batch of samples is ready. */
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Library includes. */
+#include "hw_ints.h"
+#include "hw_memmap.h"
+#include "hw_types.h"
+#include "adc.h"
+#include "interrupt.h"
+#include "sysctl.h"
+#include "timer.h"
+
+#include "sampler.h"
+
+/* Size of the ring buffer, must be a power of two. */
+#define samplerBUFFER_SIZE (32UL)
+#define samplerBUFFER_MASK (samplerBUFFER_SIZE - 1UL)
+
+/* The interrupts call FreeRTOS API functions, so they must not be above
+configMAX_SYSCALL_INTERRUPT_PRIORITY. */
+#define samplerINTERRUPT_PRIORITY configKERNEL_INTERRUPT_PRIORITY
+
+/*-----------------------------------------------------------*/
+
+/* Interrupt handlers */
+void Timer2IntHandler(void);
+void ADC0IntHandler(void);
+
+/* Ring buffer. ulHead is only written by the interrupt and ulTail only by the
+consumer task, both run freely and are masked when indexing. */
+static volatile unsigned short usBuffer[samplerBUFFER_SIZE];
+static volatile unsigned long ulHead = 0UL;
+static volatile unsigned long ulTail = 0UL;
+
+/* Task to notify and number of samples that make a batch. */
+static TaskHandle_t xConsumerTask = NULL;
+static unsigned long ulBatch = 1UL;
+
+static unsigned long ulRate = 0UL;
+
+volatile unsigned long ulSamplerOverruns = 0UL;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Stores a sample in the ring buffer and notifies the consumer when a
+ * whole batch is available. Must only be called from the sampler interrupts.
+ * @param usValue The sample.
+ * @param pxHigherPriorityTaskWoken Set to pdTRUE if a context switch is needed.
+ */
+static void prvPushSample(unsigned short usValue,
+                          BaseType_t *pxHigherPriorityTaskWoken) {
+  unsigned long ulLevel = ulHead - ulTail;
+
+  if (ulLevel == samplerBUFFER_SIZE) {
+    ulSamplerOverruns++;
+    return;
+  }
+
+  usBuffer[ulHead & samplerBUFFER_MASK] = usValue;
+  ulHead++;
+
+  if (ulLevel + 1UL == ulBatch) {
+    vTaskNotifyGiveFromISR(xConsumerTask, pxHigherPriorityTaskWoken);
+  }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Configures the sampling hardware and starts sampling.
+ * @param xTask Task that consumes the samples with ulSamplerRead().
+ * @param ulRateHz Sample rate.
+ * @param ulBatchSize The task is notified each time this many samples are
+ * waiting in the buffer.
+ */
+void vSamplerStart(TaskHandle_t xTask, unsigned long ulRateHz,
+                   unsigned long ulBatchSize) {
+  xConsumerTask = xTask;
+  ulBatch = (ulBatchSize > 0UL && ulBatchSize <= samplerBUFFER_SIZE)
+                ? ulBatchSize
+                : 1UL;
+
+  SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER2);
+  TimerConfigure(TIMER2_BASE, TIMER_CFG_32_BIT_PER);
+
+#if samplerUSE_ADC == 1
+  /* The timer triggers a single step sequence that converts channel 0 and
+   * interrupts when done. */
+  SysCtlPeripheralEnable(SYSCTL_PERIPH_ADC);
+  TimerControlTrigger(TIMER2_BASE, TIMER_A, true);
+  ADCSequenceConfigure(ADC_BASE, 0, ADC_TRIGGER_TIMER, 0);
+  ADCSequenceStepConfigure(ADC_BASE, 0, 0,
+                           ADC_CTL_CH0 | ADC_CTL_IE | ADC_CTL_END);
+  ADCSequenceEnable(ADC_BASE, 0);
+  ADCIntEnable(ADC_BASE, 0);
+  IntPrioritySet(INT_ADC0, samplerINTERRUPT_PRIORITY);
+  IntEnable(INT_ADC0);
+#else
+  /* The timer interrupt generates the samples. */
+  IntPrioritySet(INT_TIMER2A, samplerINTERRUPT_PRIORITY);
+  IntEnable(INT_TIMER2A);
+  TimerIntEnable(TIMER2_BASE, TIMER_TIMA_TIMEOUT);
+#endif
+
+  vSamplerSetRate(ulRateHz);
+  TimerEnable(TIMER2_BASE, TIMER_A);
+}
+
+/**
+ * @brief Changes the sample rate.
+ * @param ulRateHz New sample rate, clamped to [1, samplerMAX_RATE_HZ].
+ */
+void vSamplerSetRate(unsigned long ulRateHz) {
+  if (ulRateHz < 1UL) {
+    ulRateHz = 1UL;
+  } else if (ulRateHz > samplerMAX_RATE_HZ) {
+    ulRateHz = samplerMAX_RATE_HZ;
+  }
+
+  /* The processor clock can change, see power.c, which sets the rate again
+   * afterwards. */
+  taskENTER_CRITICAL();
+  ulRate = ulRateHz;
+  TimerLoadSet(TIMER2_BASE, TIMER_A, SysCtlClockGet() / ulRateHz);
+  taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief Returns the current sample rate.
+ * @return unsigned long Sample rate in Hz.
+ */
+unsigned long ulSamplerGetRate(void) { return ulRate; }
+
+/**
+ * @brief Returns the number of samples waiting in the buffer.
+ * @return unsigned long Number of samples.
+ */
+unsigned long ulSamplerAvailable(void) { return ulHead - ulTail; }
+
+/**
+ * @brief Moves samples out of the buffer. Must only be called from the task
+ * given to vSamplerStart().
+ * @param piValues Destination of the samples.
+ * @param ulMax Maximum number of samples to read.
+ * @return unsigned long Number of samples read.
+ */
+unsigned long ulSamplerRead(int *piValues, unsigned long ulMax) {
+  unsigned long ulCount = ulHead - ulTail;
+  unsigned long ulTailCopy = ulTail;
+
+  if (ulCount > ulMax) {
+    ulCount = ulMax;
+  }
+
+  for (unsigned long i = 0; i < ulCount; i++) {
+    piValues[i] = usBuffer[ulTailCopy & samplerBUFFER_MASK];
+    ulTailCopy++;
+  }
+
+  /* Only release the slots once they have been copied. */
+  ulTail = ulTailCopy;
+
+  return ulCount;
+}
+
+/*-----------------------------------------------------------*/
+
+void Timer2IntHandler(void) {
+  static int temp = 0;
+  static int dir = 1;
+  BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+  traceISR_ENTER();
+
+  TimerIntClear(TIMER2_BASE, TIMER_TIMA_TIMEOUT);
+
+  /* Synthetic temperature reading. Triangular signal */
+  temp = temp + (2 * dir);
+  if (temp >= 15) {
+    dir = -1;
+    temp = 15;
+  } else if (temp <= 0) {
+    dir = 1;
+    temp = 0;
+  }
+
+  prvPushSample((unsigned short)temp, &xHigherPriorityTaskWoken);
+
+  portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+
+  traceISR_EXIT();
+}
+/*-----------------------------------------------------------*/
+
+void ADC0IntHandler(void) {
+  unsigned long ulSamples[8];
+  long lCount;
+  BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+  traceISR_ENTER();
+
+  ADCIntClear(ADC_BASE, 0);
+
+  /* Drain the sequence FIFO. */
+  lCount = ADCSequenceDataGet(ADC_BASE, 0, ulSamples);
+  for (long i = 0; i < lCount; i++) {
+    prvPushSample((unsigned short)ulSamples[i], &xHigherPriorityTaskWoken);
+  }
+
+  portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+
+  traceISR_EXIT();
+}
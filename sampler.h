@@ -0,0 +1,35 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Set to 1 to sample ADC channel 0, triggered by Timer 2. When 0 the Timer 2
+ * interrupt generates a synthetic triangle signal instead, which is what runs
+ * under QEMU. Can also be set by adding -DsamplerUSE_ADC=1 to CFLAGS in the
+ * Makefile. */
+#ifndef samplerUSE_ADC
+#define samplerUSE_ADC 0
+#endif
+
+/* Full scale of the samples produced by the sampler. */
+#if samplerUSE_ADC == 1
+#define samplerFULL_SCALE 1024
+#else
+#define samplerFULL_SCALE 16
+#endif
+
+/* Highest sample rate accepted by vSamplerSetRate(). */
+#define samplerMAX_RATE_HZ (8000UL)
+
+void vSamplerStart(TaskHandle_t xTask, unsigned long ulRateHz,
+                   unsigned long ulBatchSize);
+void vSamplerSetRate(unsigned long ulRateHz);
+unsigned long ulSamplerGetRate(void);
+unsigned long ulSamplerAvailable(void);
+unsigned long ulSamplerRead(int *piValues, unsigned long ulMax);
+
+/* Number of samples dropped because the buffer was full. */
+extern volatile unsigned long ulSamplerOverruns;
+
+#endif /* SAMPLER_H */
@@ -0,0 +1,303 @@
+/* Interrupt driven UART0 driver.
+ *
+ * Writers copy their data into a stream buffer and return as soon as it fits.
+ * The UART interrupt moves the data from the stream buffer to the hardware
+ * FIFO each time the FIFO drains below its trigger level. When the interrupt
+ * finds the stream buffer empty the transmitter goes idle, and the next write
+ * restarts it by filling the FIFO itself.
+ *
+ * Received bytes take the opposite path: the interrupt drains the RX FIFO into
+ * a second stream buffer, from which a single reader task takes them. */
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "stream_buffer.h"
+#include "task.h"
+
+/* Library includes. */
+#include "hw_ints.h"
+#include "hw_memmap.h"
+#include "hw_types.h"
+#include "hw_uart.h"
+#include "interrupt.h"
+#include "sysctl.h"
+#include "uart.h"
+
+#include "serial.h"
+
+/* The interrupt calls FreeRTOS API functions, so it must not be above
+configMAX_SYSCALL_INTERRUPT_PRIORITY. */
+#define serialINTERRUPT_PRIORITY configKERNEL_INTERRUPT_PRIORITY
+
+/* Line configuration, 8-N-1. */
+#define serialCONFIG                                                           \
+  (UART_CONFIG_WLEN_8 | UART_CONFIG_PAR_NONE | UART_CONFIG_STOP_ONE)
+
+/*-----------------------------------------------------------*/
+
+/* Interrupt handler */
+void UART0IntHandler(void);
+
+/* Baud rate, set again when the processor clock changes. */
+static unsigned long ulBaudRate = 0UL;
+
+/* Data waiting to be transmitted. The stream buffer allows a single writer, so
+writers are serialized with xTxMutex. */
+static StreamBufferHandle_t xTxBuffer = NULL;
+static SemaphoreHandle_t xTxMutex = NULL;
+
+/* pdTRUE when no TX interrupt is pending, so a write must restart the
+transmission. */
+static volatile BaseType_t xTxIdle = pdTRUE;
+
+volatile unsigned long ulSerialTxBlocked = 0UL;
+volatile unsigned long ulSerialTxDropped = 0UL;
+
+/* Data received and not yet read. */
+static StreamBufferHandle_t xRxBuffer = NULL;
+
+volatile unsigned long ulSerialRxDropped = 0UL;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Moves bytes from the stream buffer to the TX FIFO until either the
+ * FIFO is full or the stream buffer is empty. Must be called from the UART
+ * interrupt or with the interrupt masked.
+ * @return BaseType_t pdTRUE if a task waiting for space was woken.
+ */
+static BaseType_t prvTxRefill(void) {
+  BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+  unsigned char ucChar;
+
+  while (UARTSpaceAvail(UART0_BASE)) {
+    if (xStreamBufferReceiveFromISR(xTxBuffer, &ucChar, 1,
+                                    &xHigherPriorityTaskWoken) == 0) {
+      xTxIdle = pdTRUE;
+      break;
+    }
+    UARTCharNonBlockingPut(UART0_BASE, ucChar);
+  }
+
+  return xHigherPriorityTaskWoken;
+}
+
+/**
+ * @brief Moves every byte waiting in the RX FIFO to the stream buffer. Must
+ * only be called from the UART interrupt.
+ * @return BaseType_t pdTRUE if the reader task was woken.
+ */
+static BaseType_t prvRxDrain(void) {
+  BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+  unsigned char ucChar;
+
+  while (UARTCharsAvail(UART0_BASE)) {
+    ucChar = (unsigned char)UARTCharNonBlockingGet(UART0_BASE);
+    if (xStreamBufferSendFromISR(xRxBuffer, &ucChar, 1,
+                                 &xHigherPriorityTaskWoken) == 0) {
+      ulSerialRxDropped++;
+    }
+  }
+
+  return xHigherPriorityTaskWoken;
+}
+
+/**
+ * @brief Restarts the transmission if the transmitter went idle.
+ */
+static void prvTxKick(void) {
+  taskENTER_CRITICAL();
+  if (xTxIdle == pdTRUE) {
+    xTxIdle = pdFALSE;
+    prvTxRefill();
+  }
+  taskEXIT_CRITICAL();
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Configures UART0 for 8-N-1 operation with interrupt driven transmit
+ * and receive. Must be called before the scheduler is started.
+ * @param ulBaud Baud rate.
+ */
+void vSerialInit(unsigned long ulBaud) {
+  xTxBuffer = xStreamBufferCreate(serialTX_BUFFER_SIZE, 1);
+  xTxMutex = xSemaphoreCreateMutex();
+  xRxBuffer = xStreamBufferCreate(serialRX_BUFFER_SIZE, 1);
+  if (xTxBuffer == NULL || xTxMutex == NULL || xRxBuffer == NULL) {
+    /* Not enough heap memory available. */
+    for (;;)
+      ;
+  }
+#if configUSE_TRACE_RECORDER == 1
+  vTraceNameQueue(xTxMutex, "SerialTx");
+#endif
+
+  /* Enable the UART. */
+  SysCtlPeripheralEnable(SYSCTL_PERIPH_UART0);
+
+  /* Configure the UART for 8-N-1 operation. This also enables the FIFOs, the
+   * TX interrupt fires when the FIFO drains to half full and the RX interrupt
+   * when it fills to half full. The receive timeout interrupt picks up the
+   * bytes left below that level, such as a single keystroke. */
+  ulBaudRate = ulBaud;
+  UARTConfigSet(UART0_BASE, ulBaudRate, serialCONFIG);
+
+  IntPrioritySet(INT_UART0, serialINTERRUPT_PRIORITY);
+  UARTIntEnable(UART0_BASE, UART_INT_TX | UART_INT_RX | UART_INT_RT);
+  IntEnable(INT_UART0);
+}
+
+/**
+ * @brief Queues data for transmission. Returns as soon as the data is in the
+ * transmit buffer. If the buffer is full, waits up to serialTX_TIMEOUT for
+ * space and drops whatever does not fit by then.
+ * @param pvData Data to send.
+ * @param xLength Number of bytes to send.
+ * @return size_t Number of bytes queued.
+ */
+size_t xSerialWrite(const void *pvData, size_t xLength) {
+  size_t xSent;
+
+  vSerialLock();
+  xSent = xSerialWriteLocked(pvData, xLength);
+  vSerialUnlock();
+
+  return xSent;
+}
+
+/**
+ * @brief Keeps the other writers out, so several writes reach the line
+ * together.
+ */
+void vSerialLock(void) { xSemaphoreTake(xTxMutex, portMAX_DELAY); }
+
+/**
+ * @brief Same as vSerialLock(), but gives up at once if another writer, or
+ * vSerialPause(), holds the lock.
+ * @return BaseType_t pdTRUE if the lock was taken, then vSerialUnlock() must
+ * follow.
+ */
+BaseType_t xSerialTryLock(void) { return xSemaphoreTake(xTxMutex, 0); }
+
+/**
+ * @brief Lets the other writers in again.
+ */
+void vSerialUnlock(void) { xSemaphoreGive(xTxMutex); }
+
+/**
+ * @brief Returns the free space of the transmit buffer. While the caller holds
+ * the lock it can only grow.
+ * @return size_t Free space in bytes.
+ */
+size_t xSerialSpaceAvailable(void) {
+  return xStreamBufferSpacesAvailable(xTxBuffer);
+}
+
+/**
+ * @brief Same as xSerialWrite(), for a caller that holds the lock.
+ * @param pvData Data to send.
+ * @param xLength Number of bytes to send.
+ * @return size_t Number of bytes queued.
+ */
+size_t xSerialWriteLocked(const void *pvData, size_t xLength) {
+  const unsigned char *pucData = pvData;
+  size_t xSent;
+
+  xSent = xStreamBufferSend(xTxBuffer, pucData, xLength, 0);
+  prvTxKick();
+
+  if (xSent < xLength) {
+    ulSerialTxBlocked += xLength - xSent;
+
+    while (xSent < xLength) {
+      size_t xChunk = xStreamBufferSend(xTxBuffer, pucData + xSent,
+                                        xLength - xSent, serialTX_TIMEOUT);
+      if (xChunk == 0) {
+        ulSerialTxDropped += xLength - xSent;
+        break;
+      }
+      xSent += xChunk;
+      prvTxKick();
+    }
+  }
+
+  return xSent;
+}
+
+/**
+ * @brief Sends a string busy waiting on the UART, bypassing the transmit
+ * buffer. Only meant for contexts where the scheduler cannot be used, such as
+ * the stack overflow hook.
+ * @param pcString Null terminated string to send.
+ */
+void vSerialWritePolled(const char *pcString) {
+  UARTIntDisable(UART0_BASE, UART_INT_TX);
+  while (*pcString != '\0') {
+    UARTCharPut(UART0_BASE, *pcString);
+    pcString++;
+  }
+}
+
+/**
+ * @brief Waits until everything written has left the UART and keeps the
+ * writers out until vSerialResume(), so the processor clock can be changed
+ * without garbling a byte.
+ */
+void vSerialPause(void) {
+  xSemaphoreTake(xTxMutex, portMAX_DELAY);
+  while (xStreamBufferIsEmpty(xTxBuffer) == pdFALSE ||
+         (HWREG(UART0_BASE + UART_O_FR) & UART_FR_BUSY) != 0) {
+    vTaskDelay(1);
+  }
+}
+
+/**
+ * @brief Sets the baud rate again for the current processor clock and lets
+ * the writers in. Can be called in a critical section, right after the clock
+ * changed. The receive FIFO is cleared.
+ */
+void vSerialResume(void) {
+  UARTConfigSet(UART0_BASE, ulBaudRate, serialCONFIG);
+  xSemaphoreGive(xTxMutex);
+}
+
+/**
+ * @brief Takes received bytes out of the receive buffer, waiting for at least
+ * one to arrive. Only one task may read.
+ * @param pvBuffer Destination of the bytes.
+ * @param xLength Maximum number of bytes to read.
+ * @param xTicksToWait Maximum time to wait for the first byte.
+ * @return size_t Number of bytes read, 0 on timeout.
+ */
+size_t xSerialRead(void *pvBuffer, size_t xLength, TickType_t xTicksToWait) {
+  return xStreamBufferReceive(xRxBuffer, pvBuffer, xLength, xTicksToWait);
+}
+
+/*-----------------------------------------------------------*/
+
+void UART0IntHandler(void) {
+  unsigned long ulStatus;
+  BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+  traceISR_ENTER();
+
+  ulStatus = UARTIntStatus(UART0_BASE, true);
+  UARTIntClear(UART0_BASE, ulStatus);
+
+  if (ulStatus & UART_INT_TX) {
+    xHigherPriorityTaskWoken = prvTxRefill();
+  }
+
+  if (ulStatus & (UART_INT_RX | UART_INT_RT)) {
+    if (prvRxDrain() == pdTRUE) {
+      xHigherPriorityTaskWoken = pdTRUE;
+    }
+  }
+
+  portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+
+  traceISR_EXIT();
+}
@@ -0,0 +1,38 @@
+#ifndef SERIAL_H
+#define SERIAL_H
+
+#include <stddef.h>
+
+#include "FreeRTOS.h"
+
+/* Size of the transmit stream buffer in bytes. */
+#define serialTX_BUFFER_SIZE (256)
+
+/* Maximum time a writer waits for space in the transmit buffer before the rest
+ * of its data is dropped. */
+#define serialTX_TIMEOUT ((TickType_t)100 / portTICK_PERIOD_MS)
+
+/* Size of the receive stream buffer in bytes. */
+#define serialRX_BUFFER_SIZE (32)
+
+void vSerialInit(unsigned long ulBaud);
+size_t xSerialWrite(const void *pvData, size_t xLength);
+void vSerialLock(void);
+BaseType_t xSerialTryLock(void);
+void vSerialUnlock(void);
+size_t xSerialSpaceAvailable(void);
+size_t xSerialWriteLocked(const void *pvData, size_t xLength);
+void vSerialWritePolled(const char *pcString);
+void vSerialPause(void);
+void vSerialResume(void);
+size_t xSerialRead(void *pvBuffer, size_t xLength, TickType_t xTicksToWait);
+
+/* Bytes that had to wait for space in the transmit buffer, and bytes that
+ * were dropped because the wait timed out. */
+extern volatile unsigned long ulSerialTxBlocked;
+extern volatile unsigned long ulSerialTxDropped;
+
+/* Bytes received while the receive buffer was full. */
+extern volatile unsigned long ulSerialRxDropped;
+
+#endif /* SERIAL_H */
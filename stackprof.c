@@ -0,0 +1,80 @@
+/* Stack profiling.
+ *
+ * The kernel fills the stack of every task with a known pattern when it is
+ * created, and uxTaskGetStackHighWaterMark() counts how much of it was never
+ * overwritten. The main stack, used by main() before the scheduler starts and
+ * by every interrupt handler afterwards, gets the same treatment here. From
+ * the deepest use of each stack a size is recommended, which the stack report
+ * of main.c sends and tools/stacksizes.py writes to stacksizes.h. Only
+ * compiled when configUSE_STACK_PROFILE is 1. */
+
+#include "stackprof.h"
+
+#if configUSE_STACK_PROFILE == 1
+
+/* Pattern the kernel fills the task stacks with, tskSTACK_FILL_BYTE. */
+#define stackprofFILL_WORD (0xA5A5A5A5UL)
+
+/* Words left unpainted below the stack pointer, for the frames of
+vStackProfileInit() itself. */
+#define stackprofPAINT_MARGIN (8)
+
+/* Vector table in startup.c. Its first entry is the top of the main stack. */
+extern void (*const g_pfnVectors[])(void);
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Returns the lowest word of the main stack.
+ * @return unsigned long* The bottom of the stack.
+ */
+static unsigned long *prvMspBottom(void) {
+  return (unsigned long *)g_pfnVectors[0] - stackprofMSP_WORDS;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Fills the unused part of the main stack with the pattern. Must be
+ * called first thing in main().
+ */
+void vStackProfileInit(void) {
+  unsigned long *pulSp;
+
+  __asm volatile("mrs %0, msp" : "=r"(pulSp));
+
+  for (unsigned long *p = prvMspBottom(); p < pulSp - stackprofPAINT_MARGIN;
+       p++) {
+    *p = stackprofFILL_WORD;
+  }
+}
+
+/**
+ * @brief Returns the deepest use of the main stack since
+ * vStackProfileInit().
+ * @return unsigned long Used words.
+ */
+unsigned long ulStackProfileMspUsed(void) {
+  unsigned long *p = prvMspBottom();
+  unsigned long ulFree = 0UL;
+
+  while (ulFree < stackprofMSP_WORDS && p[ulFree] == stackprofFILL_WORD) {
+    ulFree++;
+  }
+
+  return stackprofMSP_WORDS - ulFree;
+}
+
+/**
+ * @brief Returns the stack size recommended for a given use.
+ * @param ulUsedWords Deepest use of the stack.
+ * @return unsigned long Size in words, even so the stack stays 8 byte aligned.
+ */
+unsigned long ulStackProfileRecommend(unsigned long ulUsedWords) {
+  unsigned long ulWords =
+      ulUsedWords + stackprofFRAME_WORDS + stackprofGUARD_WORDS;
+
+  return (ulWords + 1UL) & ~1UL;
+}
+
+#endif /* configUSE_STACK_PROFILE */
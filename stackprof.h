@@ -0,0 +1,20 @@
+#ifndef STACKPROF_H
+#define STACKPROF_H
+
+#include "FreeRTOS.h"
+
+/* Words added to the deepest use seen when recommending a stack size: an
+ * exception frame, which the processor can push on the stack of a task at its
+ * deepest point, and the words the kernel checks for the fill pattern with
+ * configCHECK_FOR_STACK_OVERFLOW set to 2. */
+#define stackprofFRAME_WORDS (8)
+#define stackprofGUARD_WORDS (4)
+
+/* Size of the main stack, used by main() and the interrupt handlers. */
+#define stackprofMSP_WORDS (stackMSP_WORDS + configSTACK_PROFILE_EXTRA)
+
+void vStackProfileInit(void);
+unsigned long ulStackProfileMspUsed(void);
+unsigned long ulStackProfileRecommend(unsigned long ulUsedWords);
+
+#endif /* STACKPROF_H */
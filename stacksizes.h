@@ -0,0 +1,17 @@
+/* Stack sizes in words, generated by tools/stacksizes.py from a
+ * stack profiling run, see configUSE_STACK_PROFILE in
+ * FreeRTOSConfig.h. Each one is the deepest use seen plus room for
+ * an exception frame and the overflow check pattern. */
+
+#ifndef STACKSIZES_H
+#define STACKSIZES_H
+
+#define stackSENSOR_WORDS (70)
+#define stackFILTER_WORDS (108)
+#define stackGRAFIC_WORDS (68)
+#define stackMONITOR_WORDS (222)
+#define stackCOMMAND_WORDS (130)
+#define stackIDLE_WORDS (58)
+#define stackMSP_WORDS (82)
+
+#endif /* STACKSIZES_H */
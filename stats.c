@@ -0,0 +1,113 @@
+/* Windowed run time statistics.
+ *
+ * The cumulative run time counters reported by uxTaskGetSystemState() average
+ * the CPU usage over the whole uptime. Here two successive snapshots are
+ * diffed instead, which gives the usage of every task during the last
+ * interval, and that is smoothed into longer windows. */
+
+#include "stats.h"
+
+/* Smoothing factors of the averages, 1 - exp(-period / window) in Q16. */
+#define statsALPHA_10S (6237UL)
+#define statsALPHA_60S (1083UL)
+
+/* 100% in Q16. */
+#define statsFULL_SCALE (100UL << 16)
+
+/*-----------------------------------------------------------*/
+
+/* CPU usage of each task in every window, in percent Q16, indexed by task
+number - 1. */
+static unsigned long ulLoads[statsMAX_TASKS][eStatsWindowCount];
+
+/* pdTRUE once the averages of a task hold a value. */
+static BaseType_t xStarted[statsMAX_TASKS];
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Moves an average towards a new value.
+ * @param pulAverage The average, percent in Q16.
+ * @param ulValue New value, percent in Q16.
+ * @param ulAlpha Smoothing factor in Q16.
+ */
+static void prvSmooth(unsigned long *pulAverage, unsigned long ulValue,
+                      unsigned long ulAlpha) {
+  if (ulValue >= *pulAverage) {
+    *pulAverage += (unsigned long)(((uint64_t)(ulValue - *pulAverage) *
+                                    ulAlpha) >> 16);
+  } else {
+    *pulAverage -= (unsigned long)(((uint64_t)(*pulAverage - ulValue) *
+                                    ulAlpha) >> 16);
+  }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Updates the statistics with a new snapshot. Must be called every
+ * statsUPDATE_PERIOD_MS.
+ * @param pxCurrent Snapshot just taken with uxTaskGetSystemState().
+ * @param uxCurrentSize Number of entries in pxCurrent.
+ * @param xCurrentTotal Total run time returned with pxCurrent.
+ * @param pxPrevious Snapshot of the previous call.
+ * @param uxPreviousSize Number of entries in pxPrevious, 0 on the first call.
+ * @param xPreviousTotal Total run time returned with pxPrevious.
+ */
+void vStatsUpdate(const TaskStatus_t *pxCurrent, UBaseType_t uxCurrentSize,
+                  configRUN_TIME_COUNTER_TYPE xCurrentTotal,
+                  const TaskStatus_t *pxPrevious, UBaseType_t uxPreviousSize,
+                  configRUN_TIME_COUNTER_TYPE xPreviousTotal) {
+  configRUN_TIME_COUNTER_TYPE xInterval = xCurrentTotal - xPreviousTotal;
+
+  if (xInterval == 0) {
+    return;
+  }
+
+  for (UBaseType_t x = 0; x < uxCurrentSize; x++) {
+    UBaseType_t uxIndex = pxCurrent[x].xTaskNumber - 1;
+    configRUN_TIME_COUNTER_TYPE xRun = pxCurrent[x].ulRunTimeCounter;
+    unsigned long ulLoad;
+
+    if (uxIndex >= statsMAX_TASKS) {
+      continue;
+    }
+
+    /* A task missing from the previous snapshot ran from 0. */
+    for (UBaseType_t y = 0; y < uxPreviousSize; y++) {
+      if (pxPrevious[y].xTaskNumber == pxCurrent[x].xTaskNumber) {
+        xRun -= pxPrevious[y].ulRunTimeCounter;
+        break;
+      }
+    }
+
+    ulLoad = (unsigned long)(((uint64_t)xRun * statsFULL_SCALE) / xInterval);
+    if (ulLoad > statsFULL_SCALE) {
+      ulLoad = statsFULL_SCALE;
+    }
+
+    ulLoads[uxIndex][eStatsWindow1s] = ulLoad;
+    if (xStarted[uxIndex] == pdFALSE) {
+      ulLoads[uxIndex][eStatsWindow10s] = ulLoad;
+      ulLoads[uxIndex][eStatsWindow60s] = ulLoad;
+      xStarted[uxIndex] = pdTRUE;
+    } else {
+      prvSmooth(&ulLoads[uxIndex][eStatsWindow10s], ulLoad, statsALPHA_10S);
+      prvSmooth(&ulLoads[uxIndex][eStatsWindow60s], ulLoad, statsALPHA_60S);
+    }
+  }
+}
+
+/**
+ * @brief Returns the CPU usage of a task.
+ * @param xTaskNumber Task number, as in TaskStatus_t.
+ * @param eWindow Window of the usage.
+ * @return unsigned long Usage in hundredths of a percent.
+ */
+unsigned long ulStatsGetLoad(UBaseType_t xTaskNumber, StatsWindow_t eWindow) {
+  if (xTaskNumber == 0 || xTaskNumber > statsMAX_TASKS ||
+      eWindow >= eStatsWindowCount) {
+    return 0;
+  }
+  return (ulLoads[xTaskNumber - 1][eWindow] * 100UL + (1UL << 15)) >> 16;
+}
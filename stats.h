@@ -0,0 +1,30 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Highest task number tracked by the stats engine. */
+#define statsMAX_TASKS (8)
+
+/* Interval between calls to vStatsUpdate(). The 10 s and 60 s averages assume
+ * it. */
+#define statsUPDATE_PERIOD_MS (1000)
+
+/* Windows over which the CPU usage of each task is reported. The 1 s window is
+ * the last update interval, the others are exponentially weighted averages
+ * with the given time constant, like the load averages of Unix. */
+typedef enum {
+  eStatsWindow1s = 0,
+  eStatsWindow10s,
+  eStatsWindow60s,
+  eStatsWindowCount
+} StatsWindow_t;
+
+void vStatsUpdate(const TaskStatus_t *pxCurrent, UBaseType_t uxCurrentSize,
+                  configRUN_TIME_COUNTER_TYPE xCurrentTotal,
+                  const TaskStatus_t *pxPrevious, UBaseType_t uxPreviousSize,
+                  configRUN_TIME_COUNTER_TYPE xPreviousTotal);
+unsigned long ulStatsGetLoad(UBaseType_t xTaskNumber, StatsWindow_t eWindow);
+
+#endif /* STATS_H */
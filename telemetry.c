@@ -0,0 +1,318 @@
+/* Binary telemetry.
+ *
+ * The monitor screen and the command replies are text for a terminal, which
+ * at 19200 baud leaves room for a few hundred values per second. After the
+ * command "link=bin" they are sent as binary frames instead, along with the
+ * samples and the filter output, and tools/telemetry.py decodes them.
+ *
+ * A frame holds the message type, a sequence number, the payload and a
+ * CRC-16/CCITT-FALSE of all three, framed with SLIP (RFC 1055): an END byte on
+ * both sides, and the END and ESC bytes inside replaced by two byte escapes.
+ * The END in front closes whatever text came before, such as the answer to
+ * "hist=dump", so the decoder only loses that. SLIP escapes one byte at a
+ * time where COBS needs to look a whole block ahead, so the frame goes through
+ * a small chunk straight into the transmit buffer of serial.c instead of being
+ * built whole in RAM first.
+ *
+ * The writers hold the lock of the transmit buffer for the whole frame, so the
+ * frames of different tasks never interleave. A frame never waits, neither for
+ * the lock nor for space: if another writer holds the lock, or the governor
+ * holds it in vSerialPause() while the buffer drains, or the worst case size
+ * of the frame does not fit, it is dropped and counted, and the gap in the
+ * sequence numbers tells the decoder. A slow link never stalls the sample
+ * pipeline. */
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "serial.h"
+#include "stats.h"
+#include "telemetry.h"
+
+/* SLIP special bytes. */
+#define telemetryEND (0xC0)
+#define telemetryESC (0xDB)
+#define telemetryESC_END (0xDC)
+#define telemetryESC_ESC (0xDD)
+
+#define telemetryCRC_INIT (0xFFFF)
+
+/* Longest varint of a 32 bit value. */
+#define telemetryMAX_VARINT (5)
+
+/* Worst case size on the line of a frame: the type, the sequence number, the
+ * payload and the CRC, every byte escaped, between two END bytes. */
+#define telemetryFRAME_SIZE(payload) (2 * ((payload) + 4) + 2)
+
+/*-----------------------------------------------------------*/
+
+static volatile BaseType_t xEnabled = pdFALSE;
+
+volatile unsigned long ulTelemetryDropped = 0UL;
+
+/* Frame being sent, only touched with the serial lock held. */
+static unsigned char ucChunk[telemetryCHUNK_SIZE];
+static size_t xChunkUsed = 0;
+static unsigned short usCrc = telemetryCRC_INIT;
+
+/* A dropped frame takes a sequence number too, with or without the lock, so
+ * it is only touched in a critical section. */
+static unsigned char ucSequence = 0;
+
+/* CRC-16/CCITT-FALSE, polynomial 0x1021, four bits at a time. */
+static const unsigned short usCrcTable[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF};
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Hands the bytes in the chunk to the transmit buffer.
+ */
+static void prvFlush(void) {
+  xSerialWriteLocked(ucChunk, xChunkUsed);
+  xChunkUsed = 0;
+}
+
+/**
+ * @brief Adds a byte to the chunk as it is.
+ * @param ucByte The byte.
+ */
+static void prvPutRaw(unsigned char ucByte) {
+  ucChunk[xChunkUsed++] = ucByte;
+  if (xChunkUsed == telemetryCHUNK_SIZE) {
+    prvFlush();
+  }
+}
+
+/**
+ * @brief Adds a byte of the frame, escaped.
+ * @param ucByte The byte.
+ */
+static void prvEscape(unsigned char ucByte) {
+  if (ucByte == telemetryEND) {
+    prvPutRaw(telemetryESC);
+    prvPutRaw(telemetryESC_END);
+  } else if (ucByte == telemetryESC) {
+    prvPutRaw(telemetryESC);
+    prvPutRaw(telemetryESC_ESC);
+  } else {
+    prvPutRaw(ucByte);
+  }
+}
+
+/**
+ * @brief Adds a byte of the frame covered by the CRC.
+ * @param ucByte The byte.
+ */
+static void prvPut(unsigned char ucByte) {
+  usCrc = (unsigned short)((usCrc << 4) ^
+                           usCrcTable[(usCrc >> 12) ^ (ucByte >> 4)]);
+  usCrc = (unsigned short)((usCrc << 4) ^
+                           usCrcTable[(usCrc >> 12) ^ (ucByte & 0x0F)]);
+  prvEscape(ucByte);
+}
+
+/**
+ * @brief Adds the low 16 bits of a value, little endian.
+ * @param ulValue The value.
+ */
+static void prvPutU16(unsigned long ulValue) {
+  prvPut((unsigned char)ulValue);
+  prvPut((unsigned char)(ulValue >> 8));
+}
+
+/**
+ * @brief Adds a 32 bit value, little endian.
+ * @param ulValue The value.
+ */
+static void prvPutU32(unsigned long ulValue) {
+  prvPutU16(ulValue);
+  prvPutU16(ulValue >> 16);
+}
+
+/**
+ * @brief Adds a signed varint.
+ * @param lValue The value.
+ */
+static void prvPutVarint(long lValue) {
+  unsigned long ulZigzag =
+      ((unsigned long)lValue << 1) ^ (unsigned long)(lValue >> 31);
+
+  while (ulZigzag >= 0x80UL) {
+    prvPut((unsigned char)(ulZigzag | 0x80UL));
+    ulZigzag >>= 7;
+  }
+  prvPut((unsigned char)ulZigzag);
+}
+
+/**
+ * @brief Counts a dropped frame and skips its sequence number.
+ */
+static void prvDrop(void) {
+  taskENTER_CRITICAL();
+  ucSequence++;
+  ulTelemetryDropped++;
+  taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief Takes the serial lock and starts a frame, or drops it if the lock is
+ * taken or the frame might not fit in the transmit buffer.
+ * @param ucType Message type.
+ * @param xPayload Largest size the payload can have.
+ * @return BaseType_t pdTRUE if the frame was started, then prvEnd() must
+ * follow.
+ */
+static BaseType_t prvBegin(unsigned char ucType, size_t xPayload) {
+  unsigned char ucNumber;
+
+  if (xSerialTryLock() == pdFALSE) {
+    prvDrop();
+    return pdFALSE;
+  }
+
+  if (xSerialSpaceAvailable() < telemetryFRAME_SIZE(xPayload)) {
+    prvDrop();
+    vSerialUnlock();
+    return pdFALSE;
+  }
+
+  taskENTER_CRITICAL();
+  ucNumber = ucSequence++;
+  taskEXIT_CRITICAL();
+
+  xChunkUsed = 0;
+  prvPutRaw(telemetryEND);
+  usCrc = telemetryCRC_INIT;
+  prvPut(ucType);
+  prvPut(ucNumber);
+  return pdTRUE;
+}
+
+/**
+ * @brief Adds the CRC, ends the frame and releases the serial lock.
+ */
+static void prvEnd(void) {
+  unsigned short usValue = usCrc;
+
+  prvEscape((unsigned char)usValue);
+  prvEscape((unsigned char)(usValue >> 8));
+  prvPutRaw(telemetryEND);
+  prvFlush();
+
+  vSerialUnlock();
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Switches the monitor, the command replies and the sample stream
+ * between text and binary frames.
+ * @param xEnable pdTRUE for binary frames.
+ */
+void vTelemetrySetEnabled(BaseType_t xEnable) { xEnabled = xEnable; }
+
+/**
+ * @brief Returns whether the binary frames are enabled.
+ * @return BaseType_t pdTRUE if they are.
+ */
+BaseType_t xTelemetryIsEnabled(void) { return xEnabled; }
+
+/**
+ * @brief Sends a block of samples or of filter output.
+ * @param ucType telemetryMSG_SAMPLES or telemetryMSG_FILTERED.
+ * @param usFirst Number of the first sample, counted since boot.
+ * @param piValues The values.
+ * @param iCount Number of values.
+ */
+void vTelemetrySendValues(unsigned char ucType, unsigned short usFirst,
+                          const int *piValues, int iCount) {
+  unsigned long ulPrevious = 0UL;
+
+  if (prvBegin(ucType, 2 + iCount * telemetryMAX_VARINT) == pdFALSE) {
+    return;
+  }
+
+  prvPutU16(usFirst);
+  for (int i = 0; i < iCount; i++) {
+    prvPutVarint((long)((unsigned long)piValues[i] - ulPrevious));
+    ulPrevious = (unsigned long)piValues[i];
+  }
+  prvEnd();
+}
+
+/**
+ * @brief Sends the state, CPU usage and stack high water mark of every task.
+ * @param pxTasks Snapshot of the tasks, after vStatsUpdate().
+ * @param uxCount Number of tasks in the snapshot.
+ * @param xNames pdTRUE to send the name of every task first.
+ */
+void vTelemetrySendTasks(const TaskStatus_t *pxTasks, UBaseType_t uxCount,
+                         BaseType_t xNames) {
+  if (xNames == pdTRUE) {
+    for (UBaseType_t x = 0; x < uxCount; x++) {
+      if (prvBegin(telemetryMSG_TASK_NAME, 1 + configMAX_TASK_NAME_LEN) ==
+          pdTRUE) {
+        prvPut((unsigned char)pxTasks[x].xTaskNumber);
+        for (const char *p = pxTasks[x].pcTaskName; *p != '\0'; p++) {
+          prvPut((unsigned char)*p);
+        }
+        prvEnd();
+      }
+    }
+  }
+
+  if (prvBegin(telemetryMSG_TASKS, 4 + uxCount * 6) == pdFALSE) {
+    return;
+  }
+
+  prvPutU32(xTaskGetTickCount());
+  for (UBaseType_t x = 0; x < uxCount; x++) {
+    unsigned long ulLoad =
+        ulStatsGetLoad(pxTasks[x].xTaskNumber, eStatsWindow1s);
+
+    prvPut((unsigned char)pxTasks[x].xTaskNumber);
+    prvPut((unsigned char)pxTasks[x].eCurrentState);
+    prvPutU16(ulLoad);
+    prvPutU16(pxTasks[x].usStackHighWaterMark);
+  }
+  prvEnd();
+}
+
+/**
+ * @brief Answers a command with the configuration it left.
+ * @param xApplied pdPASS if the command was valid and applied.
+ * @param N Window of the filter.
+ * @param iKind Filter kind.
+ * @param ulRate Sample rate in Hz.
+ */
+void vTelemetrySendAck(BaseType_t xApplied, int N, int iKind,
+                       unsigned long ulRate) {
+  if (prvBegin(telemetryMSG_ACK, 5) == pdFALSE) {
+    return;
+  }
+
+  prvPut(xApplied == pdPASS ? 1 : 0);
+  prvPut((unsigned char)N);
+  prvPut((unsigned char)iKind);
+  prvPutU16(ulRate);
+  prvEnd();
+}
+
+/**
+ * @brief Reports a periodic task that completed a job after its deadline.
+ * @param uxTaskNumber Number of the task, as in the task messages.
+ * @param ulLateMs Time past the deadline in ms, saturated at 0xFFFF.
+ */
+void vTelemetrySendDeadlineMiss(UBaseType_t uxTaskNumber,
+                                unsigned long ulLateMs) {
+  if (prvBegin(telemetryMSG_DEADLINE, 3) == pdFALSE) {
+    return;
+  }
+
+  prvPut((unsigned char)uxTaskNumber);
+  prvPutU16(ulLateMs > 0xFFFFUL ? 0xFFFFUL : ulLateMs);
+  prvEnd();
+}
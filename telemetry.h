@@ -0,0 +1,41 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Message types, with their payload. Multibyte fields are little endian. The
+ * values are signed varints: zigzag encoded, 7 bits per byte with the low
+ * groups first and the top bit set on every byte but the last. The first one
+ * is the value itself, each of the others the difference with the previous
+ * value. */
+#define telemetryMSG_SAMPLES (1)   /* u16 number of the first sample, values. */
+#define telemetryMSG_FILTERED (2)  /* Same, filter output. */
+#define telemetryMSG_TASKS (3)     /* u32 tick count, then for every task u8
+                                      number, u8 state, u16 CPU usage in the
+                                      last second in hundredths of a percent,
+                                      u16 stack high water mark in words. */
+#define telemetryMSG_TASK_NAME (4) /* u8 number, the name. */
+#define telemetryMSG_ACK (5)       /* u8 1 if the command was applied, else 0,
+                                      u8 N, u8 filter kind, u16 sample rate in
+                                      Hz. */
+#define telemetryMSG_DEADLINE (6)  /* u8 task number, u16 ms the job ended
+                                      after its deadline. */
+
+/* Bytes of a frame escaped at a time into the transmit buffer. */
+#define telemetryCHUNK_SIZE (16)
+
+void vTelemetrySetEnabled(BaseType_t xEnabled);
+BaseType_t xTelemetryIsEnabled(void);
+void vTelemetrySendValues(unsigned char ucType, unsigned short usFirst,
+                          const int *piValues, int iCount);
+void vTelemetrySendTasks(const TaskStatus_t *pxTasks, UBaseType_t uxCount,
+                         BaseType_t xNames);
+void vTelemetrySendAck(BaseType_t xApplied, int N, int iKind,
+                       unsigned long ulRate);
+void vTelemetrySendDeadlineMiss(UBaseType_t uxTaskNumber, unsigned long ulLateMs);
+
+/* Frames dropped because they did not fit in the transmit buffer. */
+extern volatile unsigned long ulTelemetryDropped;
+
+#endif /* TELEMETRY_H */
@@ -0,0 +1,241 @@
+/* Tickless idle.
+ *
+ * With configUSE_TICKLESS_IDLE at 1 the idle task calls
+ * vPortSuppressTicksAndSleep() when no task has to run for two ticks or more.
+ * The one below replaces the weak one of port.c, which assumes SysTick always
+ * counts configCPU_CLOCK_HZ and guesses the time lost while SysTick is stopped
+ * from a fixed number of cycles. Here the time comes from the run time clock
+ * of timertest.c, which never stops and counts configCPU_CLOCK_HZ whatever
+ * clock power.c picks.
+ *
+ * The tick boundaries are kept on a line of the run time clock, one tick
+ * period apart: tick xLineTick is due at ullLineTime, the next one a period
+ * later and so on. A sleep programs SysTick to interrupt at the boundary where
+ * the next task wakes, and on the way out counts the ticks that passed on the
+ * run time clock and programs SysTick to interrupt at the next boundary of the
+ * line. The cycles spent between reading the clock and restarting SysTick make
+ * the tick a little late, but the next sleep starts again from the line, so
+ * that error does not add up from one sleep to the next. Each sleep also
+ * measures it: the distance between the tick found in SysTick and the line.
+ *
+ * vTicklessSetClock() keeps the tick in phase when the processor clock
+ * changes, and is used whether tickless idle is enabled or not. */
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Library includes. */
+#include "hw_nvic.h"
+#include "hw_types.h"
+
+#include "power.h"
+#include "tickless.h"
+#include "timertest.h"
+
+/* Tick period in run time clock cycles. */
+#define ticklessPERIOD (configCPU_CLOCK_HZ / configTICK_RATE_HZ)
+
+/* SysTick pending bit of NVIC_INT_CTRL, not in hw_nvic.h. */
+#define ticklessPEND_ST (0x04000000UL)
+
+/* SysTick control, counting the processor clock, stopped and running. */
+#define ticklessSYSTICK_STOPPED (NVIC_ST_CTRL_CLK_SRC | NVIC_ST_CTRL_INTEN)
+#define ticklessSYSTICK_RUNNING (ticklessSYSTICK_STOPPED | NVIC_ST_CTRL_ENABLE)
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Starts SysTick so it interrupts after ulCycles processor cycles, and
+ * every tick period after that.
+ * @param ulCycles Cycles to the first interrupt, at least 2.
+ * @param ulPeriod Tick period in processor cycles.
+ */
+static void prvStartSysTick(unsigned long ulCycles, unsigned long ulPeriod) {
+  HWREG(NVIC_ST_RELOAD) = ulCycles - 1UL;
+  HWREG(NVIC_ST_CURRENT) = 0UL;
+  HWREG(NVIC_ST_CTRL) = ticklessSYSTICK_RUNNING;
+
+  /* Taken at the end of the first period, it has already been loaded. */
+  HWREG(NVIC_ST_RELOAD) = ulPeriod - 1UL;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Changes the tick period to match a new processor clock. What was left
+ * of the current period is scaled, so the tick keeps its phase. Called by
+ * power.c, in a critical section, right after the clock changed.
+ * @param ulOldHz Previous processor clock.
+ * @param ulNewHz New processor clock.
+ */
+void vTicklessSetClock(unsigned long ulOldHz, unsigned long ulNewHz) {
+  unsigned long ulPeriod = ulNewHz / configTICK_RATE_HZ;
+  unsigned long ulLeft = HWREG(NVIC_ST_CURRENT);
+
+  /* Zero means the period just ended, the next one is whole. */
+  if (ulLeft == 0UL) {
+    ulLeft = ulPeriod;
+  } else {
+    ulLeft = (unsigned long)((uint64_t)ulLeft * ulNewHz / ulOldHz);
+  }
+  if (ulLeft < 2UL) {
+    ulLeft = 2UL;
+  }
+
+  prvStartSysTick(ulLeft, ulPeriod);
+}
+
+/*-----------------------------------------------------------*/
+
+#if configUSE_TICKLESS_IDLE == 1
+
+/* The line of tick boundaries: tick xLineTick of the kernel is due at
+ullLineTime of the run time clock. Drawn by the first sleep. */
+static uint64_t ullLineTime = 0ULL;
+static TickType_t xLineTick = 0;
+
+static TicklessStats_t xStats;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Converts run time clock cycles to processor cycles.
+ * @param ullTime Time in run time clock cycles.
+ * @param ulHz Processor clock.
+ * @return unsigned long Processor cycles.
+ */
+static unsigned long prvToCycles(uint64_t ullTime, unsigned long ulHz) {
+  return (unsigned long)(ullTime * ulHz / configCPU_CLOCK_HZ);
+}
+
+/**
+ * @brief Compares the tick found in SysTick with the line and moves the line
+ * to that tick. The line is only redrawn from the tick found on the first
+ * sleep, or when they are half a period or more apart, which means ticks were
+ * lost, for example in a critical section longer than a tick.
+ * @param ullFound Time of the boundary of xTick, from SysTick.
+ * @param xTick Tick count.
+ */
+static void prvCheckLine(uint64_t ullFound, TickType_t xTick) {
+  uint64_t ullDue =
+      ullLineTime + (uint64_t)(TickType_t)(xTick - xLineTick) * ticklessPERIOD;
+  int64_t llError = (int64_t)(ullFound - ullDue);
+  uint64_t ullError = (llError < 0) ? (uint64_t)-llError : (uint64_t)llError;
+
+  if (xStats.ulSleeps == 0UL || ullError >= ticklessPERIOD / 2UL) {
+    if (xStats.ulSleeps != 0UL) {
+      xStats.ulResyncs++;
+    }
+    ullDue = ullFound;
+  } else if (ullError > xStats.ulMaxError) {
+    xStats.ulMaxError = (unsigned long)ullError;
+  }
+
+  ullLineTime = ullDue;
+  xLineTick = xTick;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Stops the tick and sleeps until a task is due or an interrupt comes,
+ * then counts the ticks that passed. Called by the idle task with the
+ * scheduler suspended.
+ * @param xExpectedIdleTime Ticks until the next task is due.
+ */
+void vPortSuppressTicksAndSleep(TickType_t xExpectedIdleTime) {
+  unsigned long ulHz = ulPowerGetClockHz();
+  unsigned long ulPeriod = ulHz / configTICK_RATE_HZ;
+  TickType_t xMaxIdle = (TickType_t)(NVIC_ST_RELOAD_M / ulPeriod - 1UL);
+  TickType_t xElapsed, xFired;
+  uint64_t ullNow, ullDue;
+  unsigned long ulLeft;
+
+  /* SysTick counts 24 bits. A period is left for the line error. */
+  if (xExpectedIdleTime > xMaxIdle) {
+    xExpectedIdleTime = xMaxIdle;
+  }
+
+  /* Every interrupt is masked, the Timer 0 wrap too, but any of them still
+   * ends the WFI. */
+  __asm volatile("cpsid i" ::: "memory");
+  __asm volatile("dsb");
+  __asm volatile("isb");
+
+  ullNow = ullGetRunTimeCounterValue();
+  HWREG(NVIC_ST_CTRL) = ticklessSYSTICK_STOPPED;
+  ulLeft = HWREG(NVIC_ST_CURRENT);
+
+  /* A task was made ready or the tick came since the kernel chose to sleep. */
+  if (eTaskConfirmSleepModeStatus() == eAbortSleep ||
+      (HWREG(NVIC_INT_CTRL) & ticklessPEND_ST) != 0UL) {
+    HWREG(NVIC_ST_CTRL) = ticklessSYSTICK_RUNNING;
+    __asm volatile("cpsie i" ::: "memory");
+    return;
+  }
+
+  /* The next boundary was ulLeft processor cycles away. */
+  prvCheckLine(ullNow + timerTO_RUN_TIME(ulLeft) - ticklessPERIOD,
+               xTaskGetTickCount());
+
+  /* Sleep until the boundary where the next task is due. */
+  ullDue = ullLineTime + (uint64_t)xExpectedIdleTime * ticklessPERIOD;
+  ullNow = ullGetRunTimeCounterValue();
+  prvStartSysTick(prvToCycles(ullDue - ullNow, ulHz), ulPeriod);
+
+  __asm volatile("dsb" ::: "memory");
+  __asm volatile("wfi");
+  __asm volatile("isb");
+
+  /* Let the interrupt that ended the sleep run. */
+  __asm volatile("cpsie i" ::: "memory");
+  __asm volatile("dsb");
+  __asm volatile("isb");
+  __asm volatile("cpsid i" ::: "memory");
+  __asm volatile("dsb");
+  __asm volatile("isb");
+
+  /* If SysTick reached zero, its interrupt, whether it already ran or is still
+   * pending, counts the last tick. */
+  HWREG(NVIC_ST_CTRL) = ticklessSYSTICK_STOPPED;
+  xFired = ((HWREG(NVIC_ST_CTRL) & NVIC_ST_CTRL_COUNT) != 0UL) ? 1 : 0;
+
+  ullNow = ullGetRunTimeCounterValue();
+  xElapsed = 0;
+  if (ullNow > ullLineTime) {
+    xElapsed = (TickType_t)((ullNow - ullLineTime) / ticklessPERIOD);
+  }
+  if (xElapsed > xExpectedIdleTime) {
+    xElapsed = xExpectedIdleTime;
+  }
+  if (xElapsed < xFired) {
+    xElapsed = xFired;
+  }
+  if (xElapsed > xFired) {
+    vTaskStepTick(xElapsed - xFired);
+  }
+
+  /* Go on ticking from the next boundary of the line. */
+  ullDue = ullLineTime + (uint64_t)(xElapsed + 1) * ticklessPERIOD;
+  ullNow = ullGetRunTimeCounterValue();
+  ulLeft = (ullDue > ullNow) ? prvToCycles(ullDue - ullNow, ulHz) : 0UL;
+  prvStartSysTick((ulLeft < 2UL) ? 2UL : ulLeft, ulPeriod);
+
+  xStats.ulSleeps++;
+  xStats.ulTicksSkipped += xElapsed - xFired;
+
+  __asm volatile("cpsie i" ::: "memory");
+}
+
+/**
+ * @brief Copies the statistics of the tickless idle mode.
+ * @param pxStats Where the statistics are copied.
+ */
+void vTicklessGetStats(TicklessStats_t *pxStats) {
+  taskENTER_CRITICAL();
+  *pxStats = xStats;
+  taskEXIT_CRITICAL();
+}
+
+#endif /* configUSE_TICKLESS_IDLE */
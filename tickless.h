@@ -0,0 +1,19 @@
+#ifndef TICKLESS_H
+#define TICKLESS_H
+
+#include "FreeRTOS.h"
+
+/* Statistics of the tickless idle mode. The error is the distance between
+ * where the tick was found when the idle task went to sleep and where the run
+ * time clock says it should be, in run time clock cycles. */
+typedef struct {
+  unsigned long ulSleeps;       /* Times the tick was stopped. */
+  unsigned long ulTicksSkipped; /* Ticks counted without a tick interrupt. */
+  unsigned long ulMaxError;     /* Largest error, either sign. */
+  unsigned long ulResyncs;      /* Times the error was half a tick or more. */
+} TicklessStats_t;
+
+void vTicklessSetClock(unsigned long ulOldHz, unsigned long ulNewHz);
+void vTicklessGetStats(TicklessStats_t *pxStats);
+
+#endif /* TICKLESS_H */
@@ -12,47 +12,60 @@
 #include "interrupt.h"
 #include "sysctl.h"
 
-/* The set frequency of the interrupt. */
-#define timerINTERRUPT_FREQUENCY (20000UL)
+#include "timertest.h"
 
 /* The highest available interrupt priority. */
 #define timerHIGHEST_PRIORITY (0)
 
 /* Misc defines. */
 #define timerMAX_32BIT_VALUE (0xffffffffUL)
-#define timerTIMER_1_COUNT_VALUE (*((unsigned long *)(TIMER1_BASE + 0x48)))
+#define timerTIMER_0_COUNT_VALUE                                               \
+  (*((volatile unsigned long *)(TIMER0_BASE + TIMER_O_TAR)))
+#define timerTIMER_0_RAW_STATUS                                                \
+  (*((volatile unsigned long *)(TIMER0_BASE + TIMER_O_RIS)))
 
 /*-----------------------------------------------------------*/
 
 /* Interrupt handler */
 void Timer0IntHandler(void);
 
-/* Counts the total number of times that the high frequency timer has 'ticked'.
-This value is used by the run time stats function to work out what percentage
-of CPU time each task is taking. */
-volatile unsigned long ulHighFrequencyTimerTicks = 0UL;
+/* The run time stats clock is Timer 0 counting down from 0xffffffff at the
+processor clock, so it needs no interrupt to advance. The interrupt only fires
+when it wraps, every 2^32 cycles (about 215 seconds at 20MHz), to count the
+wraps in the high word of the 64 bit time. When power.c lowers the processor
+clock the count is scaled, so the run time keeps counting at
+configCPU_CLOCK_HZ.
+
+Before, Timer 0 interrupted at 20KHz to increment a counter, and each of those
+interrupts was charged to whichever task happened to be running. Now it
+interrupts once every 215 seconds, and the resolution is one processor cycle
+(50ns) instead of 50us. Measured in the simulator (see README.md), the old
+handler took 60 cycles per entry, 6% of the processor at 20MHz, and the idle
+task got back 5% of the time at rest and 3.9% under load. */
+static volatile unsigned long ulTimerWraps = 0UL;
+
+volatile unsigned long ulTimerScale = timerSCALE_ONE;
+
+/* Timer count and run time at the last change of the processor clock. */
+static uint64_t ullBaseCount = 0ULL;
+static uint64_t ullBaseTime = 0ULL;
 
 /*-----------------------------------------------------------*/
 
 void vSetupHighFrequencyTimer(void) {
-  unsigned long ulFrequency;
-
-  /* Timer zero is used to generate the interrupts. */
+  /* Timer zero is used to measure time. */
   SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER0);
   TimerConfigure(TIMER0_BASE, TIMER_CFG_32_BIT_PER);
 
-  /* Set the timer interrupt to be above the kernel - highest. */
+  /* Set the timer interrupt to be above the kernel - highest, so a wrap is
+  always counted before a task can read the time. */
   IntPrioritySet(INT_TIMER0A, timerHIGHEST_PRIORITY);
 
-  /* Just used to measure time. */
-  TimerLoadSet(TIMER1_BASE, TIMER_A, timerMAX_32BIT_VALUE);
-
   /* Ensure interrupts do not start until the scheduler is running. */
   portDISABLE_INTERRUPTS();
 
-  /* The rate at which the timer will interrupt. */
-  ulFrequency = configCPU_CLOCK_HZ / timerINTERRUPT_FREQUENCY;
-  TimerLoadSet(TIMER0_BASE, TIMER_A, ulFrequency);
+  /* Count the whole 32 bit range, interrupting only on the wrap. */
+  TimerLoadSet(TIMER0_BASE, TIMER_A, timerMAX_32BIT_VALUE);
   IntEnable(INT_TIMER0A);
   TimerIntEnable(TIMER0_BASE, TIMER_TIMA_TIMEOUT);
 
@@ -64,8 +77,53 @@ void vSetupHighFrequencyTimer(void) {
 void Timer0IntHandler(void) {
   TimerIntClear(TIMER0_BASE, TIMER_TIMA_TIMEOUT);
 
-  /* Keep a count of the total number of 20KHz ticks.  This is used by the
-  run time stats functionality to calculate how much CPU time is used by
-  each task. */
-  ulHighFrequencyTimerTicks++;
+  /* The counter wrapped. */
+  ulTimerWraps++;
+}
+/*-----------------------------------------------------------*/
+
+/* Returns the number of processor cycles counted by the timer since it was
+started. */
+static uint64_t prvGetTimerCount(void) {
+  unsigned long ulHigh, ulLow, ulPending;
+
+  /* The timer interrupt cannot be interrupted by the callers, so if the wrap
+  count did not change while the counter was read, both belong together. With
+  interrupts masked, as in the tickless idle code, a wrap can also be pending
+  and not counted yet. A small count was read after it. */
+  do {
+    ulHigh = ulTimerWraps;
+    ulLow = timerMAX_32BIT_VALUE - timerTIMER_0_COUNT_VALUE;
+    ulPending = ((timerTIMER_0_RAW_STATUS & TIMER_RIS_TATORIS) != 0 &&
+                 ulLow < 0x80000000UL);
+  } while (ulHigh != ulTimerWraps);
+
+  return ((uint64_t)(ulHigh + ulPending) << 32) | ulLow;
+}
+/*-----------------------------------------------------------*/
+
+/* Converts a timer count to run time. */
+static uint64_t prvToRunTime(uint64_t ullCount) {
+  ullCount -= ullBaseCount;
+
+  /* Scaled in two halves so the product cannot overflow. */
+  return ullBaseTime + (ullCount >> 16) * ulTimerScale +
+         (((ullCount & 0xffffULL) * ulTimerScale) >> 16);
+}
+/*-----------------------------------------------------------*/
+
+uint64_t ullGetRunTimeCounterValue(void) {
+  return prvToRunTime(prvGetTimerCount());
+}
+/*-----------------------------------------------------------*/
+
+/* Called by power.c, in a critical section, right after the processor clock
+changed to ulHz. The time counted so far is kept at the old scale. */
+void vTimerSetClock(unsigned long ulHz) {
+  uint64_t ullCount = prvGetTimerCount();
+
+  ullBaseTime = prvToRunTime(ullCount);
+  ullBaseCount = ullCount;
+  ulTimerScale =
+      (unsigned long)(((uint64_t)configCPU_CLOCK_HZ << 16) / ulHz);
 }
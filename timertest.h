@@ -0,0 +1,32 @@
+#ifndef TIMERTEST_H
+#define TIMERTEST_H
+
+#include <stdint.h>
+
+#include "hw_memmap.h"
+#include "hw_timer.h"
+
+/* Timer 0 counts processor cycles. It counts down, so its complement counts
+ * up. Reading it is a single load, for the places where the 64 bit
+ * ullGetRunTimeCounterValue() is too slow. The difference of two readings is
+ * right as long as they are less than 2^32 cycles (215 seconds at 20MHz)
+ * apart. */
+#define timerGET_CYCLES()                                                      \
+  (~*((volatile unsigned long *)(TIMER0_BASE + TIMER_O_TAR)))
+
+/* The run time clock always counts cycles of configCPU_CLOCK_HZ, even when
+ * power.c lowers the processor clock. ulTimerScale is the number of run time
+ * clock cycles per processor cycle, in 16.16 fixed point. */
+#define timerSCALE_ONE (65536UL)
+extern volatile unsigned long ulTimerScale;
+
+/* Converts a difference of timerGET_CYCLES() readings to run time clock
+ * cycles, at the current processor clock. */
+#define timerTO_RUN_TIME(cycles)                                               \
+  ((unsigned long)(((uint64_t)(cycles) * ulTimerScale) >> 16))
+
+void vSetupHighFrequencyTimer(void);
+uint64_t ullGetRunTimeCounterValue(void);
+void vTimerSetClock(unsigned long ulHz);
+
+#endif /* TIMERTEST_H */
@@ -0,0 +1,60 @@
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+/* Kernel configuration of kernelbench.c. Same as the one of the firmware where
+ * it matters to the scheduler: preemption, 5 priorities, 32 bit ticks at 1 kHz
+ * and the generic task selection. The tick count starts 20 seconds before it
+ * overflows, so the default run goes through the overflow. */
+
+#include <assert.h>
+
+#define configUSE_PREEMPTION 1
+#define configUSE_IDLE_HOOK 0
+#define configUSE_TICK_HOOK 0
+#define configCPU_CLOCK_HZ ((unsigned long)20000000)
+#define configTICK_RATE_HZ ((TickType_t)1000)
+#define configMINIMAL_STACK_SIZE ((unsigned short)64)
+#define configMAX_TASK_NAME_LEN (10)
+#define configUSE_16_BIT_TICKS 0
+#define configIDLE_SHOULD_YIELD 1
+#define configMAX_PRIORITIES (5)
+#define configUSE_PORT_OPTIMISED_TASK_SELECTION 0
+#define configINITIAL_TICK_COUNT ((TickType_t)(0UL - 20000UL))
+
+#define configSUPPORT_STATIC_ALLOCATION 1
+#define configSUPPORT_DYNAMIC_ALLOCATION 0
+
+/* Set by run.sh. */
+#ifndef configUSE_TIMING_WHEEL
+#define configUSE_TIMING_WHEEL 0
+#endif
+
+/* Set by run.sh for edftest.c. */
+#ifndef configUSE_EDF_SCHEDULING
+#define configUSE_EDF_SCHEDULING 0
+#endif
+#define configEDF_PRIORITY 2
+
+/* Set by run.sh for budgettest.c, which advances the run time counter itself
+ * and gives back mutexes through xTaskPriorityDisinherit(). */
+#ifndef configUSE_TASK_BUDGETS
+#define configUSE_TASK_BUDGETS 0
+#endif
+#if configUSE_TASK_BUDGETS == 1
+extern volatile unsigned long ulBenchRunTime;
+#define configGENERATE_RUN_TIME_STATS 1
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()
+#define portGET_RUN_TIME_COUNTER_VALUE() ulBenchRunTime
+#define configUSE_MUTEXES 1
+#endif
+
+#define INCLUDE_vTaskDelay 1
+#define INCLUDE_xTaskDelayUntil 1
+#define INCLUDE_vTaskSuspend 0
+#define INCLUDE_eTaskGetState 1
+#define INCLUDE_xTaskGetIdleTaskHandle 1
+#define INCLUDE_uxTaskPriorityGet 1
+
+#define configASSERT(x) assert(x)
+
+#endif /* FREERTOS_CONFIG_H */
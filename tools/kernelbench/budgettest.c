@@ -0,0 +1,203 @@
+/* Host test of the CPU budgets of configUSE_TASK_BUDGETS.
+ *
+ * Builds Source/tasks.c and Source/list.c for the host with the port in this
+ * directory, with a task that never blocks on its own, Hog, given a budget,
+ * and a task below it, Mid, that is always ready. The test plays the part of
+ * the tasks, of the tick interrupt and of the run time counter, which it
+ * advances benchCOUNTS_PER_TICK per tick, and checks after every step that the
+ * kernel selected the task it should have:
+ *
+ * - Hog is demoted on the tick that finds its budget used up, and Mid runs,
+ * - Hog gets its priority back when its budget is replenished,
+ * - while Hog holds a mutex it is not demoted, and the next tick after it
+ *   gives the mutex back demotes it,
+ * - Hog using up its budget between two ticks and then blocking is demoted
+ *   when it is switched out, and wakes at the demoted priority,
+ *
+ * and that ulTaskGetCpuBudgetExhausted() counts each demotion. run.sh builds
+ * and runs it:
+ *
+ *     tools/kernelbench/run.sh */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+#if configUSE_TASK_BUDGETS != 1
+#error Build with -DconfigUSE_TASK_BUDGETS=1
+#endif
+
+#define benchCOUNTS_PER_TICK (100UL)
+#define benchBUDGET (3 * benchCOUNTS_PER_TICK)
+#define benchPERIOD (10)
+
+/* The tasks: Hog with a budget, Mid below it. */
+enum { eHog, eMid, eTasks };
+
+static const char *const pcNames[eTasks] = {"Hog", "Mid"};
+static const UBaseType_t uxPriorities[eTasks] = {2, 1};
+
+static StaticTask_t xTaskBuffers[eTasks];
+static StackType_t xStacks[eTasks][configMINIMAL_STACK_SIZE];
+static TaskHandle_t xTasks[eTasks];
+
+static StaticTask_t xIdleBuffer;
+static StackType_t xIdleStack[configMINIMAL_STACK_SIZE];
+
+/* The task the kernel believes is running, from tasks.c. */
+extern void *volatile pxCurrentTCB;
+
+/* Set by the yields of the kernel, see portmacro.h. */
+volatile long xPortYieldPending = 0;
+
+/* The run time counter, see FreeRTOSConfig.h. */
+volatile unsigned long ulBenchRunTime = 0;
+
+/* Tick count at the start of the test. */
+static TickType_t xStart;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The tasks never run, the test calls the kernel for them.
+ * @param pvParameters Unused.
+ */
+static void prvTask(void *pvParameters) { (void)pvParameters; }
+
+/**
+ * @brief Calls vTaskSwitchContext() while the kernel asks for a yield.
+ */
+static void prvSwitch(void) {
+  while (xPortYieldPending != 0) {
+    xPortYieldPending = 0;
+    vTaskSwitchContext();
+  }
+}
+
+/**
+ * @brief Advances the run time counter and the tick count, switching tasks
+ * when the kernel asks to.
+ * @param ulTicks Number of ticks.
+ */
+static void prvTicks(unsigned long ulTicks) {
+  while (ulTicks-- > 0) {
+    ulBenchRunTime += benchCOUNTS_PER_TICK;
+    if (xTaskIncrementTick() != pdFALSE) {
+      xPortYieldPending = 1;
+    }
+    prvSwitch();
+  }
+}
+
+/**
+ * @brief Stops with an error if the running task, the priority of Hog or the
+ * times Hog used up its budget are not the expected ones.
+ * @param iExpected The task that should run.
+ * @param uxHogPriority The priority Hog should have.
+ * @param ulExhausted The times Hog should have used up its budget.
+ * @param pcStep What the test just did.
+ */
+static void prvExpect(int iExpected, UBaseType_t uxHogPriority,
+                      unsigned long ulExhausted, const char *pcStep) {
+  UBaseType_t uxPriority = uxTaskPriorityGet(xTasks[eHog]);
+  unsigned long ulCount = ulTaskGetCpuBudgetExhausted(xTasks[eHog]);
+
+  if (pxCurrentTCB != xTasks[iExpected] || uxPriority != uxHogPriority ||
+      ulCount != ulExhausted) {
+    fprintf(stderr,
+            "%s: %s should run, Hog at priority %lu exhausted %lu times, "
+            "%s runs, Hog at %lu exhausted %lu times at tick %lu\n",
+            pcStep, pcNames[iExpected], (unsigned long)uxHogPriority,
+            ulExhausted, pcTaskGetName(NULL), (unsigned long)uxPriority,
+            ulCount, (unsigned long)(xTaskGetTickCount() - xStart));
+    exit(1);
+  }
+}
+
+/*-----------------------------------------------------------*/
+
+/* Port layer, see portmacro.h. */
+
+StackType_t *pxPortInitialiseStack(StackType_t *pxTopOfStack,
+                                   TaskFunction_t pxCode, void *pvParameters) {
+  (void)pxCode;
+  (void)pvParameters;
+  return pxTopOfStack;
+}
+
+BaseType_t xPortStartScheduler(void) { return pdTRUE; }
+
+void vPortEndScheduler(void) {}
+
+void vApplicationGetIdleTaskMemory(StaticTask_t **ppxIdleTaskTCBBuffer,
+                                   StackType_t **ppxIdleTaskStackBuffer,
+                                   uint32_t *pulIdleTaskStackSize) {
+  *ppxIdleTaskTCBBuffer = &xIdleBuffer;
+  *ppxIdleTaskStackBuffer = xIdleStack;
+  *pulIdleTaskStackSize = configMINIMAL_STACK_SIZE;
+}
+
+/*-----------------------------------------------------------*/
+
+int main(void) {
+  const UBaseType_t uxHog = uxPriorities[eHog];
+  const UBaseType_t uxDemoted = configBUDGET_DEMOTED_PRIORITY;
+
+  for (int i = 0; i < eTasks; i++) {
+    xTasks[i] = xTaskCreateStatic(prvTask, pcNames[i], configMINIMAL_STACK_SIZE,
+                                  NULL, uxPriorities[i], xStacks[i],
+                                  &xTaskBuffers[i]);
+  }
+
+  /* Ticks below are counted from here, where the first period starts. */
+  xStart = xTaskGetTickCount();
+  vTaskSetCpuBudget(xTasks[eHog], benchBUDGET, benchPERIOD);
+  vTaskStartScheduler();
+  xPortYieldPending = 1;
+  prvSwitch();
+  prvExpect(eHog, uxHog, 0, "start");
+
+  /* Hog never blocks. At tick 3 it has run its 3 ticks of budget. */
+  prvTicks(2);
+  prvExpect(eHog, uxHog, 0, "Hog within its budget");
+  prvTicks(1);
+  prvExpect(eMid, uxDemoted, 1, "Hog used up its budget");
+
+  /* Replenished at tick 10. */
+  prvTicks(6);
+  prvExpect(eMid, uxDemoted, 1, "Hog waits for its budget");
+  prvTicks(1);
+  prvExpect(eHog, uxHog, 1, "Hog replenished");
+
+  /* Hog takes a mutex, as xSemaphoreTake() does, and keeps running past its
+   * budget until it gives it back at tick 15. */
+  (void)pvTaskIncrementMutexHeldCount();
+  prvTicks(5);
+  prvExpect(eHog, uxHog, 1, "Hog holds a mutex");
+  (void)xTaskPriorityDisinherit(xTasks[eHog]);
+  prvExpect(eHog, uxHog, 1, "Hog gives the mutex back");
+  prvTicks(1);
+  prvExpect(eMid, uxDemoted, 2, "Hog demoted after the mutex");
+
+  /* Replenished at tick 20. Hog runs 3.5 ticks of counter without a tick and
+   * then waits 2 ticks, until tick 22. */
+  prvTicks(4);
+  prvExpect(eHog, uxHog, 2, "Hog replenished again");
+  ulBenchRunTime += benchBUDGET + benchCOUNTS_PER_TICK / 2;
+  vTaskDelay(2);
+  prvSwitch();
+  prvExpect(eMid, uxDemoted, 3, "Hog blocks after using its budget");
+  prvTicks(2);
+  prvExpect(eMid, uxDemoted, 3, "Hog wakes demoted");
+
+  /* Replenished at tick 30. */
+  prvTicks(8);
+  prvExpect(eHog, uxHog, 3, "Hog replenished after waking");
+
+  printf("budget ok, tick count %lu\n",
+         (unsigned long)(xTaskGetTickCount() - xStart));
+  return 0;
+}
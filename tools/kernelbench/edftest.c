@@ -0,0 +1,211 @@
+/* Host test of the deadline scheduling of configUSE_EDF_SCHEDULING.
+ *
+ * Builds Source/tasks.c and Source/list.c for the host with the port in this
+ * directory, with three tasks scheduled by deadline at configEDF_PRIORITY, one
+ * fixed priority task above them and one below. The test plays the part of
+ * the tasks and of the tick interrupt: it makes the task the kernel selected
+ * block with vTaskDelay(), advances the tick count and checks after every step
+ * that the kernel selected the task it should have:
+ *
+ * - a fixed priority task above the band runs first,
+ * - the task with the earliest deadline runs, and keeps running on the ticks,
+ *   without time slicing,
+ * - a task woken before its deadline keeps its job and preempts a task with a
+ *   later deadline,
+ * - a task woken after its deadline gets a new job, released no sooner than a
+ *   period after the last one,
+ * - a task without a deadline in the band runs as if its deadline were now,
+ *
+ * and then runs past the overflow of the tick count. run.sh builds and runs
+ * it:
+ *
+ *     tools/kernelbench/run.sh */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+#if configUSE_EDF_SCHEDULING != 1
+#error Build with -DconfigUSE_EDF_SCHEDULING=1
+#endif
+
+/* The tasks: three at configEDF_PRIORITY, one above and one below. */
+enum { eA, eB, eC, eHigh, eLow, eTasks };
+
+static const char *const pcNames[eTasks] = {"A", "B", "C", "High", "Low"};
+static const UBaseType_t uxPriorities[eTasks] = {
+    configEDF_PRIORITY, configEDF_PRIORITY, configEDF_PRIORITY,
+    configEDF_PRIORITY + 1, configEDF_PRIORITY - 1};
+
+static StaticTask_t xTaskBuffers[eTasks];
+static StackType_t xStacks[eTasks][configMINIMAL_STACK_SIZE];
+static TaskHandle_t xTasks[eTasks];
+
+static StaticTask_t xIdleBuffer;
+static StackType_t xIdleStack[configMINIMAL_STACK_SIZE];
+
+/* The task the kernel believes is running, from tasks.c. */
+extern void *volatile pxCurrentTCB;
+
+/* Set by the yields of the kernel, see portmacro.h. */
+volatile long xPortYieldPending = 0;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The tasks never run, the test calls the kernel for them.
+ * @param pvParameters Unused.
+ */
+static void prvTask(void *pvParameters) { (void)pvParameters; }
+
+/**
+ * @brief Calls vTaskSwitchContext() while the kernel asks for a yield.
+ */
+static void prvSwitch(void) {
+  while (xPortYieldPending != 0) {
+    xPortYieldPending = 0;
+    vTaskSwitchContext();
+  }
+}
+
+/**
+ * @brief Advances the tick count, switching tasks when the kernel asks to.
+ * @param ulTicks Number of ticks.
+ */
+static void prvTicks(unsigned long ulTicks) {
+  while (ulTicks-- > 0) {
+    if (xTaskIncrementTick() != pdFALSE) {
+      xPortYieldPending = 1;
+    }
+    prvSwitch();
+  }
+}
+
+/**
+ * @brief Makes the running task wait.
+ * @param xTicks Ticks to wait.
+ */
+static void prvDelay(TickType_t xTicks) {
+  vTaskDelay(xTicks);
+  prvSwitch();
+}
+
+/**
+ * @brief Stops with an error if the running task is not the expected one.
+ * @param iExpected The expected task.
+ * @param pcStep What the test just did.
+ */
+static void prvExpect(int iExpected, const char *pcStep) {
+  if (pxCurrentTCB != xTasks[iExpected]) {
+    fprintf(stderr, "%s: %s should run, %s runs at tick %lu\n", pcStep,
+            pcNames[iExpected], pcTaskGetName(NULL),
+            (unsigned long)xTaskGetTickCount());
+    exit(1);
+  }
+}
+
+/*-----------------------------------------------------------*/
+
+/* Port layer, see portmacro.h. */
+
+StackType_t *pxPortInitialiseStack(StackType_t *pxTopOfStack,
+                                   TaskFunction_t pxCode, void *pvParameters) {
+  (void)pxCode;
+  (void)pvParameters;
+  return pxTopOfStack;
+}
+
+BaseType_t xPortStartScheduler(void) { return pdTRUE; }
+
+void vPortEndScheduler(void) {}
+
+void vApplicationGetIdleTaskMemory(StaticTask_t **ppxIdleTaskTCBBuffer,
+                                   StackType_t **ppxIdleTaskStackBuffer,
+                                   uint32_t *pulIdleTaskStackSize) {
+  *ppxIdleTaskTCBBuffer = &xIdleBuffer;
+  *ppxIdleTaskStackBuffer = xIdleStack;
+  *pulIdleTaskStackSize = configMINIMAL_STACK_SIZE;
+}
+
+/*-----------------------------------------------------------*/
+
+int main(void) {
+  for (int i = 0; i < eTasks; i++) {
+    xTasks[i] = xTaskCreateStatic(prvTask, pcNames[i], configMINIMAL_STACK_SIZE,
+                                  NULL, uxPriorities[i], xStacks[i],
+                                  &xTaskBuffers[i]);
+  }
+
+  /* Periods and relative deadlines in ticks. The tick count starts at 0 here,
+   * relative to the start of the test. */
+  vTaskSetEdfParameters(xTasks[eA], 100, 50);
+  vTaskSetEdfParameters(xTasks[eB], 100, 20);
+  vTaskSetEdfParameters(xTasks[eC], 1000, 1000);
+  vTaskStartScheduler();
+  xPortYieldPending = 1;
+  prvSwitch();
+  prvExpect(eHigh, "start");
+
+  /* High waits until 30. B has the earliest deadline, 20. */
+  prvDelay(30);
+  prvExpect(eB, "High waits");
+  prvTicks(5);
+  prvExpect(eB, "no time slicing");
+
+  /* B waits until 105. A has deadline 50, C 1000. */
+  prvDelay(100);
+  prvExpect(eA, "B waits");
+  prvDelay(10);
+  prvExpect(eC, "A waits");
+
+  /* A wakes at 15, before its deadline 50: same job, which is before C's. */
+  prvTicks(10);
+  prvExpect(eA, "A wakes in its job");
+
+  /* A waits until 215. High wakes at 30 above the band, and at 35 waits until
+   * 1035. */
+  prvDelay(200);
+  prvExpect(eC, "A waits again");
+  prvTicks(20);
+  prvExpect(eHigh, "High wakes");
+  prvDelay(1000);
+  prvExpect(eC, "High waits again");
+
+  /* B wakes at 105, past its deadline 20: a new job released at 105, no
+   * sooner than 0 + 100, with deadline 125 before C's 1000. */
+  prvTicks(70);
+  prvExpect(eB, "B wakes in a new job");
+  prvDelay(2000);
+  prvExpect(eC, "B waits again");
+
+  /* A wakes at 215 in a new job with deadline 265. */
+  prvTicks(110);
+  prvExpect(eA, "A wakes in a new job");
+
+  /* C without a deadline runs as if it were due now. */
+  vTaskSetEdfParameters(xTasks[eC], 0, 0);
+  xPortYieldPending = 1;
+  prvSwitch();
+  prvExpect(eC, "C has no deadline");
+  prvDelay(5000);
+  prvExpect(eA, "C waits");
+  prvDelay(5000);
+  prvExpect(eLow, "A waits, only Low is ready");
+
+  /* High wakes at 1035 and then waits until after the overflow of the tick
+   * count, 20000 ticks after the start. */
+  prvTicks(1035 - 215);
+  prvExpect(eHigh, "High wakes at 1035");
+  prvDelay(20000);
+  prvExpect(eLow, "High waits across the overflow");
+  prvTicks(20000);
+  prvExpect(eHigh, "High wakes after the overflow");
+
+  printf("%-6s edf ok, tick count %lu\n",
+         configUSE_TIMING_WHEEL ? "wheel" : "sorted",
+         (unsigned long)xTaskGetTickCount());
+  return 0;
+}
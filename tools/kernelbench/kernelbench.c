@@ -0,0 +1,274 @@
+/* Host benchmark of the kernel delayed task lists.
+ *
+ * Builds Source/tasks.c and Source/list.c for the host with the port in this
+ * directory, and plays the part of the scheduler and the tick interrupt: there
+ * are no context switches, every task is periodic, and on each tick the
+ * benchmark makes every task that is due the current one and calls
+ * xTaskDelayUntil() for it, then calls xTaskIncrementTick(). Both calls are
+ * timed. It also checks that every task is unblocked on the tick it is due,
+ * neither before nor after, and that a task whose wake time overflows the tick
+ * count stays blocked: on the first tick that is 14 modulo 64 it is delayed
+ * for 2^32 - 5 ticks, so its wake time falls in a slot of the current turn of
+ * the timing wheel the tick count has already passed.
+ *
+ * run.sh builds it with the sorted delayed lists and with the timing wheel of
+ * configUSE_TIMING_WHEEL and runs both with 4, 32 and 128 tasks:
+ *
+ *     tools/kernelbench/run.sh
+ *
+ * or by hand:
+ *
+ *     kernelbench TASKS [TICKS] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define benchMAX_TASKS (128)
+#define benchDEFAULT_TICKS (100000UL)
+#define benchSTACK_WORDS (configMINIMAL_STACK_SIZE)
+
+/* Histogram of the call times: 10 ns per bin up to 100 us. */
+#define benchBIN_NS (10UL)
+#define benchBINS (10000)
+
+/* Periods of the tasks in ticks, given in turn. */
+static const TickType_t xPeriods[] = {1,  2,   5,   10,  20,
+                                      50, 100, 250, 500, 1000};
+
+static StaticTask_t xTaskBuffers[benchMAX_TASKS];
+static StackType_t xStacks[benchMAX_TASKS][benchSTACK_WORDS];
+static TaskHandle_t xTasks[benchMAX_TASKS];
+static TickType_t xPrevious[benchMAX_TASKS];
+static TickType_t xDue[benchMAX_TASKS];
+
+/* Task delayed until the tick count overflows and comes back to 5 ticks
+ * before it was delayed. */
+#define benchWRAP_DELAY ((TickType_t)(0UL - 5UL))
+#define benchWRAP_PHASE (14UL)
+static StaticTask_t xWrapBuffer;
+static StackType_t xWrapStack[benchSTACK_WORDS];
+static TaskHandle_t xWrapTask;
+static BaseType_t xWrapDelayed = pdFALSE;
+
+static StaticTask_t xIdleBuffer;
+static StackType_t xIdleStack[configMINIMAL_STACK_SIZE];
+
+/* The task the kernel believes is running, from tasks.c. */
+extern void *volatile pxCurrentTCB;
+
+/* Set by the yields of the kernel, see portmacro.h. The benchmark does the
+ * switching itself and ignores it. */
+volatile long xPortYieldPending = 0;
+
+/* Times of one kind of call. The host is not a real time system, so a few
+ * calls take much longer than they should: a percentile tells more than the
+ * maximum. */
+typedef struct {
+  unsigned long long ullTotal; /* ns. */
+  unsigned long ulCalls;
+  unsigned long ulBins[benchBINS];
+} Timing_t;
+
+static Timing_t xTickTiming, xDelayTiming;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The tasks never run, the benchmark calls the kernel for them.
+ * @param pvParameters Unused.
+ */
+static void prvTask(void *pvParameters) { (void)pvParameters; }
+
+/**
+ * @brief Returns a monotonic time.
+ * @return unsigned long long Time in ns.
+ */
+static unsigned long long prvNow(void) {
+  struct timespec xTime;
+
+  clock_gettime(CLOCK_MONOTONIC, &xTime);
+  return (unsigned long long)xTime.tv_sec * 1000000000ULL +
+         (unsigned long long)xTime.tv_nsec;
+}
+
+/**
+ * @brief Adds a call to the timings.
+ * @param pxTiming Timings.
+ * @param ullStart Time the call started, from prvNow().
+ */
+static void prvAddTiming(Timing_t *pxTiming, unsigned long long ullStart) {
+  unsigned long ulTime = (unsigned long)(prvNow() - ullStart);
+  unsigned long ulBin = ulTime / benchBIN_NS;
+
+  pxTiming->ullTotal += ulTime;
+  pxTiming->ulCalls++;
+  pxTiming->ulBins[(ulBin < benchBINS) ? ulBin : benchBINS - 1]++;
+}
+
+/**
+ * @brief Returns the time 99.9% of the calls took at most.
+ * @param pxTiming Timings.
+ * @return unsigned long Time in ns, rounded up to a bin.
+ */
+static unsigned long prvPercentile(const Timing_t *pxTiming) {
+  unsigned long ulCount = 0;
+  int i;
+
+  for (i = 0; i < benchBINS - 1; i++) {
+    ulCount += pxTiming->ulBins[i];
+    if (ulCount * 1000ULL >= pxTiming->ulCalls * 999ULL) {
+      break;
+    }
+  }
+  return (unsigned long)(i + 1) * benchBIN_NS;
+}
+
+/**
+ * @brief Stops with an error if the task is not in the expected state.
+ * @param i Task.
+ * @param xTick Tick count.
+ * @param eExpected Expected state.
+ */
+static void prvCheckState(int i, TickType_t xTick, eTaskState eExpected) {
+  eTaskState eState = eTaskGetState(xTasks[i]);
+
+  if (eState != eExpected) {
+    fprintf(stderr, "task %d with period %lu due at %lu is %d at tick %lu\n",
+            i, (unsigned long)xPeriods[i % 10], (unsigned long)xDue[i],
+            (int)eState, (unsigned long)xTick);
+    exit(1);
+  }
+}
+
+/**
+ * @brief Delays the task whose wake time overflows on the right tick, then
+ * stops with an error if it is not blocked.
+ * @param xTick Tick count.
+ * @param pvIdle The idle task, made the current one again.
+ */
+static void prvCheckWrap(TickType_t xTick, void *pvIdle) {
+  if (xWrapDelayed == pdFALSE) {
+    if ((xTick & 63UL) != benchWRAP_PHASE) {
+      return;
+    }
+    pxCurrentTCB = xWrapTask;
+    vTaskDelay(benchWRAP_DELAY);
+    pxCurrentTCB = pvIdle;
+    xWrapDelayed = pdTRUE;
+  }
+  if (eTaskGetState(xWrapTask) != eBlocked) {
+    fprintf(stderr, "task delayed %lu ticks woke at tick %lu\n",
+            (unsigned long)benchWRAP_DELAY, (unsigned long)xTick);
+    exit(1);
+  }
+}
+
+/*-----------------------------------------------------------*/
+
+/* Port layer, see portmacro.h. */
+
+StackType_t *pxPortInitialiseStack(StackType_t *pxTopOfStack,
+                                   TaskFunction_t pxCode, void *pvParameters) {
+  (void)pxCode;
+  (void)pvParameters;
+  return pxTopOfStack;
+}
+
+BaseType_t xPortStartScheduler(void) { return pdTRUE; }
+
+void vPortEndScheduler(void) {}
+
+void vApplicationGetIdleTaskMemory(StaticTask_t **ppxIdleTaskTCBBuffer,
+                                   StackType_t **ppxIdleTaskStackBuffer,
+                                   uint32_t *pulIdleTaskStackSize) {
+  *ppxIdleTaskTCBBuffer = &xIdleBuffer;
+  *ppxIdleTaskStackBuffer = xIdleStack;
+  *pulIdleTaskStackSize = configMINIMAL_STACK_SIZE;
+}
+
+/*-----------------------------------------------------------*/
+
+int main(int argc, char *argv[]) {
+  int iTasks;
+  unsigned long ulTicks = benchDEFAULT_TICKS;
+  TickType_t xStart, xTick;
+  void *pvIdle;
+
+  if (argc < 2 || (iTasks = atoi(argv[1])) < 1 || iTasks > benchMAX_TASKS) {
+    fprintf(stderr, "usage: %s TASKS(1-%d) [TICKS]\n", argv[0],
+            benchMAX_TASKS);
+    return 2;
+  }
+  if (argc > 2) {
+    ulTicks = strtoul(argv[2], NULL, 0);
+  }
+
+  for (int i = 0; i < iTasks; i++) {
+    char cName[configMAX_TASK_NAME_LEN];
+
+    snprintf(cName, sizeof(cName), "T%d", i);
+    xTasks[i] = xTaskCreateStatic(prvTask, cName, benchSTACK_WORDS, NULL, 1,
+                                  xStacks[i], &xTaskBuffers[i]);
+  }
+  xWrapTask = xTaskCreateStatic(prvTask, "Wrap", benchSTACK_WORDS, NULL, 1,
+                                xWrapStack, &xWrapBuffer);
+  vTaskStartScheduler();
+  pvIdle = xTaskGetIdleTaskHandle();
+
+  /* Block every task until its first due tick, spread over its period. */
+  xStart = xTaskGetTickCount();
+  for (int i = 0; i < iTasks; i++) {
+    TickType_t xPeriod = xPeriods[i % 10];
+    TickType_t xPhase = 1 + ((TickType_t)i * 7) % xPeriod;
+
+    xPrevious[i] = xStart + xPhase - xPeriod;
+    xDue[i] = xStart + xPhase;
+    pxCurrentTCB = xTasks[i];
+    xTaskDelayUntil(&xPrevious[i], xPeriod);
+  }
+
+  for (unsigned long ulTick = 0; ulTick < ulTicks; ulTick++) {
+    unsigned long long ullStart;
+
+    pxCurrentTCB = pvIdle;
+    ullStart = prvNow();
+    xTaskIncrementTick();
+    prvAddTiming(&xTickTiming, ullStart);
+    xTick = xTaskGetTickCount();
+    prvCheckWrap(xTick, pvIdle);
+
+    for (int i = 0; i < iTasks; i++) {
+      if (xDue[i] != xTick) {
+        prvCheckState(i, xTick, eBlocked);
+        continue;
+      }
+
+      prvCheckState(i, xTick, eReady);
+      pxCurrentTCB = xTasks[i];
+      ullStart = prvNow();
+      xTaskDelayUntil(&xPrevious[i], xPeriods[i % 10]);
+      prvAddTiming(&xDelayTiming, ullStart);
+      xDue[i] += xPeriods[i % 10];
+
+      pxCurrentTCB = pvIdle;
+      prvCheckState(i, xTick, eBlocked);
+    }
+  }
+
+  /* Mean and 99.9th percentile of each call, and the time both took per
+   * tick. */
+  printf("%-6s %3d tasks: tick %4llu ns (%5lu), delay %4llu ns (%5lu), "
+         "per tick %5llu ns\n",
+         configUSE_TIMING_WHEEL ? "wheel" : "sorted", iTasks,
+         xTickTiming.ullTotal / xTickTiming.ulCalls,
+         prvPercentile(&xTickTiming),
+         xDelayTiming.ullTotal / xDelayTiming.ulCalls,
+         prvPercentile(&xDelayTiming),
+         (xTickTiming.ullTotal + xDelayTiming.ullTotal) / ulTicks);
+  return 0;
+}
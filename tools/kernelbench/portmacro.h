@@ -0,0 +1,65 @@
+#ifndef PORTMACRO_H
+#define PORTMACRO_H
+
+/* Port of the kernel to the host for kernelbench.c and switchbench.c. Nothing
+ * runs in an interrupt and there are no context switches, so the critical
+ * sections are empty and a yield only sets xPortYieldPending, for the
+ * benchmark to call vTaskSwitchContext() if it wants. The types are those of
+ * the ARM_CM3 port, except the pointers. */
+
+#include <stdint.h>
+
+#define portCHAR char
+#define portFLOAT float
+#define portDOUBLE double
+#define portLONG long
+#define portSHORT short
+#define portSTACK_TYPE uint32_t
+#define portBASE_TYPE long
+#define portPOINTER_SIZE_TYPE uintptr_t
+
+typedef portSTACK_TYPE StackType_t;
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+
+#if (configUSE_16_BIT_TICKS == 1)
+typedef uint16_t TickType_t;
+#define portMAX_DELAY (TickType_t)0xffff
+#else
+typedef uint32_t TickType_t;
+#define portMAX_DELAY (TickType_t)0xffffffffUL
+#define portTICK_TYPE_IS_ATOMIC 1
+#endif
+
+#define portSTACK_GROWTH (-1)
+#define portTICK_PERIOD_MS ((TickType_t)1000 / configTICK_RATE_HZ)
+#define portBYTE_ALIGNMENT 8
+
+extern volatile long xPortYieldPending;
+
+#define portYIELD() (xPortYieldPending = 1)
+#define portEND_SWITCHING_ISR(xSwitchRequired)                                 \
+  do {                                                                         \
+    if (xSwitchRequired) {                                                     \
+      xPortYieldPending = 1;                                                   \
+    }                                                                          \
+  } while (0)
+#define portYIELD_FROM_ISR(x) portEND_SWITCHING_ISR(x)
+
+#define portSET_INTERRUPT_MASK_FROM_ISR() (0)
+#define portCLEAR_INTERRUPT_MASK_FROM_ISR(x) ((void)(x))
+#define portDISABLE_INTERRUPTS()
+#define portENABLE_INTERRUPTS()
+#define portENTER_CRITICAL()
+#define portEXIT_CRITICAL()
+
+#define portTASK_FUNCTION_PROTO(vFunction, pvParameters)                       \
+  void vFunction(void *pvParameters)
+#define portTASK_FUNCTION(vFunction, pvParameters)                             \
+  void vFunction(void *pvParameters)
+
+#define portNOP()
+#define portINLINE inline
+#define portFORCE_INLINE inline
+
+#endif /* PORTMACRO_H */
@@ -0,0 +1,64 @@
+#!/bin/sh
+# Builds kernelbench.c for the host with the sorted delayed lists and with the
+# timing wheel, and runs both with 4, 32 and 128 tasks. Then builds
+# switchbench.c without and with the preemption thresholds and runs both at
+# 2000, 4000 and 5000 Hz, and at 5000 Hz with 100 us of each filter and
+# graficar block run with the scheduler suspended. Then builds edftest.c with
+# the deadline scheduling of configUSE_EDF_SCHEDULING, with both kinds of
+# delayed lists, and runs it. Last, builds and runs budgettest.c with the CPU
+# budgets of configUSE_TASK_BUDGETS.
+# Extra arguments are passed to the compiler, for example
+# -DconfigTIMING_WHEEL_BITS=4.
+set -e
+cd "$(dirname "$0")/../.."
+OUT="${TMPDIR:-/tmp}/kernelbench"
+mkdir -p "$OUT"
+
+# The end marker of a list is a MiniListItem_t read through ListItem_t
+# pointers, which breaks under the strict aliasing rules of -O2.
+for WHEEL in 0 1; do
+  ${CC:-cc} -O2 -fno-strict-aliasing -Wall \
+    -DconfigUSE_TIMING_WHEEL=$WHEEL "$@" \
+    -Itools/kernelbench -ISource/include \
+    tools/kernelbench/kernelbench.c Source/tasks.c Source/list.c \
+    -o "$OUT/kernelbench$WHEEL"
+done
+
+for TASKS in 4 32 128; do
+  for WHEEL in 0 1; do
+    "$OUT/kernelbench$WHEEL" $TASKS
+  done
+done
+
+for THRESHOLDS in 0 1; do
+  ${CC:-cc} -O2 -fno-strict-aliasing -Wall \
+    -DconfigUSE_PREEMPTION_THRESHOLDS=$THRESHOLDS "$@" \
+    -Itools/kernelbench -ISource/include \
+    tools/kernelbench/switchbench.c Source/tasks.c Source/list.c \
+    -o "$OUT/switchbench$THRESHOLDS"
+done
+
+for RATE in 2000 4000 5000; do
+  for THRESHOLDS in 0 1; do
+    "$OUT/switchbench$THRESHOLDS" $RATE
+  done
+done
+for THRESHOLDS in 0 1; do
+  "$OUT/switchbench$THRESHOLDS" 5000 900 500 60 100
+done
+
+for WHEEL in 0 1; do
+  ${CC:-cc} -O2 -fno-strict-aliasing -Wall \
+    -DconfigUSE_EDF_SCHEDULING=1 -DconfigUSE_TIMING_WHEEL=$WHEEL "$@" \
+    -Itools/kernelbench -ISource/include \
+    tools/kernelbench/edftest.c Source/tasks.c Source/list.c \
+    -o "$OUT/edftest$WHEEL"
+  "$OUT/edftest$WHEEL"
+done
+
+${CC:-cc} -O2 -fno-strict-aliasing -Wall \
+  -DconfigUSE_TASK_BUDGETS=1 "$@" \
+  -Itools/kernelbench -ISource/include \
+  tools/kernelbench/budgettest.c Source/tasks.c Source/list.c \
+  -o "$OUT/budgettest"
+"$OUT/budgettest"
@@ -0,0 +1,360 @@
+/* Host benchmark of the context switches of the sample pipeline.
+ *
+ * Builds Source/tasks.c and Source/list.c for the host with the port in this
+ * directory, and simulates the sensor, filter and graficar tasks of main.c
+ * with the priorities of the firmware. Time is simulated in us: the sampler
+ * interrupt hands a block to the sensor task every mainBLOCK_SIZE samples, the
+ * tick interrupt comes every 1000 us, and each task spends some time on every
+ * block before it passes the block on and waits for the next one. The
+ * waits go through vTaskSuspendAll(), vTaskPlaceOnEventList(),
+ * xTaskResumeAll() and xTaskRemoveFromEventList() as in queue.c, with the
+ * scheduler suspended for benchWAIT_US before a task blocks, so the
+ * interrupts can land there too. Every yield the kernel asks for calls
+ * vTaskSwitchContext(), and is counted as a yield, which on the target is a
+ * PendSV round trip whether or not it changes the running task. A switch is
+ * counted each time it does change the running task.
+ *
+ * run.sh builds it without and with configUSE_PREEMPTION_THRESHOLDS, where
+ * the filter and graficar tasks get the thresholds of main.c, and runs both
+ * at a few sample rates:
+ *
+ *     tools/kernelbench/run.sh
+ *
+ * or by hand:
+ *
+ *     switchbench RATE_HZ [FILTER_US GRAFIC_US [SECONDS [SUSPENDED_US]]]
+ *
+ * The mean times of the filter and graficar tasks per block are guesses, and
+ * each block takes from half to one and a half times the mean, so that the
+ * tasks sometimes overlap. With no overlap every block costs the same four
+ * switches, from the idle task through the three tasks and back, however the
+ * tasks are scheduled. Other figures give other counts, so they can be passed
+ * in. The time a block takes from the sampler to the display is printed too:
+ * a threshold that holds off the sensor task makes some blocks wait longer.
+ *
+ * SUSPENDED_US, 0 by default, is the time the filter and graficar tasks spend
+ * with the scheduler suspended at the start of each block, as a task that
+ * allocates from heap_4 does. A sampler interrupt there readies the sensor
+ * task, and xTaskResumeAll() yields to it only if it is above the threshold.
+ * run.sh runs it once with 100 us. */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+#include "list.h"
+#include "task.h"
+
+/* As in main.c. */
+#define benchBLOCK_SIZE (8UL)
+#define benchSENSOR_PRIORITY (3)
+#define benchFILTER_PRIORITY (benchSENSOR_PRIORITY - 1)
+#define benchFILTER_THRESHOLD (benchSENSOR_PRIORITY)
+
+#define benchTICK_US (1000UL)
+#define benchDEFAULT_SECONDS (60UL)
+#define benchSENSOR_US (40UL)
+#define benchWAIT_US (10UL)
+#define benchDEFAULT_FILTER_US (900UL)
+#define benchDEFAULT_GRAFIC_US (500UL)
+
+/* Stages of the pipeline, in order. */
+enum { eSensor, eFilter, eGrafic, eStages };
+
+typedef struct {
+  const char *pcName;
+  UBaseType_t uxPriority;
+  UBaseType_t uxThreshold; /* 0 for none. */
+  unsigned long ulWork;    /* us per block. */
+  TaskHandle_t xTask;
+  List_t xWaiting;         /* The task, while it waits for a block. */
+  unsigned long ulBlocks;  /* Blocks waiting for it. */
+  unsigned long ulLeft;    /* us left on the current block, 0 if none. */
+  unsigned long ulSuspended; /* us left before it blocks, 0 if it does not. */
+  unsigned long ulLocked;  /* us left of the block with the scheduler suspended. */
+  StaticTask_t xBuffer;
+  StackType_t xStack[configMINIMAL_STACK_SIZE];
+} Stage_t;
+
+static Stage_t xStages[eStages] = {
+    {"Sensor", benchSENSOR_PRIORITY, 0, benchSENSOR_US},
+    {"Filter", benchFILTER_PRIORITY, benchFILTER_THRESHOLD,
+     benchDEFAULT_FILTER_US},
+    {"Grafic", benchFILTER_PRIORITY, benchFILTER_THRESHOLD,
+     benchDEFAULT_GRAFIC_US},
+};
+
+static StaticTask_t xIdleBuffer;
+static StackType_t xIdleStack[configMINIMAL_STACK_SIZE];
+
+/* The task the kernel believes is running, from tasks.c. */
+extern void *volatile pxCurrentTCB;
+
+/* Set by the yields of the kernel, see portmacro.h. */
+volatile long xPortYieldPending = 0;
+
+static unsigned long ulYields = 0;
+static unsigned long ulSwitches = 0;
+static unsigned long ulLockedWork = 0;
+static unsigned long ulPreemptions = 0;
+
+/* State of the generator of the job times, the same on every run. */
+static unsigned long ulRandom = 1;
+
+/* Time the sampler handed over each block still in the pipeline, to measure
+ * how long a block takes to reach the display. */
+static unsigned long long ullBlockStart[16];
+static unsigned long ulBlocksIn = 0, ulBlocksOut = 0;
+static unsigned long long ullLatencyTotal = 0, ullLatencyMax = 0;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief The tasks never run, the benchmark calls the kernel for them.
+ * @param pvParameters Unused.
+ */
+static void prvTask(void *pvParameters) { (void)pvParameters; }
+
+/**
+ * @brief Calls vTaskSwitchContext() while the kernel asks for a yield, and
+ * counts the yields and the switches.
+ */
+static void prvSwitch(void) {
+  while (xPortYieldPending != 0) {
+    void *pvPrevious = pxCurrentTCB;
+
+    xPortYieldPending = 0;
+    ulYields++;
+    vTaskSwitchContext();
+    if (pxCurrentTCB != pvPrevious) {
+      ulSwitches++;
+      if (pvPrevious != xTaskGetIdleTaskHandle() &&
+          eTaskGetState(pvPrevious) == eReady) {
+        ulPreemptions++;
+      }
+    }
+  }
+}
+
+/**
+ * @brief Hands a block to a stage, waking its task if it waits for one, as
+ * xQueueSend() does.
+ * @param pxStage The stage.
+ * @param xFromISR pdTRUE if called from the sampler interrupt.
+ */
+static void prvGive(Stage_t *pxStage, BaseType_t xFromISR) {
+  pxStage->ulBlocks++;
+  if (listLIST_IS_EMPTY(&pxStage->xWaiting) == pdFALSE) {
+    BaseType_t xWoken = xTaskRemoveFromEventList(&pxStage->xWaiting);
+
+    if (xFromISR == pdTRUE) {
+      portYIELD_FROM_ISR(xWoken);
+    } else if (xWoken != pdFALSE) {
+      portYIELD();
+    }
+  }
+}
+
+/**
+ * @brief Takes a block for the running stage, or starts to block its task
+ * until there is one, as xQueueReceive() does. The task runs
+ * benchWAIT_US with the scheduler suspended, and then prvBlock() is
+ * called.
+ * @param pxStage The stage of the running task.
+ * @return BaseType_t pdTRUE if it got a block.
+ */
+static BaseType_t prvTake(Stage_t *pxStage) {
+  if (pxStage->ulBlocks == 0) {
+    vTaskSuspendAll();
+    pxStage->ulSuspended = benchWAIT_US;
+    return pdFALSE;
+  }
+  pxStage->ulBlocks--;
+  /* Anywhere from half to one and a half times the mean. */
+  ulRandom = ulRandom * 1103515245UL + 12345UL;
+  pxStage->ulLeft = pxStage->ulWork / 2 +
+                    ((ulRandom >> 8) & 0xFFFFUL) * pxStage->ulWork / 0x10000UL;
+  /* The sensor task only moves the samples. The rest of the block always runs
+   * with the scheduler resumed, for the block to be passed on. */
+  if (pxStage != &xStages[eSensor] && ulLockedWork != 0 && pxStage->ulLeft > 1) {
+    pxStage->ulLocked = ulLockedWork < pxStage->ulLeft ? ulLockedWork
+                                                       : pxStage->ulLeft - 1;
+    vTaskSuspendAll();
+  }
+  return pdTRUE;
+}
+
+/**
+ * @brief Blocks the task of the running stage at the end of prvTake(), unless
+ * a block arrived while the scheduler was suspended, as xQueueReceive() does.
+ * @param pxStage The stage of the running task.
+ */
+static void prvBlock(Stage_t *pxStage) {
+  BaseType_t xWaits = (pxStage->ulBlocks == 0) ? pdTRUE : pdFALSE;
+
+  if (xWaits == pdTRUE) {
+    vTaskPlaceOnEventList(&pxStage->xWaiting, portMAX_DELAY);
+  }
+  if (xTaskResumeAll() == pdFALSE && xWaits == pdTRUE) {
+    portYIELD();
+  }
+}
+
+/*-----------------------------------------------------------*/
+
+/* Port layer, see portmacro.h. */
+
+StackType_t *pxPortInitialiseStack(StackType_t *pxTopOfStack,
+                                   TaskFunction_t pxCode, void *pvParameters) {
+  (void)pxCode;
+  (void)pvParameters;
+  return pxTopOfStack;
+}
+
+BaseType_t xPortStartScheduler(void) { return pdTRUE; }
+
+void vPortEndScheduler(void) {}
+
+void vApplicationGetIdleTaskMemory(StaticTask_t **ppxIdleTaskTCBBuffer,
+                                   StackType_t **ppxIdleTaskStackBuffer,
+                                   uint32_t *pulIdleTaskStackSize) {
+  *ppxIdleTaskTCBBuffer = &xIdleBuffer;
+  *ppxIdleTaskStackBuffer = xIdleStack;
+  *pulIdleTaskStackSize = configMINIMAL_STACK_SIZE;
+}
+
+/*-----------------------------------------------------------*/
+
+int main(int argc, char *argv[]) {
+  unsigned long ulRate, ulSeconds = benchDEFAULT_SECONDS;
+  unsigned long long ullNow = 0, ullEnd, ullNextTick, ullNextBlock;
+  unsigned long long ullBlockPeriod;
+
+  if (argc < 2 || argc == 3 || (ulRate = strtoul(argv[1], NULL, 0)) == 0) {
+    fprintf(stderr,
+            "usage: %s RATE_HZ [FILTER_US GRAFIC_US [SECONDS [SUSPENDED_US]]]\n",
+            argv[0]);
+    return 2;
+  }
+  if (argc > 3) {
+    xStages[eFilter].ulWork = strtoul(argv[2], NULL, 0);
+    xStages[eGrafic].ulWork = strtoul(argv[3], NULL, 0);
+  }
+  if (argc > 4) {
+    ulSeconds = strtoul(argv[4], NULL, 0);
+  }
+  if (argc > 5) {
+    ulLockedWork = strtoul(argv[5], NULL, 0);
+  }
+
+  for (int i = 0; i < eStages; i++) {
+    vListInitialise(&xStages[i].xWaiting);
+    xStages[i].xTask = xTaskCreateStatic(
+        prvTask, xStages[i].pcName, configMINIMAL_STACK_SIZE, NULL,
+        xStages[i].uxPriority, xStages[i].xStack, &xStages[i].xBuffer);
+#if configUSE_PREEMPTION_THRESHOLDS == 1
+    vTaskSetPreemptionThreshold(xStages[i].xTask, xStages[i].uxThreshold);
+#endif
+  }
+  vTaskStartScheduler();
+
+  ullBlockPeriod = 1000000ULL * benchBLOCK_SIZE / ulRate;
+  ullNextTick = benchTICK_US;
+  ullNextBlock = ullBlockPeriod;
+  ullEnd = 1000000ULL * ulSeconds;
+
+  while (ullNow < ullEnd) {
+    Stage_t *pxStage = NULL;
+    unsigned long long ullEvent =
+        (ullNextTick < ullNextBlock) ? ullNextTick : ullNextBlock;
+
+    prvSwitch();
+    for (int i = 0; i < eStages; i++) {
+      if (pxCurrentTCB == xStages[i].xTask) {
+        pxStage = &xStages[i];
+      }
+    }
+
+    if (pxStage == NULL) {
+      /* Idle until the next interrupt. */
+      ullNow = ullEvent;
+    } else if (pxStage->ulSuspended != 0) {
+      /* About to block, with the scheduler suspended. */
+      unsigned long long ullRun = ullEvent - ullNow;
+
+      if (ullRun > pxStage->ulSuspended) {
+        ullRun = pxStage->ulSuspended;
+      }
+      ullNow += ullRun;
+      pxStage->ulSuspended -= (unsigned long)ullRun;
+
+      if (pxStage->ulSuspended == 0) {
+        prvBlock(pxStage);
+        continue;
+      }
+    } else if (pxStage->ulLeft == 0) {
+      /* Waiting for a block, or just woken with one. */
+      prvTake(pxStage);
+      continue;
+    } else {
+      unsigned long long ullRun = ullEvent - ullNow;
+      unsigned long ulPart =
+          (pxStage->ulLocked != 0) ? pxStage->ulLocked : pxStage->ulLeft;
+
+      if (ullRun > ulPart) {
+        ullRun = ulPart;
+      }
+      ullNow += ullRun;
+      pxStage->ulLeft -= (unsigned long)ullRun;
+
+      if (pxStage->ulLocked != 0) {
+        pxStage->ulLocked -= (unsigned long)ullRun;
+        if (pxStage->ulLocked == 0) {
+          (void)xTaskResumeAll();
+          continue;
+        }
+      }
+
+      if (pxStage->ulLeft == 0) {
+        if (pxStage + 1 < &xStages[eStages]) {
+          prvGive(pxStage + 1, pdFALSE);
+        } else {
+          unsigned long long ullLatency =
+              ullNow - ullBlockStart[ulBlocksOut++ % 16];
+
+          ullLatencyTotal += ullLatency;
+          if (ullLatency > ullLatencyMax) {
+            ullLatencyMax = ullLatency;
+          }
+        }
+        continue;
+      }
+    }
+
+    /* The interrupts due now. */
+    if (ullNow == ullNextBlock) {
+      if (ulBlocksIn - ulBlocksOut >= 16) {
+        fprintf(stderr, "the pipeline cannot keep up at %lu Hz\n", ulRate);
+        return 1;
+      }
+      ullBlockStart[ulBlocksIn++ % 16] = ullNow;
+      prvGive(&xStages[eSensor], pdTRUE);
+      ullNextBlock += ullBlockPeriod;
+    }
+    if (ullNow == ullNextTick) {
+      if (xTaskIncrementTick() != pdFALSE) {
+        xPortYieldPending = 1;
+      }
+      ullNextTick += benchTICK_US;
+    }
+  }
+
+  printf("%-9s %5lu Hz: %6.1f yields/s, %6.1f switches/s, "
+         "%6.1f preemptions/s, block to display %5llu us mean, %5llu us max\n",
+         configUSE_PREEMPTION_THRESHOLDS ? "threshold" : "priority", ulRate,
+         (double)ulYields / ulSeconds, (double)ulSwitches / ulSeconds,
+         (double)ulPreemptions / ulSeconds,
+         ulBlocksOut ? ullLatencyTotal / ulBlocksOut : 0ULL, ullLatencyMax);
+  return 0;
+}
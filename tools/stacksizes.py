@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+"""Generates stacksizes.h from the reports of a stack profiling run.
+
+Build with configUSE_STACK_PROFILE set to 1, run the application under the
+heaviest load it will see (highest sample rate, every filter kernel, monitor
+and command traffic) and send "stacks=report" a few times, capturing the UART
+output, for example by piping the output of QEMU through "tee uart.log". Then:
+
+    python3 tools/stacksizes.py uart.log > stacksizes.h
+
+Every stack gets the largest size
+recommended by any report in the log, see prvStackReport() in main.c. Stacks
+missing from the log keep the size they have in the current stacksizes.h.
+"""
+
+import os
+import re
+import sys
+
+# Report lines: $S,<name>,<allocated words>,<used words>,<recommended words>.
+# The monitor output can come before them on the same line, so only the last
+# '$' counts.
+REPORT = re.compile(r"\$S,([A-Za-z0-9 ]+),(\d+),(\d+),(\d+)$")
+
+# Stacks in the order they are written to the header.
+STACKS = ["Sensor", "Filter", "Grafic", "Monitor", "Command", "IDLE", "MSP"]
+
+HEADER = os.path.join(os.path.dirname(__file__), "..", "stacksizes.h")
+
+
+def macro(name):
+    return "stack%s_WORDS" % name.upper()
+
+
+def current_sizes():
+    """Returns the sizes in the current stacksizes.h."""
+    sizes = {}
+    try:
+        with open(HEADER) as header:
+            for line in header:
+                match = re.match(r"#define stack(\w+)_WORDS \((\d+)\)", line)
+                if match:
+                    sizes[match.group(1)] = int(match.group(2))
+    except OSError:
+        pass
+    return {name: sizes[name.upper()] for name in STACKS if name.upper() in sizes}
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit("usage: stacksizes.py uart.log > stacksizes.h")
+
+    measured = {}
+    with open(sys.argv[1], encoding="latin-1") as log:
+        for line in log:
+            line = line.rstrip("\r\n")
+            match = REPORT.match(line[line.rfind("$") :])
+            if match:
+                name = match.group(1)
+                recommended = int(match.group(4))
+                measured[name] = max(measured.get(name, 0), recommended)
+
+    if not measured:
+        sys.exit("no stack report found")
+
+    sizes = current_sizes()
+    sizes.update(measured)
+
+    # The sources use CRLF line endings.
+    sys.stdout.reconfigure(newline="\r\n")
+
+    print("/* Stack sizes in words, generated by tools/stacksizes.py from a")
+    print(" * stack profiling run, see configUSE_STACK_PROFILE in")
+    print(" * FreeRTOSConfig.h. Each one is the deepest use seen plus room for")
+    print(" * an exception frame and the overflow check pattern. */")
+    print()
+    print("#ifndef STACKSIZES_H")
+    print("#define STACKSIZES_H")
+    print()
+    for name in STACKS:
+        if name in sizes:
+            print("#define %s (%d)" % (macro(name), sizes[name]))
+    print()
+    print("#endif /* STACKSIZES_H */")
+
+
+if __name__ == "__main__":
+    main()
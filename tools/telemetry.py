@@ -0,0 +1,308 @@
+#!/usr/bin/env python3
+"""Decodes the binary telemetry of the firmware and plots it live.
+
+After the command "link=bin" the firmware sends the samples, the filter output,
+the task statistics, the command acknowledges and the missed deadlines as SLIP
+frames with a CRC, see telemetry.c. This script reads them from a capture, a serial port or a TCP
+socket and writes every message as a line of JSON, for other tools to read:
+
+    python3 tools/telemetry.py uart.bin > telemetry.jsonl
+
+To watch a running board, or QEMU started with "-serial tcp::4444,server",
+switch the link to binary and plot the samples, the filter output and the CPU
+usage of every task as they arrive:
+
+    python3 tools/telemetry.py --send link=bin --plot tcp:localhost:4444
+    python3 tools/telemetry.py --send link=bin --plot /dev/ttyUSB0
+
+Serial ports need pyserial and the plot needs matplotlib. At the end the
+number of good, corrupted and lost frames and the bytes per value are written
+to stderr.
+"""
+
+import argparse
+import collections
+import json
+import socket
+import struct
+import sys
+import threading
+
+# Must match telemetry.h.
+MSG_SAMPLES = 1
+MSG_FILTERED = 2
+MSG_TASKS = 3
+MSG_TASK_NAME = 4
+MSG_ACK = 5
+MSG_DEADLINE = 6
+
+# SLIP special bytes.
+END = 0xC0
+ESC = 0xDB
+ESC_END = 0xDC
+ESC_ESC = 0xDD
+
+# Must match pcStateNames and pcFilterNames in main.c.
+STATES = ["Running", "Ready", "Blocked", "Suspended", "Deleted", "Invalid"]
+FILTERS = ["mean", "ema", "median", "fir"]
+
+# Values kept by the plot.
+PLOT_SAMPLES = 500
+PLOT_SECONDS = 120
+
+
+def crc16(data):
+    """CRC-16/CCITT-FALSE."""
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+def frames(chunks, stats):
+    """Splits a byte stream in SLIP frames and yields the contents of those
+    with a good CRC. Whatever is not a frame, like the text answers to some
+    commands, is skipped."""
+    frame = bytearray()
+    escaped = False
+    for chunk in chunks:
+        stats["bytes"] += len(chunk)
+        for byte in chunk:
+            if byte == END:
+                if len(frame) >= 4 and crc16(frame[:-2]) == (
+                    frame[-2] | frame[-1] << 8
+                ):
+                    stats["frames"] += 1
+                    yield bytes(frame[:-2])
+                elif frame:
+                    stats["bad"] += 1
+                frame.clear()
+                escaped = False
+            elif escaped:
+                frame.append({ESC_END: END, ESC_ESC: ESC}.get(byte, byte))
+                escaped = False
+            elif byte == ESC:
+                escaped = True
+            else:
+                frame.append(byte)
+
+
+def varints(data):
+    """Yields the signed varints in data."""
+    value = shift = 0
+    for byte in data:
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            yield (value >> 1) ^ -(value & 1)
+            value = shift = 0
+
+
+def decode(frame, names):
+    """Returns the message in a frame as a dict, or None if unknown."""
+    kind, sequence, payload = frame[0], frame[1], frame[2:]
+    message = {"seq": sequence}
+
+    if kind in (MSG_SAMPLES, MSG_FILTERED):
+        (first,) = struct.unpack_from("<H", payload)
+        values = []
+        value = 0
+        for delta in varints(payload[2:]):
+            # Differences of 32 bit ints.
+            value = (value + delta + 2**31) % 2**32 - 2**31
+            values.append(value)
+        message.update(
+            type="samples" if kind == MSG_SAMPLES else "filtered",
+            first=first,
+            values=values,
+        )
+    elif kind == MSG_TASKS:
+        (tick,) = struct.unpack_from("<I", payload)
+        tasks = []
+        for offset in range(4, len(payload) - 5, 6):
+            number, state, cpu, stack = struct.unpack_from("<BBHH", payload, offset)
+            tasks.append(
+                {
+                    "number": number,
+                    "name": names.get(number, "task %d" % number),
+                    "state": STATES[min(state, len(STATES) - 1)],
+                    "cpu": cpu / 100.0,
+                    "stack": stack,
+                }
+            )
+        message.update(type="tasks", tick=tick, tasks=tasks)
+    elif kind == MSG_TASK_NAME:
+        names[payload[0]] = payload[1:].decode("latin-1")
+        message.update(type="task_name", number=payload[0], name=names[payload[0]])
+    elif kind == MSG_ACK:
+        applied, n, filter_kind, rate = struct.unpack_from("<BBBH", payload)
+        message.update(
+            type="ack",
+            applied=bool(applied),
+            N=n,
+            filter=FILTERS[filter_kind] if filter_kind < len(FILTERS) else filter_kind,
+            rate=rate,
+        )
+    elif kind == MSG_DEADLINE:
+        number, late = struct.unpack_from("<BH", payload)
+        message.update(
+            type="deadline_miss",
+            number=number,
+            name=names.get(number, "task %d" % number),
+            late_ms=late,
+        )
+    else:
+        return None
+    return message
+
+
+def messages(chunks, stats):
+    """Yields the messages in a byte stream, counting the frames lost on the
+    way from the gaps in the sequence numbers."""
+    names = {}
+    expected = None
+    for frame in frames(chunks, stats):
+        if len(frame) < 2:
+            continue
+        if expected is not None:
+            stats["lost"] += (frame[1] - expected) & 0xFF
+        expected = (frame[1] + 1) & 0xFF
+        try:
+            message = decode(frame, names)
+        except (struct.error, IndexError):
+            stats["bad"] += 1
+            continue
+        if message is not None:
+            if message["type"] in ("samples", "filtered"):
+                stats["values"] += len(message["values"])
+            yield message
+
+
+def open_source(source, baud, send):
+    """Returns an iterator over the chunks of bytes read from the source, after
+    sending the commands in send to it."""
+    if source == "-":
+        stream = sys.stdin.buffer
+        write = None
+    elif source.startswith("tcp:"):
+        host, port = source[4:].rsplit(":", 1)
+        sock = socket.create_connection((host, int(port)))
+        stream = sock.makefile("rb", buffering=0)
+        write = sock.sendall
+    elif source.startswith("/dev/"):
+        import serial  # pyserial
+
+        port = serial.Serial(source, baud, timeout=1)
+        stream = port
+        write = port.write
+    else:
+        stream = open(source, "rb")
+        write = None
+
+    for command in send:
+        if write is None:
+            sys.exit("--send needs a serial port or a TCP socket")
+        write((command + "\r\n").encode())
+
+    def chunks():
+        while True:
+            chunk = stream.read(256)
+            if chunk is None:
+                continue
+            if not chunk:
+                if source.startswith("/dev/"):
+                    continue
+                return
+            yield chunk
+
+    return chunks()
+
+
+def plot(source, stats):
+    """Draws the last samples and filter output, and the CPU usage of the
+    tasks, while the messages are decoded in another thread."""
+    import matplotlib.animation as animation
+    import matplotlib.pyplot as plt
+
+    lock = threading.Lock()
+    series = {
+        "samples": collections.deque(maxlen=PLOT_SAMPLES),
+        "filtered": collections.deque(maxlen=PLOT_SAMPLES),
+    }
+    cpu = collections.defaultdict(lambda: collections.deque(maxlen=PLOT_SECONDS))
+
+    def reader():
+        for message in messages(source, stats):
+            print(json.dumps(message), flush=True)
+            with lock:
+                if message["type"] in series:
+                    series[message["type"]].extend(message["values"])
+                elif message["type"] == "tasks":
+                    seconds = message["tick"] / 1000.0
+                    for task in message["tasks"]:
+                        cpu[task["name"]].append((seconds, task["cpu"]))
+
+    threading.Thread(target=reader, daemon=True).start()
+
+    figure, (values_axes, cpu_axes) = plt.subplots(2, 1)
+
+    def update(_frame):
+        with lock:
+            values_axes.clear()
+            for name, points in series.items():
+                if points:
+                    values_axes.plot(list(points), label=name)
+            values_axes.set_xlabel("last %d samples" % PLOT_SAMPLES)
+            values_axes.legend(loc="upper left")
+            cpu_axes.clear()
+            for name, points in sorted(cpu.items()):
+                times, usages = zip(*points)
+                cpu_axes.plot(times, usages, label=name)
+            cpu_axes.set_xlabel("s")
+            cpu_axes.set_ylabel("CPU %")
+            if cpu:
+                cpu_axes.legend(loc="upper left", fontsize="small")
+
+    _animation = animation.FuncAnimation(figure, update, interval=500)
+    plt.show()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument(
+        "source",
+        nargs="?",
+        default="-",
+        help="capture file, serial port (/dev/...), tcp:HOST:PORT or - for stdin",
+    )
+    parser.add_argument("--baud", type=int, default=19200)
+    parser.add_argument(
+        "--send", action="append", default=[], help="command to send first"
+    )
+    parser.add_argument("--plot", action="store_true", help="plot live")
+    args = parser.parse_args()
+
+    stats = collections.Counter()
+    source = open_source(args.source, args.baud, args.send)
+    try:
+        if args.plot:
+            plot(source, stats)
+        else:
+            for message in messages(source, stats):
+                print(json.dumps(message))
+    except KeyboardInterrupt:
+        pass
+    finally:
+        per_value = stats["bytes"] / stats["values"] if stats["values"] else 0
+        print(
+            "frames %d, corrupted %d, lost %d, %d bytes, %.2f bytes per value"
+            % (stats["frames"], stats["bad"], stats["lost"], stats["bytes"], per_value),
+            file=sys.stderr,
+        )
+
+
+if __name__ == "__main__":
+    main()
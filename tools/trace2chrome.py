@@ -0,0 +1,298 @@
+#!/usr/bin/env python3
+"""Converts a trace recorder dump to the Chrome trace event format.
+
+The firmware sends the dump in answer to the "trace=dump" command, see
+prvTraceExport() in main.c. Capture the UART output to a file, for example by
+piping the output of QEMU through "tee uart.log", and convert it:
+
+    python3 tools/trace2chrome.py uart.log > trace.json
+
+The result opens in chrome://tracing or https://ui.perfetto.dev. Every task
+gets a track with the intervals it ran, the moments it became ready and its
+queue operations, the interrupts share another track, and the number of items
+of every named queue is drawn as a counter. If the log holds several dumps,
+the last one is converted.
+"""
+
+import json
+import re
+import sys
+
+# Must match trace.h.
+EVENT_TASK_READY = 1
+EVENT_TASK_SWITCHED_IN = 2
+EVENT_QUEUE_SEND = 3
+EVENT_QUEUE_RECEIVE = 4
+EVENT_QUEUE_BLOCK_SEND = 5
+EVENT_QUEUE_BLOCK_RECEIVE = 6
+EVENT_ISR_ENTER = 7
+EVENT_ISR_EXIT = 8
+EVENT_TICK = 9
+EVENT_CLOCK = 10
+
+# Unit of the clocks in the EVENT_CLOCK records, see power.h.
+CLOCK_UNIT_HZ = 100000
+
+QUEUE_EVENTS = {
+    EVENT_QUEUE_SEND: "send",
+    EVENT_QUEUE_RECEIVE: "receive",
+    EVENT_QUEUE_BLOCK_SEND: "block on send",
+    EVENT_QUEUE_BLOCK_RECEIVE: "block on receive",
+}
+
+# Exception numbers of the handlers in init/startup.c.
+EXCEPTIONS = {
+    15: "SysTick",
+    21: "UART0",
+    24: "I2C",
+    30: "ADC0",
+    35: "Timer0A",
+    37: "Timer1A",
+    39: "Timer2A",
+}
+
+PID = 1
+ISR_TID = 1000
+
+# Lines of the dump start with '$'. The monitor output can come before them on
+# the same line, so only the last '$' counts.
+LINE = re.compile(r"\$([Ttqre])(?:,(.*))?$")
+
+
+def parse(lines):
+    """Returns the clock rate, task names, queue names and records of the last
+    dump in the log."""
+    dump = None
+    for raw in lines:
+        raw = raw.rstrip("\r\n")
+        start = raw.rfind("$")
+        if start < 0:
+            continue
+        match = LINE.match(raw[start:])
+        if not match:
+            continue
+        kind, fields = match.group(1), match.group(2)
+
+        if kind == "T":
+            hz, _count = fields.split(",")
+            dump = {"hz": int(hz), "tasks": {}, "queues": {}, "records": []}
+        elif dump is None:
+            continue
+        elif kind == "t":
+            number, name = fields.split(",", 1)
+            dump["tasks"][int(number)] = name
+        elif kind == "q":
+            number, name = fields.split(",", 1)
+            dump["queues"][int(number)] = name
+        elif kind == "r":
+            if not re.fullmatch(r"[0-9a-f]{16}", fields or ""):
+                continue
+            dump["records"].append(
+                (
+                    int(fields[0:8], 16),
+                    int(fields[8:10], 16),
+                    int(fields[10:12], 16),
+                    int(fields[12:16], 16),
+                )
+            )
+        elif kind == "e":
+            done = dump
+            dump = None
+            yield done
+
+    if dump is not None:
+        # Cut short, convert what arrived.
+        yield dump
+
+
+def timeline(records, hz):
+    """Converts the times of the records, in processor cycles, to us. The
+    records are in buffer order, which is almost time order, so each time is
+    taken as the closest to the previous one, which also extends the 32 bit
+    times across counter wraps. The processor clock is the one in the dump
+    header unless it changed, then the EVENT_CLOCK records give the clock
+    before and after every change."""
+    for _time, event, obj, _data in records:
+        if event == EVENT_CLOCK:
+            hz = obj * CLOCK_UNIT_HZ
+            break
+
+    result = []
+    previous = None
+    now = 0.0
+    for time, event, obj, data in records:
+        if previous is not None:
+            delta = (time - previous) & 0xFFFFFFFF
+            if delta >= 1 << 31:
+                delta -= 1 << 32
+            now += delta / (hz / 1e6)
+        previous = time
+        result.append((now, event, obj, data))
+        if event == EVENT_CLOCK:
+            hz = data * CLOCK_UNIT_HZ
+    result.sort(key=lambda record: record[0])
+    return result
+
+
+def convert(dump):
+    """Returns the Chrome trace events of a dump."""
+    tasks = dict(dump["tasks"])
+    queues = dump["queues"]
+    records = timeline(dump["records"], dump["hz"])
+    if not records:
+        return []
+    origin = records[0][0]
+
+    def us(time):
+        return time - origin
+
+    def task_name(number):
+        return tasks.get(number, "task %d" % number)
+
+    def queue_name(number):
+        return queues.get(number, "queue %d" % number)
+
+    events = []
+    running = None  # (task number, start time)
+    isr_start = {}
+    context = None  # Task the queue operations belong to.
+
+    for time, event, obj, data in records:
+        if event == EVENT_TASK_SWITCHED_IN:
+            if running is not None:
+                events.append(
+                    {
+                        "name": task_name(running[0]),
+                        "ph": "X",
+                        "pid": PID,
+                        "tid": running[0],
+                        "ts": us(running[1]),
+                        "dur": us(time) - us(running[1]),
+                    }
+                )
+            running = (obj, time)
+            context = obj
+        elif event == EVENT_TASK_READY:
+            events.append(
+                {
+                    "name": "ready",
+                    "ph": "i",
+                    "s": "t",
+                    "pid": PID,
+                    "tid": obj,
+                    "ts": us(time),
+                }
+            )
+        elif event in QUEUE_EVENTS:
+            tid = ISR_TID if isr_start else context
+            if tid is None:
+                continue
+            events.append(
+                {
+                    "name": "%s %s" % (QUEUE_EVENTS[event], queue_name(obj)),
+                    "ph": "i",
+                    "s": "t",
+                    "pid": PID,
+                    "tid": tid,
+                    "ts": us(time),
+                    "args": {"items": data},
+                }
+            )
+            if obj in queues:
+                items = data
+                if event == EVENT_QUEUE_SEND:
+                    items += 1
+                elif event == EVENT_QUEUE_RECEIVE:
+                    items -= 1
+                events.append(
+                    {
+                        "name": queue_name(obj),
+                        "ph": "C",
+                        "pid": PID,
+                        "ts": us(time),
+                        "args": {"items": items},
+                    }
+                )
+        elif event == EVENT_ISR_ENTER:
+            isr_start[obj] = time
+        elif event == EVENT_ISR_EXIT:
+            start = isr_start.pop(obj, None)
+            if start is not None:
+                events.append(
+                    {
+                        "name": EXCEPTIONS.get(obj, "IRQ %d" % (obj - 16)),
+                        "ph": "X",
+                        "pid": PID,
+                        "tid": ISR_TID,
+                        "ts": us(start),
+                        "dur": us(time) - us(start),
+                    }
+                )
+        elif event == EVENT_TICK:
+            events.append(
+                {
+                    "name": "tick %d" % data,
+                    "ph": "i",
+                    "s": "t",
+                    "pid": PID,
+                    "tid": ISR_TID,
+                    "ts": us(time),
+                }
+            )
+        elif event == EVENT_CLOCK:
+            events.append(
+                {
+                    "name": "clock",
+                    "ph": "C",
+                    "pid": PID,
+                    "ts": us(time),
+                    "args": {"MHz": data * CLOCK_UNIT_HZ / 1e6},
+                }
+            )
+
+    # Track names, in task number order with the interrupts last.
+    events.append(
+        {"name": "process_name", "ph": "M", "pid": PID, "args": {"name": "CPU"}}
+    )
+    for number in sorted(set(tasks) | {e["tid"] for e in events if "tid" in e}):
+        name = "Interrupts" if number == ISR_TID else task_name(number)
+        events.append(
+            {
+                "name": "thread_name",
+                "ph": "M",
+                "pid": PID,
+                "tid": number,
+                "args": {"name": name},
+            }
+        )
+        events.append(
+            {
+                "name": "thread_sort_index",
+                "ph": "M",
+                "pid": PID,
+                "tid": number,
+                "args": {"sort_index": number},
+            }
+        )
+
+    return events
+
+
+def main():
+    if len(sys.argv) > 2:
+        sys.exit("usage: trace2chrome.py [uart.log]")
+
+    if len(sys.argv) == 2:
+        with open(sys.argv[1], encoding="latin-1") as log:
+            dumps = list(parse(log))
+    else:
+        dumps = list(parse(sys.stdin))
+
+    if not dumps:
+        sys.exit("no trace dump found")
+
+    json.dump({"traceEvents": convert(dumps[-1])}, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,177 @@
+/* Kernel event trace recorder.
+ *
+ * The kernel trace hooks defined in FreeRTOSConfig.h, and the application
+ * interrupt handlers, append fixed size binary records to a ring buffer in
+ * RAM. When the buffer is full the oldest records are overwritten, so it
+ * always holds the last traceBUFFER_RECORDS events. Recording stops while the
+ * buffer is read out, see prvTraceExport() in main.c and tools/trace2chrome.py
+ * for the decoder.
+ *
+ * Writers reserve a record by atomically incrementing the head with an
+ * exclusive load and store, so tasks and interrupts of any priority can record
+ * without masking interrupts. Only compiled when configUSE_TRACE_RECORDER is
+ * 1. */
+
+/* Scheduler includes. */
+#include "FreeRTOS.h"
+#include "queue.h"
+#include "task.h"
+
+#include "timertest.h"
+#include "trace.h"
+
+#if configUSE_TRACE_RECORDER == 1
+
+#define traceBUFFER_MASK (traceBUFFER_RECORDS - 1UL)
+
+/*-----------------------------------------------------------*/
+
+static TraceRecord_t xRecords[traceBUFFER_RECORDS];
+
+/* Number of records ever reserved, masked when indexing. */
+static volatile unsigned long ulHead = 0UL;
+
+static volatile BaseType_t xRecording = pdTRUE;
+
+/* Names of the tasks and queues that appear in the records. */
+static void *pvTasks[traceMAX_TASKS];
+static const char *pcQueueNames[traceMAX_QUEUES];
+static unsigned long ulQueues = 0UL;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Returns the number of the exception being serviced.
+ * @return unsigned long The exception number, 0 in thread mode.
+ */
+static unsigned long prvExceptionNumber(void) {
+  unsigned long ulIpsr;
+
+  __asm volatile("mrs %0, ipsr" : "=r"(ulIpsr));
+  return ulIpsr & 0x1FFUL;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Appends a record to the buffer. Can be called from any context.
+ * @param ulEvent One of the traceEVENT_ values.
+ * @param ulObject Object of the event, truncated to 8 bits.
+ * @param ulData Event data, truncated to 16 bits.
+ */
+void vTraceRecord(unsigned long ulEvent, unsigned long ulObject,
+                  unsigned long ulData) {
+  TraceRecord_t *pxRecord;
+
+  if (xRecording == pdFALSE) {
+    return;
+  }
+
+  pxRecord = &xRecords[__atomic_fetch_add(&ulHead, 1UL, __ATOMIC_RELAXED) &
+                       traceBUFFER_MASK];
+  pxRecord->ulTime = timerGET_CYCLES();
+  pxRecord->ucEvent = (uint8_t)ulEvent;
+  pxRecord->ucObject = (uint8_t)ulObject;
+  pxRecord->usData = (uint16_t)ulData;
+}
+
+/**
+ * @brief Remembers a new task, so its name can be sent with the records.
+ * Called by the kernel through traceTASK_CREATE().
+ * @param pvTask The task.
+ * @param ulTaskNumber Number of the task, as in TaskStatus_t.
+ */
+void vTraceTaskCreated(void *pvTask, unsigned long ulTaskNumber) {
+  if (ulTaskNumber - 1UL < traceMAX_TASKS) {
+    pvTasks[ulTaskNumber - 1UL] = pvTask;
+  }
+}
+
+/**
+ * @brief Records the entry of an interrupt handler. Must be the first thing
+ * the handler does.
+ */
+void vTraceIsrEnter(void) {
+  vTraceRecord(traceEVENT_ISR_ENTER, prvExceptionNumber(), 0UL);
+}
+
+/**
+ * @brief Records the exit of an interrupt handler. Must be called right
+ * before the handler returns, after portYIELD_FROM_ISR().
+ */
+void vTraceIsrExit(void) {
+  vTraceRecord(traceEVENT_ISR_EXIT, prvExceptionNumber(), 0UL);
+}
+
+/**
+ * @brief Gives a queue the next queue number, so its events can be told apart
+ * from the others. Queues that are not named all have number 0.
+ * @param pvQueue The queue, semaphore or mutex.
+ * @param pcName Name, must not be freed.
+ */
+void vTraceNameQueue(void *pvQueue, const char *pcName) {
+  if (ulQueues < traceMAX_QUEUES) {
+    pcQueueNames[ulQueues++] = pcName;
+    vQueueSetQueueNumber((QueueHandle_t)pvQueue, ulQueues);
+  }
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Clears the buffer and starts recording.
+ */
+void vTraceStart(void) {
+  xRecording = pdFALSE;
+  ulHead = 0UL;
+  xRecording = pdTRUE;
+}
+
+/**
+ * @brief Stops recording, so the buffer can be read.
+ */
+void vTraceStop(void) { xRecording = pdFALSE; }
+
+/**
+ * @brief Returns the number of records in the buffer.
+ * @return unsigned long Number of records, at most traceBUFFER_RECORDS.
+ */
+unsigned long ulTraceCount(void) {
+  return (ulHead < traceBUFFER_RECORDS) ? ulHead : traceBUFFER_RECORDS;
+}
+
+/**
+ * @brief Reads a record. Recording must be stopped.
+ * @param ulIndex Index of the record, 0 is the oldest.
+ * @param pxRecord Where the record is copied.
+ */
+void vTraceGetRecord(unsigned long ulIndex, TraceRecord_t *pxRecord) {
+  *pxRecord =
+      xRecords[(ulHead - ulTraceCount() + ulIndex) & traceBUFFER_MASK];
+}
+
+/**
+ * @brief Returns a task seen by the recorder.
+ * @param ulTaskNumber Task number, as in TaskStatus_t.
+ * @return void* The task handle, NULL if unknown.
+ */
+void *pvTraceGetTask(unsigned long ulTaskNumber) {
+  if (ulTaskNumber - 1UL >= traceMAX_TASKS) {
+    return NULL;
+  }
+  return pvTasks[ulTaskNumber - 1UL];
+}
+
+/**
+ * @brief Returns the name of a queue given to vTraceNameQueue().
+ * @param ulQueueNumber Queue number.
+ * @return const char* The name, NULL if unknown.
+ */
+const char *pcTraceGetQueueName(unsigned long ulQueueNumber) {
+  if (ulQueueNumber - 1UL >= ulQueues) {
+    return NULL;
+  }
+  return pcQueueNames[ulQueueNumber - 1UL];
+}
+
+#endif /* configUSE_TRACE_RECORDER */
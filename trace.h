@@ -0,0 +1,57 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+/* Included by FreeRTOSConfig.h to define the kernel trace hooks, so it must
+ * not include the FreeRTOS headers. */
+
+#include <stdint.h>
+
+/* Number of records kept, must be a power of two. Each record takes 8 bytes
+ * of RAM, and 32 are what fits in the 8K of SRAM next to the heap the tasks
+ * need, see configTOTAL_HEAP_SIZE. */
+#define traceBUFFER_RECORDS (32)
+
+/* Set to 1 to also record every tick. At 1KHz the ticks alone fill the buffer
+ * in 32ms, so they are left out unless needed. */
+#ifndef traceRECORD_TICKS
+#define traceRECORD_TICKS 0
+#endif
+
+/* Highest task and queue numbers whose names are kept. */
+#define traceMAX_TASKS (8)
+#define traceMAX_QUEUES (4)
+
+/* Events, with the meaning of the object and data fields of the record. */
+#define traceEVENT_TASK_READY (1)          /* Task number. */
+#define traceEVENT_TASK_SWITCHED_IN (2)    /* Task number. */
+#define traceEVENT_QUEUE_SEND (3)          /* Queue number, items before. */
+#define traceEVENT_QUEUE_RECEIVE (4)       /* Queue number, items before. */
+#define traceEVENT_QUEUE_BLOCK_SEND (5)    /* Queue number, items. */
+#define traceEVENT_QUEUE_BLOCK_RECEIVE (6) /* Queue number, items. */
+#define traceEVENT_ISR_ENTER (7)           /* Exception number. */
+#define traceEVENT_ISR_EXIT (8)            /* Exception number. */
+#define traceEVENT_TICK (9)                /* Tick count, low 16 bits. */
+#define traceEVENT_CLOCK (10) /* Old and new processor clock, in 100KHz. */
+
+/* Trace record. The time is the low 32 bits of the run time clock. */
+typedef struct {
+  uint32_t ulTime;
+  uint8_t ucEvent;
+  uint8_t ucObject;
+  uint16_t usData;
+} TraceRecord_t;
+
+void vTraceRecord(unsigned long ulEvent, unsigned long ulObject,
+                  unsigned long ulData);
+void vTraceTaskCreated(void *pvTask, unsigned long ulTaskNumber);
+void vTraceIsrEnter(void);
+void vTraceIsrExit(void);
+void vTraceNameQueue(void *pvQueue, const char *pcName);
+void vTraceStart(void);
+void vTraceStop(void);
+unsigned long ulTraceCount(void);
+void vTraceGetRecord(unsigned long ulIndex, TraceRecord_t *pxRecord);
+void *pvTraceGetTask(unsigned long ulTaskNumber);
+const char *pcTraceGetQueueName(unsigned long ulQueueNumber);
+
+#endif /* TRACE_H */